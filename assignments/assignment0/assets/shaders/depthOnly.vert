@@ -0,0 +1,14 @@
+#version 450
+
+//Vertex attributes
+layout(location = 0) in vec3 vPos; //Vertex position in model space
+
+uniform mat4 _Model; //Model->World Matrix
+uniform mat4 _ViewProjection; //Combined View->Projection Matrix
+
+//Must match lit.vert exactly so the color pass can depth test with GL_LEQUAL
+invariant gl_Position;
+
+void main() {
+	gl_Position = _ViewProjection * _Model * vec4(vPos,1.0);
+}
@@ -13,6 +13,15 @@ uniform vec3 _LightDirection = vec3(0.0,-1.0,0.0);
 uniform vec3 _LightColor = vec3(1.0);
 uniform vec3 _AmbientColor = vec3(0.3,0.4,0.46);
 
+//Cascaded shadow maps, one layer per cascade
+const int MAX_CASCADES = 4;
+uniform bool _ShadowsEnabled = false;
+uniform sampler2DArrayShadow _ShadowMap;
+uniform int _NumCascades;
+uniform float _CascadeSplits[MAX_CASCADES]; //View space distance where each cascade ends
+uniform mat4 _LightViewProjection[MAX_CASCADES];
+uniform vec3 _CameraForward;
+
 struct Material {
 	float Ka; //Ambient coefficient (0-1)
 	float Kd; //Diffuse coefficient (0-1)
@@ -21,6 +30,34 @@ struct Material {
 };
 uniform Material _Material;
 
+//Returns 1 when lit, 0 when fully in shadow
+float calcShadow(vec3 worldPos, vec3 normal, vec3 toLight) {
+	float viewDepth = dot(worldPos - _EyePos, _CameraForward);
+	int cascade = _NumCascades - 1;
+	for (int i = 0; i < _NumCascades; i++) {
+		if (viewDepth < _CascadeSplits[i]) {
+			cascade = i;
+			break;
+		}
+	}
+	vec4 lightClip = _LightViewProjection[cascade] * vec4(worldPos, 1.0);
+	vec3 shadowCoord = lightClip.xyz / lightClip.w * 0.5 + 0.5;
+	if (shadowCoord.z > 1.0) {
+		return 1.0;
+	}
+	//Polygon offset handles most acne, this catches grazing angles
+	float bias = 0.0005 * (1.0 - dot(normal, toLight));
+	//3x3 PCF on top of hardware 2x2 filtering
+	vec2 texelSize = 1.0 / vec2(textureSize(_ShadowMap, 0).xy);
+	float lit = 0.0;
+	for (int y = -1; y <= 1; y++) {
+		for (int x = -1; x <= 1; x++) {
+			lit += texture(_ShadowMap, vec4(shadowCoord.xy + vec2(x, y) * texelSize, cascade, shadowCoord.z - bias));
+		}
+	}
+	return lit / 9.0;
+}
+
 void main() {
 	//Make sure fragment normal is still length 1 after interpolation.
 	vec3 normal = normalize(fs_in.WorldNormal);
@@ -32,8 +69,9 @@ void main() {
 	//Blinn-phong uses half angle
 	vec3 h = normalize(toLight + toEye);
 	float specularFactor = pow(max(dot(normal,h),0.0),_Material.Shininess);
+	float shadow = _ShadowsEnabled ? calcShadow(fs_in.WorldPos, normal, toLight) : 1.0;
 	//Combination of specular and diffuse reflection
-	vec3 lightColor = (_Material.Kd * diffuseFactor + _Material.Ks * specularFactor) * _LightColor;
+	vec3 lightColor = (_Material.Kd * diffuseFactor + _Material.Ks * specularFactor) * _LightColor * shadow;
 	lightColor+=_AmbientColor * _Material.Ka;
 	vec3 objectColor = texture(_MainTex,fs_in.TexCoord).rgb;
 	FragColor = vec4(objectColor * lightColor,1.0);
@@ -14,6 +14,9 @@ out Surface {
 	vec2 TexCoord;
 } vs_out;
 
+//Must match depthOnly.vert exactly so the depth pre-pass lines up
+invariant gl_Position;
+
 void main() {
 	//Transform vertex position to World Space.
 	vs_out.WorldPos = vec3(_Model * vec4(vPos,1.0));
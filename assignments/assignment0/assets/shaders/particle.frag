@@ -0,0 +1,11 @@
+#version 450
+out vec4 FragColor;
+
+in vec4 vColor;
+in vec2 vUV;
+
+void main() {
+	//Soft round sprite. Points have a constant UV, so they stay solid.
+	float falloff = 1.0 - smoothstep(0.3, 0.5, length(vUV - vec2(0.5)));
+	FragColor = vec4(vColor.rgb, vColor.a * falloff);
+}
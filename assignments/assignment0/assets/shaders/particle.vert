@@ -0,0 +1,42 @@
+#version 450
+
+struct Particle {
+	vec4 positionLife; //xyz = position, w = seconds left to live
+	vec4 velocityLifetime; //xyz = velocity, w = total lifetime
+};
+struct SortEntry {
+	float depth;
+	uint index;
+};
+layout(std430, binding = 0) readonly buffer Particles { Particle particles[]; };
+layout(std430, binding = 3) readonly buffer SortEntries { SortEntry entries[]; };
+
+uniform mat4 _ViewProjection;
+uniform vec3 _CameraRight;
+uniform vec3 _CameraUp;
+uniform float _ParticleSize; //World space quad size
+uniform float _PointSize; //Pixels
+uniform int _DrawQuads; //Instanced 4 vertex strips instead of points
+uniform int _UseSortedIndices;
+
+out vec4 vColor;
+out vec2 vUV;
+
+void main() {
+	//No vertex attributes: points are one vertex per particle, quads one instance per particle
+	uint index = _DrawQuads != 0 ? uint(gl_InstanceID) : uint(gl_VertexID);
+	if (_UseSortedIndices != 0) {
+		index = entries[index].index;
+	}
+	Particle p = particles[index];
+	float age = 1.0 - p.positionLife.w / p.velocityLifetime.w; //0 at birth, 1 at death
+	vColor = mix(vec4(1.0, 0.85, 0.4, 1.0), vec4(0.9, 0.2, 0.1, 0.0), age);
+	vec3 position = p.positionLife.xyz;
+	vUV = vec2(0.5);
+	if (_DrawQuads != 0) {
+		vUV = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+		position += (_CameraRight * (vUV.x - 0.5) + _CameraUp * (vUV.y - 0.5)) * _ParticleSize;
+	}
+	gl_PointSize = _PointSize;
+	gl_Position = _ViewProjection * vec4(position, 1.0);
+}
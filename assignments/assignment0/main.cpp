@@ -1,5 +1,8 @@
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
+#include <memory>
+#include <filesystem>
 
 #include <ew/external/glad.h>
 
@@ -10,10 +13,23 @@
 
 #include <ew/shader.h>
 #include <ew/model.h>
+#include <ew/meshlet.h>
 #include <ew/camera.h>
 #include <ew/cameraController.h>
 #include <ew/transform.h>
 #include <ew/texture.h>
+#include <ew/jobSystem.h>
+#include <ew/memory.h>
+#include <ew/occlusion.h>
+#include <ew/shadowMap.h>
+#include <ew/renderTarget.h>
+#include <ew/gpuTimer.h>
+#include <ew/frameCapture.h>
+#include <ew/animation.h>
+#include <ew/particles.h>
+#include <ew/metrics.h>
+#include <ew/readback.h>
+#include <ew/imageWrite.h>
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 GLFWwindow* initWindow(const char* title, int width, int height);
@@ -27,6 +43,61 @@ struct Material {
 	float Shininess = 128;
 };
 
+struct SceneObject {
+	ew::Model* model;
+	ew::Transform transform;
+	//Where it was last frame, so shadows can refresh only the cascades a moving caster touches
+	glm::mat4 lastModelMatrix = glm::mat4(0.0f);
+	ew::AABB lastWorldBounds;
+};
+
+//Built fresh each frame in the frame arena
+struct DrawItem {
+	ew::Model* model;
+	glm::mat4 modelMatrix;
+	ew::AABB bounds; //Model space, in this frame's pose if the model is skinned
+};
+
+struct RenderSettings {
+	bool depthPrePass = true;
+	bool occlusionCulling = true;
+	bool meshletCulling = true;
+	bool shadows = true;
+	bool rotateModel = true;
+	bool animate = true;
+	bool dynamicResolution = true;
+	float renderScale = 1.0f; //Used when dynamic resolution is off
+};
+
+struct ParticleSettings {
+	bool enabled = true;
+	bool drawQuads = true;
+	bool sort = true; //Back to front, only matters for quads
+	float quadSize = 0.05f;
+	float pointSize = 2.0f;
+};
+
+struct CullingStats {
+	int numObjects = 0;
+	int numOccluded = 0;
+	bool cpuDepth = false; //Hi-Z came from the software rasterizer this frame
+	ew::MeshletCullStats meshlets;
+};
+
+//Frames copied back for saving as PNGs. Pixels are copied off the GPU without stalling and encoded on job workers.
+struct ScreenshotState {
+	bool requested = false; //Save the next frame, set by F12 or the UI
+	bool keyWasDown = false;
+	unsigned int numQueued = 0;
+	unsigned int numDropped = 0; //Frames skipped because readbacks or encodes were backed up
+};
+
+struct AllocationCounters {
+	size_t heapAllocationsLastFrame = 0; //From pmr containers only
+	size_t arenaBytesLastFrame = 0;
+	size_t arenaOverflowsLastFrame = 0;
+};
+
 //Global state
 int screenWidth = 1080;
 int screenHeight = 720;
@@ -35,15 +106,97 @@ float deltaTime;
 
 ew::Camera camera;
 ew::CameraController cameraController;
+ew::CascadedShadowMap* shadowMap;
+ew::DynamicResolution dynamicResolution;
+ew::RenderTargetPool* renderTargetPool;
+ew::RenderTarget* sceneTarget;
+ew::GpuTimer* sceneTimer;
+glm::vec3 lightDirection = glm::normalize(glm::vec3(-0.3f, -1.0f, -0.5f));
 Material material;
+RenderSettings renderSettings;
+ParticleSettings particleSettings;
+ew::ParticleEmitter particleEmitter;
+ew::ParticleSimulation particleSimulation;
+CullingStats cullingStats;
+ScreenshotState screenshotState;
+AllocationCounters allocationCounters;
+
+//Readbacks arrive a frame or two late. Older than this and the Hi-Z is rebuilt on the CPU.
+const unsigned int MAX_GPU_DEPTH_AGE = 4;
+
+//Simulation step used during replay, so every run sees the same frame times no matter how fast it renders
+const float REPLAY_TIMESTEP = 1.0f / 60.0f;
+
+int main(int argc, char** argv) {
+	//--capture <file> records camera input and state, --replay <file> plays a capture back without window input,
+	//--timings <file> writes per frame CPU and GPU times,
+	//--metrics <file or udp://host:port> exports metrics periodically, as Prometheus text if the file ends in .prom and JSON lines otherwise,
+	//--screenshots <folder> saves every frame as a PNG
+	const char* capturePath = nullptr;
+	const char* replayPath = nullptr;
+	const char* timingsPath = nullptr;
+	const char* metricsPath = nullptr;
+	const char* screenshotFolder = nullptr;
+	for (int i = 1; i + 1 < argc; i++) {
+		if (strcmp(argv[i], "--capture") == 0) { capturePath = argv[++i]; }
+		else if (strcmp(argv[i], "--replay") == 0) { replayPath = argv[++i]; }
+		else if (strcmp(argv[i], "--timings") == 0) { timingsPath = argv[++i]; }
+		else if (strcmp(argv[i], "--metrics") == 0) { metricsPath = argv[++i]; }
+		else if (strcmp(argv[i], "--screenshots") == 0) { screenshotFolder = argv[++i]; }
+	}
+	std::vector<ew::CapturedFrame> replayFrames;
+	if (replayPath && !ew::loadCapture(replayPath, &replayFrames)) {
+		printf("Failed to load replay %s\n", replayPath);
+		return 1;
+	}
+	ew::CaptureWriter captureWriter;
+	if (capturePath && !replayPath) {
+		captureWriter.open(capturePath);
+	}
+	std::unique_ptr<ew::MetricsExporter> metricsExporter;
+	if (metricsPath) {
+		size_t length = strlen(metricsPath);
+		bool prometheus = length >= 5 && strcmp(metricsPath + length - 5, ".prom") == 0;
+		metricsExporter = std::make_unique<ew::MetricsExporter>(&ew::getMetrics(), metricsPath,
+			prometheus ? ew::MetricsFormat::PROMETHEUS : ew::MetricsFormat::JSON_LINES, 5.0f);
+	}
+	ew::Histogram* frameTimeMetric = ew::getMetrics().getHistogram("ew_frame_time_microseconds", "CPU time per frame, from polling events to swapping buffers");
+	ew::Histogram* gpuFrameTimeMetric = ew::getMetrics().getHistogram("ew_gpu_frame_time_microseconds", "GPU time spent on the scene per frame");
+	ew::Counter* framesMetric = ew::getMetrics().getCounter("ew_frames_total", "Frames rendered");
+	std::vector<ew::FrameTiming> frameTimings;
+	frameTimings.reserve(replayFrames.size());
+	size_t replayFrameIndex = 0;
+	unsigned int numReplayResyncs = 0; //Frames where replaying input didn't reproduce the captured camera
+
+	//Every pmr allocation that reaches the heap goes through here. Other heap allocations aren't counted.
+	ew::CountingResource heapCounter;
+	ew::ScopedDefaultResource defaultResource(&heapCounter);
+	ew::FrameArena frameArena(64 * 1024);
+	ew::Pool<SceneObject> sceneObjectPool;
 
-int main() {
 	GLFWwindow* window = initWindow("Assignment 0", screenWidth, screenHeight);
 	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
+	ew::JobSystem jobSystem;
+	if (screenshotFolder) {
+		std::error_code error;
+		std::filesystem::create_directories(screenshotFolder, error);
+	}
+	//Deep enough that the GPU is always a frame or two ahead of the copies
+	ew::ReadbackQueue screenshotReadback(4);
+	ew::JobCounter screenshotJobs;
+	//Frames waiting to be encoded hold a full copy of the image, so stop queueing once the workers fall this far behind
+	const int maxPendingScreenshots = (int)jobSystem.getNumThreads() * 2;
+	unsigned int frameNumber = 0;
 	ew::Shader shader = ew::Shader("assets/shaders/lit.vert", "assets/shaders/lit.frag");
-	ew::Model monkeyModel = ew::Model("assets/suzanne.obj");
-	ew::Transform monkeyTransform;
+	ew::Shader depthShader = ew::Shader("assets/shaders/depthOnly.vert", "assets/shaders/depthOnly.frag");
+	ew::Shader skinningShader = ew::Shader("assets/shaders/skinning.comp");
+	ew::Shader particleShader = ew::Shader("assets/shaders/particle.vert", "assets/shaders/particle.frag");
+	ew::Model monkeyModel = ew::Model("assets/suzanne.obj", &jobSystem);
+	SceneObject* monkey = sceneObjectPool.create(SceneObject{ &monkeyModel });
+	//Only used if the model has bones
+	ew::AnimationState monkeyAnimation;
+	std::vector<glm::mat4> skinningMatrices(monkeyModel.getSkeleton().getNumJoints());
 
 	//Handles to OpenGL object are unsigned integers
 	GLuint brickTexture = ew::loadTexture("assets/PavingStones143_1K-JPG_Color.jpg");
@@ -58,26 +211,210 @@ int main() {
 	glCullFace(GL_BACK); //Back face culling
 	glEnable(GL_DEPTH_TEST); //Depth testing
 
+	//Occlusion culling tests against last frame's depth, read back without stalling
+	ew::DepthReadback depthReadback;
+	ew::HiZPyramid hiZ;
+	std::vector<float> readbackDepth;
+	//Fallback for frames without GPU depth, small since it only has to catch large occluders
+	ew::DepthRasterizer occluderRasterizer(256, 128);
+	bool hasGpuDepth = false;
+	unsigned int lastGpuDepthFrame = 0;
+
+	ew::ParticleSystem particleSystem(1 << 20, "assets/shaders/");
+	particleEmitter.position = glm::vec3(0.0f, -1.5f, 0.0f);
+
+	ew::CascadedShadowMap cascadedShadowMap(2048, 4);
+	shadowMap = &cascadedShadowMap;
+	//Uniform names for each cascade, built once
+	std::string cascadeSplitNames[ew::CascadedShadowMap::MAX_CASCADES];
+	std::string lightViewProjectionNames[ew::CascadedShadowMap::MAX_CASCADES];
+	for (int i = 0; i < ew::CascadedShadowMap::MAX_CASCADES; i++) {
+		cascadeSplitNames[i] = "_CascadeSplits[" + std::to_string(i) + "]";
+		lightViewProjectionNames[i] = "_LightViewProjection[" + std::to_string(i) + "]";
+	}
+
+	//Scene renders offscreen at a scaled resolution, then gets upscaled to the window
+	ew::RenderTargetPool targetPool;
+	ew::RenderTarget target(&targetPool);
+	ew::GpuTimer gpuTimer;
+	renderTargetPool = &targetPool;
+	sceneTarget = &target;
+	sceneTimer = &gpuTimer;
+
+	if (replayPath) {
+		//Uncapped and at a fixed resolution, so frame times are comparable between builds
+		glfwSwapInterval(0);
+		renderSettings.dynamicResolution = false;
+		renderSettings.renderScale = 1.0f;
+	}
+
 	while (!glfwWindowShouldClose(window)) {
+		size_t heapAllocationsAtFrameStart = heapCounter.getNumAllocations();
+		frameArena.reset();
 		glfwPollEvents();
-		float time = (float)glfwGetTime();
+		double frameStartTime = glfwGetTime();
+		float time = (float)frameStartTime;
 		deltaTime = time - prevFrameTime;
 		prevFrameTime = time;
 
 		// update camera (aspect ratio & position)
 		camera.aspectRatio = (float)screenWidth / screenHeight; // it's not inside framebufferSizeCallback, but it'll do
-		cameraController.move(window, &camera, deltaTime); // cam control before actually using camera for anything
+		if (replayPath) {
+			//Recorded input drives the camera, and the recorded state catches any drift from the capture
+			if (replayFrameIndex >= replayFrames.size()) {
+				break;
+			}
+			const ew::CapturedFrame& frame = replayFrames[replayFrameIndex++];
+			deltaTime = REPLAY_TIMESTEP;
+			if (!ew::replayCapturedFrame(frame, &cameraController, &camera)) {
+				numReplayResyncs++;
+			}
+		}
+		else {
+			ew::CameraInput cameraInput = cameraController.gatherInput(window);
+			cameraController.update(cameraInput, &camera, deltaTime); // cam control before actually using camera for anything
+			if (captureWriter.isOpen()) {
+				captureWriter.write({ deltaTime, cameraInput, cameraController.yaw, cameraController.pitch, camera.position, camera.target });
+			}
+		}
 
 		//Bind brick texture to texture unit 0
 		glBindTextureUnit(0, brickTexture);
 
 		//Rotate model around Y axis
-		monkeyTransform.rotation = glm::rotate(monkeyTransform.rotation, deltaTime, glm::vec3(0.0, 1.0, 0.0));
+		if (renderSettings.rotateModel) {
+			monkey->transform.rotation = glm::rotate(monkey->transform.rotation, deltaTime, glm::vec3(0.0, 1.0, 0.0));
+		}
+
+		//Pose is evaluated on the CPU, then vertices are skinned in place by a compute shader
+		bool animated = renderSettings.animate && monkeyModel.isSkinned() && !monkeyModel.getClips().empty();
+		if (animated) {
+			monkeyAnimation.timeA += deltaTime;
+			ew::evaluateAnimations(monkeyModel.getSkeleton(), monkeyModel.getClips(), &monkeyAnimation, 1, skinningMatrices.data(), &jobSystem, &frameArena);
+			monkeyModel.skin(skinningShader, skinningMatrices.data());
+		}
+
+		if (particleSettings.enabled) {
+			particleSystem.update(deltaTime, particleEmitter, particleSimulation);
+		}
+
+		std::pmr::vector<DrawItem> renderQueue(&frameArena);
+		renderQueue.reserve(sceneObjectPool.getNumAlive());
+		// transform.modelMatrix() combines translation, rotation, and scale into a 4x4 model matrix
+		//Animated limbs can reach outside the bind pose, so occlusion and shadows test the posed bounds
+		ew::AABB monkeyBounds = animated ? monkeyModel.getSkinnedBounds(skinningMatrices.data()) : monkeyModel.getBounds();
+		renderQueue.push_back({ monkey->model, monkey->transform.modelMatrix(), monkeyBounds });
+
+		//Moved casters cover where they were and where they are now, so cascades they left refresh too
+		std::pmr::vector<ew::AABB> movedCasters(&frameArena);
+		{
+			glm::mat4 modelMatrix = renderQueue.back().modelMatrix;
+			ew::AABB bounds = renderQueue.back().bounds.transformed(modelMatrix);
+			if (animated || modelMatrix != monkey->lastModelMatrix) {
+				ew::AABB moved = monkey->lastWorldBounds;
+				moved.expand(bounds);
+				movedCasters.push_back(moved);
+			}
+			monkey->lastModelMatrix = modelMatrix;
+			monkey->lastWorldBounds = bounds;
+		}
+
+		glm::mat4 viewProjection = camera.projectionMatrix() * camera.viewMatrix();
+
+		//OCCLUSION CULLING
+		{
+			int depthWidth, depthHeight;
+			glm::mat4 depthViewProjection;
+			if (depthReadback.poll(&readbackDepth, &depthWidth, &depthHeight, &depthViewProjection)) {
+				hiZ.build(readbackDepth.data(), depthWidth, depthHeight, depthViewProjection);
+				lastGpuDepthFrame = frameNumber;
+				hasGpuDepth = true;
+			}
+			//No GPU depth yet, e.g. on the first frames or right after turning culling on: rasterize the occluders on the CPU instead
+			cullingStats.cpuDepth = !hasGpuDepth || frameNumber - lastGpuDepthFrame > MAX_GPU_DEPTH_AGE;
+			if (renderSettings.occlusionCulling && cullingStats.cpuDepth) {
+				occluderRasterizer.clear();
+				for (const DrawItem& item : renderQueue) {
+					item.model->rasterizeOccluders(&occluderRasterizer, viewProjection * item.modelMatrix);
+				}
+				hiZ.build(occluderRasterizer.getDepth(), occluderRasterizer.getWidth(), occluderRasterizer.getHeight(), viewProjection);
+			}
+		}
+		std::pmr::vector<DrawItem> visibleQueue(&frameArena);
+		visibleQueue.reserve(renderQueue.size());
+		for (const DrawItem& item : renderQueue) {
+			if (renderSettings.occlusionCulling && hiZ.isOccluded(item.bounds, item.modelMatrix)) {
+				continue;
+			}
+			visibleQueue.push_back(item);
+		}
+		cullingStats.numObjects = (int)renderQueue.size();
+		cullingStats.numOccluded = (int)(renderQueue.size() - visibleQueue.size());
+
+		//MESHLET CULLING
+		//Visible objects are culled again per meshlet, and only the surviving triangles are drawn
+		cullingStats.meshlets = ew::MeshletCullStats();
+		if (renderSettings.meshletCulling) {
+			for (const DrawItem& item : visibleQueue) {
+				ew::MeshletCullStats itemStats;
+				item.model->cullMeshlets(item.modelMatrix, camera, &itemStats);
+				cullingStats.meshlets.add(itemStats);
+			}
+		}
+
+		float renderScale = renderSettings.dynamicResolution ? dynamicResolution.update(gpuTimer.getLastMs()) : renderSettings.renderScale;
+		target.resize((int)(screenWidth * renderScale), (int)(screenHeight * renderScale));
+
+		//SHADOW PASS
+		//Casters are drawn from the full queue, since objects hidden from the camera still cast shadows
+		if (renderSettings.shadows) {
+			cascadedShadowMap.update(camera, lightDirection, movedCasters.data(), movedCasters.size());
+			depthShader.use();
+			for (int i = 0; i < cascadedShadowMap.getNumCascades(); i++) {
+				const ew::ShadowCascade& cascade = cascadedShadowMap.getCascade(i);
+				if (!cascade.needsRender) {
+					continue;
+				}
+				cascadedShadowMap.beginCascade(i);
+				depthShader.setMat4("_ViewProjection", cascade.lightViewProjection);
+				for (const DrawItem& item : renderQueue) {
+					depthShader.setMat4("_Model", item.modelMatrix);
+					item.model->draw();
+				}
+				cascadedShadowMap.endCascade(i);
+			}
+		}
+		else {
+			cascadedShadowMap.invalidate();
+		}
 
 		//RENDER
+		//Timed from here, since shadow cost doesn't change with render scale and would throw off dynamic resolution
+		gpuTimer.begin();
+		target.bind();
 		glClearColor(0.6f,0.8f,0.92f,1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+		//DEPTH PRE-PASS
+		//Lays down depth first so the lit shader only runs once per pixel
+		if (renderSettings.depthPrePass) {
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			depthShader.use();
+			depthShader.setMat4("_ViewProjection", viewProjection);
+			for (const DrawItem& item : visibleQueue) {
+				depthShader.setMat4("_Model", item.modelMatrix);
+				if (renderSettings.meshletCulling) {
+					item.model->drawCulled();
+				}
+				else {
+					item.model->draw();
+				}
+			}
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			glDepthFunc(GL_LEQUAL);
+			glDepthMask(GL_FALSE);
+		}
+
 		shader.use();
 
 		shader.setInt("_MainTex", 0);
@@ -87,15 +424,128 @@ int main() {
 		shader.setFloat("_Material.Shininess", material.Shininess);
 
 		shader.setVec3("_EyePos", camera.position);
-		// transform.modelMatrix() combines translation, rotation, and scale into a 4x4 model matrix
-		shader.setMat4("_Model", monkeyTransform.modelMatrix());
-		shader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
-
-		monkeyModel.draw(); //Draws monkey model using current shader
+		shader.setMat4("_ViewProjection", viewProjection);
+		shader.setVec3("_LightDirection", lightDirection);
+
+		//Shadow map is always bound so its sampler never shares a unit with _MainTex
+		glBindTextureUnit(1, cascadedShadowMap.getTexture());
+		shader.setInt("_ShadowMap", 1);
+		shader.setInt("_ShadowsEnabled", renderSettings.shadows);
+		shader.setInt("_NumCascades", cascadedShadowMap.getNumCascades());
+		shader.setVec3("_CameraForward", glm::normalize(camera.target - camera.position));
+		for (int i = 0; i < cascadedShadowMap.getNumCascades(); i++) {
+			shader.setFloat(cascadeSplitNames[i].c_str(), cascadedShadowMap.getCascade(i).splitFar);
+			shader.setMat4(lightViewProjectionNames[i].c_str(), cascadedShadowMap.getCascade(i).lightViewProjection);
+		}
+
+		for (const DrawItem& item : visibleQueue) {
+			shader.setMat4("_Model", item.modelMatrix);
+			//Draws model using current shader
+			if (renderSettings.meshletCulling) {
+				item.model->drawCulled();
+			}
+			else {
+				item.model->draw();
+			}
+		}
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+
+		//PARTICLES
+		//Blended over the opaque scene. They depth test against it but don't write depth.
+		if (particleSettings.enabled) {
+			ew::ParticleDrawMode particleDrawMode = particleSettings.drawQuads ? ew::ParticleDrawMode::QUADS : ew::ParticleDrawMode::POINTS;
+			glm::mat4 view = camera.viewMatrix();
+			if (particleSettings.drawQuads && particleSettings.sort) {
+				particleSystem.sort(view);
+			}
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			glEnable(GL_PROGRAM_POINT_SIZE);
+			glDepthMask(GL_FALSE);
+			particleShader.use();
+			particleShader.setMat4("_ViewProjection", viewProjection);
+			particleShader.setVec3("_CameraRight", glm::vec3(view[0][0], view[1][0], view[2][0]));
+			particleShader.setVec3("_CameraUp", glm::vec3(view[0][1], view[1][1], view[2][1]));
+			particleShader.setFloat("_ParticleSize", particleSettings.quadSize);
+			particleShader.setFloat("_PointSize", particleSettings.pointSize);
+			particleSystem.draw(particleShader, particleDrawMode);
+			glDepthMask(GL_TRUE);
+			glDisable(GL_PROGRAM_POINT_SIZE);
+			glDisable(GL_BLEND);
+		}
+
+		if (renderSettings.occlusionCulling) {
+			depthReadback.request(target.getWidth(), target.getHeight(), viewProjection);
+		}
+		gpuTimer.end();
+
+		//SCREENSHOTS
+		//Scene only, at render resolution, without the UI
+		bool keyDown = glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS;
+		screenshotState.requested |= keyDown && !screenshotState.keyWasDown;
+		screenshotState.keyWasDown = keyDown;
+		if (screenshotFolder || screenshotState.requested) {
+			char fileName[64];
+			snprintf(fileName, sizeof(fileName), screenshotFolder ? "frame_%05u.png" : "screenshot_%05u.png", frameNumber);
+			std::string path = screenshotFolder ? (std::filesystem::path(screenshotFolder) / fileName).string() : std::string(fileName);
+			auto saveScreenshot = [&jobSystem, &screenshotJobs, path](const ew::ReadbackResult& result) {
+				//Jobs are std::functions, which must be copyable, so the pixels are shared instead of moved in
+				auto pixels = std::make_shared<std::vector<unsigned char>>((const unsigned char*)result.data, (const unsigned char*)result.data + result.size);
+				int width = result.width, height = result.height;
+				jobSystem.run([pixels, width, height, path]() {
+					ew::writePng(path, pixels->data(), width, height, 3, true);
+				}, &screenshotJobs);
+			};
+			bool backedUp = screenshotJobs.value.load(std::memory_order_relaxed) + screenshotReadback.getNumInFlight() >= maxPendingScreenshots;
+			if (!backedUp && screenshotReadback.readTexture(target.getColorTexture(), 0, target.getWidth(), target.getHeight(), GL_RGB, GL_UNSIGNED_BYTE, saveScreenshot)) {
+				screenshotState.numQueued++;
+				screenshotState.requested = false;
+			}
+			else {
+				screenshotState.numDropped++;
+			}
+		}
+
+		//UI draws at full resolution on top of the upscaled scene
+		target.blitToScreen(screenWidth, screenHeight);
+
+		allocationCounters.arenaBytesLastFrame = frameArena.getUsed();
+		allocationCounters.arenaOverflowsLastFrame = frameArena.getNumOverflowAllocations();
+		allocationCounters.heapAllocationsLastFrame = heapCounter.getNumAllocations() - heapAllocationsAtFrameStart;
 		drawUI();
 
 		glfwSwapBuffers(window);
+		screenshotReadback.poll();
+		frameNumber++;
+		float frameMs = (float)((glfwGetTime() - frameStartTime) * 1000.0);
+		frameTimeMetric->record((uint64_t)(frameMs * 1000.0f));
+		gpuFrameTimeMetric->record((uint64_t)(gpuTimer.getLastMs() * 1000.0f));
+		framesMetric->add();
+		if (replayPath || timingsPath) {
+			frameTimings.push_back({ frameMs, gpuTimer.getLastMs() });
+		}
 	}
+	//Wait for the last few frames to come back and finish encoding
+	screenshotReadback.flush();
+	jobSystem.wait(&screenshotJobs);
+	if (screenshotState.numQueued > 0 || screenshotState.numDropped > 0) {
+		printf("Saved %u screenshots, dropped %u\n", screenshotState.numQueued, screenshotState.numDropped);
+	}
+	if (captureWriter.isOpen()) {
+		printf("Captured %u frames to %s\n", captureWriter.getNumFrames(), capturePath);
+		captureWriter.close();
+	}
+	if (replayPath) {
+		if (numReplayResyncs > 0) {
+			printf("Camera drifted from the capture on %u frames and was snapped back\n", numReplayResyncs);
+		}
+		ew::printTimingSummary(frameTimings);
+	}
+	if (timingsPath) {
+		ew::writeTimingsCsv(timingsPath, frameTimings);
+	}
+	sceneObjectPool.destroy(monkey);
 	printf("Shutting down...");
 }
 
@@ -107,12 +557,61 @@ void drawUI() {
 	ImGui::Begin("Settings");
 
 	if(ImGui::Button("Reset Camera")) { resetCamera(&camera, &cameraController); }
+	ImGui::SameLine();
+	if(ImGui::Button("Screenshot (F12)")) { screenshotState.requested = true; }
 	if(ImGui::CollapsingHeader("Material")) {
 		ImGui::SliderFloat("AmbientK", &material.Ka, 0.0f, 1.0f);
 		ImGui::SliderFloat("DiffuseK", &material.Kd, 0.0f, 1.0f);
 		ImGui::SliderFloat("SpecularK", &material.Ks, 0.0f, 1.0f);
 		ImGui::SliderFloat("Shininess", &material.Shininess, 2.0f, 1024.0f);
 	}
+	if (ImGui::CollapsingHeader("Rendering")) {
+		ImGui::Checkbox("Depth pre-pass", &renderSettings.depthPrePass);
+		ImGui::Checkbox("Occlusion culling", &renderSettings.occlusionCulling);
+		ImGui::Text("Occluded: %d / %d (%s depth)", cullingStats.numOccluded, cullingStats.numObjects, cullingStats.cpuDepth ? "CPU" : "GPU");
+		ImGui::Checkbox("Meshlet culling", &renderSettings.meshletCulling);
+		if (renderSettings.meshletCulling) {
+			const ew::MeshletCullStats& meshletStats = cullingStats.meshlets;
+			ImGui::Text("Meshlets: %u frustum, %u backface / %u", meshletStats.numFrustumCulled, meshletStats.numBackfaceCulled, meshletStats.numMeshlets);
+			ImGui::Text("Triangles rejected: %.1f%%", meshletStats.rejectedFraction() * 100.0f);
+		}
+		ImGui::Checkbox("Dynamic resolution", &renderSettings.dynamicResolution);
+		if (renderSettings.dynamicResolution) {
+			ImGui::SliderFloat("Target ms", &dynamicResolution.targetFrameTimeMs, 2.0f, 33.3f);
+			ImGui::SliderFloat("Min scale", &dynamicResolution.minScale, 0.25f, 1.0f);
+		}
+		else {
+			ImGui::SliderFloat("Render scale", &renderSettings.renderScale, 0.25f, 2.0f);
+		}
+		ImGui::Text("Scene: %dx%d  %.2f ms GPU", sceneTarget->getWidth(), sceneTarget->getHeight(), sceneTimer->getLastMs());
+		ImGui::Text("Pooled attachments: %zu", renderTargetPool->getNumTextures());
+	}
+	if (ImGui::CollapsingHeader("Shadows")) {
+		ImGui::Checkbox("Enabled", &renderSettings.shadows);
+		ImGui::Checkbox("Rotate model", &renderSettings.rotateModel);
+		ImGui::Checkbox("Animate", &renderSettings.animate);
+		ImGui::SliderFloat("Split lambda", &shadowMap->splitLambda, 0.0f, 1.0f);
+		ImGui::SliderInt("Far cascade interval", &shadowMap->farCascadeInterval, 1, 16);
+		//GPU cost of each cascade, and whether it was re-rendered or reused this frame
+		for (int i = 0; i < shadowMap->getNumCascades(); i++) {
+			const ew::ShadowCascade& cascade = shadowMap->getCascade(i);
+			ImGui::Text("Cascade %d: %.1f-%.1f  %s  %.3f ms", i, cascade.splitNear, cascade.splitFar,
+				cascade.needsRender ? "rendered" : "cached", cascade.gpuTimeMs);
+		}
+	}
+	if (ImGui::CollapsingHeader("Particles")) {
+		ImGui::Checkbox("Simulate", &particleSettings.enabled);
+		ImGui::Checkbox("Quads", &particleSettings.drawQuads);
+		ImGui::Checkbox("Sort", &particleSettings.sort);
+		ImGui::SliderFloat("Emit rate", &particleEmitter.rate, 0.0f, 1000000.0f, "%.0f");
+		ImGui::SliderFloat("Quad size", &particleSettings.quadSize, 0.005f, 0.5f);
+		ImGui::SliderFloat("Drag", &particleSimulation.drag, 0.0f, 2.0f);
+	}
+	if (ImGui::CollapsingHeader("Memory")) {
+		ImGui::Text("pmr heap allocations: %zu", allocationCounters.heapAllocationsLastFrame);
+		ImGui::Text("Frame arena: %zu bytes", allocationCounters.arenaBytesLastFrame);
+		ImGui::Text("Arena overflows: %zu", allocationCounters.arenaOverflowsLastFrame);
+	}
 
 	ImGui::End();
 
@@ -125,6 +624,10 @@ void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 	glViewport(0, 0, width, height);
 	screenWidth = width;
 	screenHeight = height;
+	//Sizes from before the resize won't come back, so free the attachments cached for them
+	if (renderTargetPool) {
+		renderTargetPool->trim();
+	}
 }
 
 void resetCamera(ew::Camera* camera, ew::CameraController* controller) {
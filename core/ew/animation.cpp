@@ -0,0 +1,438 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include "animation.h"
+#include "jobSystem.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <math.h>
+#include <new>
+
+//SSE2 is baseline on x64, so this only falls back to scalar code on other targets or old 32 bit builds
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EW_ANIMATION_SSE
+#include <emmintrin.h>
+#endif
+
+namespace ew {
+	void Pose::resize(size_t numJoints)
+	{
+		translations.resize(numJoints);
+		rotations.resize(numJoints);
+		scales.resize(numJoints);
+	}
+
+	int Skeleton::findJoint(const std::string& name) const
+	{
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			if (names[i] == name) {
+				return (int)i;
+			}
+		}
+		return -1;
+	}
+
+	static float wrapTime(const AnimationClip& clip, float time, bool loop)
+	{
+		if (clip.duration <= 0.0f) {
+			return 0.0f;
+		}
+		if (loop) {
+			time = fmodf(time, clip.duration);
+			return time < 0.0f ? time + clip.duration : time;
+		}
+		return std::clamp(time, 0.0f, clip.duration);
+	}
+
+	//Index of the key at or before time, and how far towards the next key time is.
+	//The key at hint and the one after are tried before falling back to a binary search.
+	static unsigned int findKey(const float* times, unsigned int count, float time, unsigned int hint, float* t)
+	{
+		unsigned int key;
+		if (hint < count && times[hint] <= time && (hint + 1 == count || time < times[hint + 1])) {
+			key = hint;
+		}
+		else if (hint + 1 < count && times[hint + 1] <= time && (hint + 2 == count || time < times[hint + 2])) {
+			key = hint + 1;
+		}
+		else {
+			const float* next = std::upper_bound(times, times + count, time);
+			if (next == times) {
+				*t = 0.0f;
+				return 0;
+			}
+			key = (unsigned int)(next - times) - 1;
+		}
+		if (key + 1 == count) {
+			*t = 0.0f;
+			return key;
+		}
+		float span = times[key + 1] - times[key];
+		*t = span > 0.0f ? (time - times[key]) / span : 0.0f;
+		return key;
+	}
+
+#ifdef EW_ANIMATION_SSE
+	//Every lane holds the sum of the four lanes of v
+	static inline __m128 horizontalSum(__m128 v)
+	{
+		__m128 sums = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_add_ps(sums, _mm_shuffle_ps(sums, sums, _MM_SHUFFLE(1, 0, 3, 2)));
+	}
+
+	//Same as the scalar nlerp, on a whole quaternion at once. Component order doesn't matter.
+	static inline __m128 nlerp(__m128 a, __m128 b, float t)
+	{
+		__m128 sign = _mm_and_ps(horizontalSum(_mm_mul_ps(a, b)), _mm_set1_ps(-0.0f));
+		__m128 tb = _mm_xor_ps(_mm_set1_ps(t), sign);
+		__m128 q = _mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(1.0f - t)), _mm_mul_ps(b, tb));
+		return _mm_div_ps(q, _mm_sqrt_ps(horizontalSum(_mm_mul_ps(q, q))));
+	}
+#endif
+
+	//Normalized lerp along the shortest arc. Close enough to slerp between neighboring keys and far cheaper.
+	static glm::quat nlerp(const glm::quat& a, const glm::quat& b, float t)
+	{
+		glm::quat q;
+#ifdef EW_ANIMATION_SSE
+		_mm_storeu_ps(&q.x, nlerp(_mm_loadu_ps(&a.x), _mm_loadu_ps(&b.x), t));
+#else
+		float d = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+		float tb = d < 0.0f ? -t : t;
+		float ta = 1.0f - t;
+		q.x = a.x * ta + b.x * tb;
+		q.y = a.y * ta + b.y * tb;
+		q.z = a.z * ta + b.z * tb;
+		q.w = a.w * ta + b.w * tb;
+		float invLength = 1.0f / sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+		q.x *= invLength;
+		q.y *= invLength;
+		q.z *= invLength;
+		q.w *= invLength;
+#endif
+		return q;
+	}
+
+	//out = a * b. out may alias a or b.
+	static inline void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4* out)
+	{
+#ifdef EW_ANIMATION_SSE
+		const float* pa = &a[0].x;
+		__m128 a0 = _mm_loadu_ps(pa);
+		__m128 a1 = _mm_loadu_ps(pa + 4);
+		__m128 a2 = _mm_loadu_ps(pa + 8);
+		__m128 a3 = _mm_loadu_ps(pa + 12);
+		for (int i = 0; i < 4; i++)
+		{
+			//Each column of the result is a's columns weighted by one column of b
+			const float* column = &b[i].x;
+			__m128 r = _mm_mul_ps(a0, _mm_set1_ps(column[0]));
+			r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(column[1])));
+			r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(column[2])));
+			r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(column[3])));
+			_mm_storeu_ps(&(*out)[i].x, r);
+		}
+#else
+		*out = a * b;
+#endif
+	}
+
+	/// <summary>
+	/// Samples a clip into a pose. Joints without keys in a channel keep the skeleton's rest pose.
+	/// </summary>
+	/// <param name="skeleton">Skeleton the clip was imported with</param>
+	/// <param name="clip">Clip to sample</param>
+	/// <param name="time">Seconds since the clip started</param>
+	/// <param name="loop">Wrap time around the clip duration instead of clamping</param>
+	/// <param name="pose">Resized to the skeleton's joint count</param>
+	/// <param name="cursors">Optional, one per joint. Where the search for each key starts, updated to the key found.</param>
+	void samplePose(const Skeleton& skeleton, const AnimationClip& clip, float time, bool loop, Pose* pose, KeyCursor* cursors)
+	{
+		size_t numJoints = skeleton.getNumJoints();
+		pose->resize(numJoints);
+		time = wrapTime(clip, time, loop);
+		float t;
+		KeyCursor noCursor;
+		for (size_t i = 0; i < numJoints; i++)
+		{
+			const AnimationClip::Track* track = i < clip.tracks.size() ? &clip.tracks[i] : nullptr;
+			KeyCursor& cursor = cursors != nullptr ? cursors[i] : noCursor;
+			if (track && track->translationCount > 0) {
+				unsigned int key = findKey(&clip.translationTimes[track->translationBegin], track->translationCount, time, cursor.translation, &t);
+				const glm::vec3* keys = &clip.translationKeys[track->translationBegin];
+				unsigned int next = std::min(key + 1, track->translationCount - 1);
+				pose->translations[i] = keys[key] + (keys[next] - keys[key]) * t;
+				cursor.translation = key;
+			}
+			else {
+				pose->translations[i] = skeleton.restPose.translations[i];
+			}
+			if (track && track->rotationCount > 0) {
+				unsigned int key = findKey(&clip.rotationTimes[track->rotationBegin], track->rotationCount, time, cursor.rotation, &t);
+				const glm::quat* keys = &clip.rotationKeys[track->rotationBegin];
+				unsigned int next = std::min(key + 1, track->rotationCount - 1);
+				pose->rotations[i] = nlerp(keys[key], keys[next], t);
+				cursor.rotation = key;
+			}
+			else {
+				pose->rotations[i] = skeleton.restPose.rotations[i];
+			}
+			if (track && track->scaleCount > 0) {
+				unsigned int key = findKey(&clip.scaleTimes[track->scaleBegin], track->scaleCount, time, cursor.scale, &t);
+				const glm::vec3* keys = &clip.scaleKeys[track->scaleBegin];
+				unsigned int next = std::min(key + 1, track->scaleCount - 1);
+				pose->scales[i] = keys[key] + (keys[next] - keys[key]) * t;
+				cursor.scale = key;
+			}
+			else {
+				pose->scales[i] = skeleton.restPose.scales[i];
+			}
+		}
+	}
+
+	/// <summary>
+	/// Blends two poses. Translations and scales are flat float arrays blended four at a time,
+	/// and each rotation is one four wide nlerp.
+	/// </summary>
+	void blendPoses(const Pose& a, const Pose& b, float weight, Pose* out)
+	{
+		size_t numJoints = std::min(a.getNumJoints(), b.getNumJoints());
+		out->resize(numJoints);
+		if (numJoints == 0) {
+			return;
+		}
+		float wa = 1.0f - weight;
+		const float* ta = &a.translations[0].x;
+		const float* tb = &b.translations[0].x;
+		const float* sa = &a.scales[0].x;
+		const float* sb = &b.scales[0].x;
+		float* tOut = &out->translations[0].x;
+		float* sOut = &out->scales[0].x;
+		size_t numFloats = numJoints * 3;
+		size_t i = 0;
+#ifdef EW_ANIMATION_SSE
+		__m128 wa4 = _mm_set1_ps(wa);
+		__m128 wb4 = _mm_set1_ps(weight);
+		for (; i + 4 <= numFloats; i += 4)
+		{
+			_mm_storeu_ps(tOut + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(ta + i), wa4), _mm_mul_ps(_mm_loadu_ps(tb + i), wb4)));
+			_mm_storeu_ps(sOut + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(sa + i), wa4), _mm_mul_ps(_mm_loadu_ps(sb + i), wb4)));
+		}
+#endif
+		for (; i < numFloats; i++)
+		{
+			tOut[i] = ta[i] * wa + tb[i] * weight;
+			sOut[i] = sa[i] * wa + sb[i] * weight;
+		}
+		for (size_t j = 0; j < numJoints; j++)
+		{
+			out->rotations[j] = nlerp(a.rotations[j], b.rotations[j], weight);
+		}
+	}
+
+	//Translation * rotation * scale, built directly from the quaternion
+	static glm::mat4 composeTransform(const glm::vec3& t, const glm::quat& q, const glm::vec3& s)
+	{
+		float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+		float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+		float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+		glm::mat4 m;
+		m[0] = glm::vec4(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f) * s.x;
+		m[1] = glm::vec4(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f) * s.y;
+		m[2] = glm::vec4(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f) * s.z;
+		m[3] = glm::vec4(t, 1.0f);
+		return m;
+	}
+
+	void computeSkinningMatrices(const Skeleton& skeleton, const Pose& pose, glm::mat4* skinningMatrices)
+	{
+		size_t numJoints = skeleton.getNumJoints();
+		//Global transforms first. Parents precede children, so theirs are always ready.
+		for (size_t i = 0; i < numJoints; i++)
+		{
+			glm::mat4 local = composeTransform(pose.translations[i], pose.rotations[i], pose.scales[i]);
+			int parent = skeleton.parents[i];
+			if (parent < 0) {
+				skinningMatrices[i] = local;
+			}
+			else {
+				multiply(skinningMatrices[parent], local, &skinningMatrices[i]);
+			}
+		}
+		for (size_t i = 0; i < numJoints; i++)
+		{
+			multiply(skinningMatrices[i], skeleton.inverseBindMatrices[i], &skinningMatrices[i]);
+			multiply(skeleton.globalInverse, skinningMatrices[i], &skinningMatrices[i]);
+		}
+	}
+
+	static const AnimationClip* getClip(const std::vector<AnimationClip>& clips, int index)
+	{
+		return index >= 0 && index < (int)clips.size() ? &clips[index] : nullptr;
+	}
+
+	/// <summary>
+	/// Samples, blends and resolves skinning matrices for many instances, spread across the job system.
+	/// Each batch reuses its scratch poses, so the per instance cost is just the math.
+	/// </summary>
+	/// <param name="skeleton">Skeleton shared by every instance</param>
+	/// <param name="clips">Clips the states index into</param>
+	/// <param name="states">One per instance. Key cursors are sized and updated, nothing else changes.</param>
+	/// <param name="numStates">Number of instances</param>
+	/// <param name="skinningMatrices">numStates * skeleton.getNumJoints() matrices</param>
+	/// <param name="jobSystem">Optional. Instances are split across workers.</param>
+	/// <param name="scratch">Where the scratch poses come from. Only used on the calling thread, so a FrameArena works.</param>
+	void evaluateAnimations(const Skeleton& skeleton, const std::vector<AnimationClip>& clips, AnimationState* states, size_t numStates,
+		glm::mat4* skinningMatrices, JobSystem* jobSystem, std::pmr::memory_resource* scratch)
+	{
+		if (numStates == 0) {
+			return;
+		}
+		size_t numJoints = skeleton.getNumJoints();
+		const size_t GRAIN_SIZE = 16;
+		size_t numBatches = jobSystem != nullptr ? (numStates + GRAIN_SIZE - 1) / GRAIN_SIZE : 1;
+		//Two poses per batch, allocated up front since scratch resources like arenas aren't thread safe
+		Pose* poses = static_cast<Pose*>(scratch->allocate(sizeof(Pose) * numBatches * 2, alignof(Pose)));
+		for (size_t i = 0; i < numBatches * 2; i++)
+		{
+			new (&poses[i]) Pose(scratch);
+			poses[i].resize(numJoints);
+		}
+		auto evaluateRange = [&](size_t begin, size_t end) {
+			Pose& poseA = poses[begin / GRAIN_SIZE * 2];
+			Pose& poseB = poses[begin / GRAIN_SIZE * 2 + 1];
+			for (size_t i = begin; i < end; i++)
+			{
+				AnimationState& state = states[i];
+				const AnimationClip* clipA = getClip(clips, state.clipA);
+				const AnimationClip* clipB = getClip(clips, state.clipB);
+				if (clipA) {
+					//Only allocates the first time an instance is evaluated
+					if (state.cursorsA.size() != numJoints) {
+						state.cursorsA.resize(numJoints);
+					}
+					samplePose(skeleton, *clipA, state.timeA, state.loop, &poseA, state.cursorsA.data());
+				}
+				else {
+					poseA = skeleton.restPose;
+				}
+				if (clipB && state.blend > 0.0f) {
+					if (state.cursorsB.size() != numJoints) {
+						state.cursorsB.resize(numJoints);
+					}
+					samplePose(skeleton, *clipB, state.timeB, state.loop, &poseB, state.cursorsB.data());
+					blendPoses(poseA, poseB, state.blend, &poseA);
+				}
+				computeSkinningMatrices(skeleton, poseA, skinningMatrices + i * numJoints);
+			}
+		};
+		if (jobSystem != nullptr) {
+			jobSystem->parallelFor(numStates, GRAIN_SIZE, evaluateRange);
+		}
+		else {
+			//Batch 0 covers everything
+			evaluateRange(0, numStates);
+		}
+		for (size_t i = 0; i < numBatches * 2; i++)
+		{
+			poses[i].~Pose();
+		}
+		scratch->deallocate(poses, sizeof(Pose) * numBatches * 2, alignof(Pose));
+	}
+
+	static glm::quat sampleRotationReference(const AnimationClip& clip, const AnimationClip::Track& track, float time)
+	{
+		for (unsigned int k = 0; k + 1 < track.rotationCount; k++)
+		{
+			float t0 = clip.rotationTimes[track.rotationBegin + k];
+			float t1 = clip.rotationTimes[track.rotationBegin + k + 1];
+			if (time < t1) {
+				float t = time <= t0 ? 0.0f : (time - t0) / (t1 - t0);
+				return glm::slerp(clip.rotationKeys[track.rotationBegin + k], clip.rotationKeys[track.rotationBegin + k + 1], t);
+			}
+		}
+		return clip.rotationKeys[track.rotationBegin + track.rotationCount - 1];
+	}
+
+	static glm::vec3 sampleVec3Reference(const std::vector<float>& times, const std::vector<glm::vec3>& keys, unsigned int begin, unsigned int count, float time)
+	{
+		for (unsigned int k = 0; k + 1 < count; k++)
+		{
+			float t0 = times[begin + k];
+			float t1 = times[begin + k + 1];
+			if (time < t1) {
+				float t = time <= t0 ? 0.0f : (time - t0) / (t1 - t0);
+				return glm::mix(keys[begin + k], keys[begin + k + 1], t);
+			}
+		}
+		return keys[begin + count - 1];
+	}
+
+	static void sampleLocalReference(const Skeleton& skeleton, const AnimationClip* clip, float time, bool loop, size_t joint,
+		glm::vec3* translation, glm::quat* rotation, glm::vec3* scale)
+	{
+		*translation = skeleton.restPose.translations[joint];
+		*rotation = skeleton.restPose.rotations[joint];
+		*scale = skeleton.restPose.scales[joint];
+		if (clip && joint < clip->tracks.size()) {
+			const AnimationClip::Track& track = clip->tracks[joint];
+			time = wrapTime(*clip, time, loop);
+			if (track.translationCount > 0) {
+				*translation = sampleVec3Reference(clip->translationTimes, clip->translationKeys, track.translationBegin, track.translationCount, time);
+			}
+			if (track.rotationCount > 0) {
+				*rotation = sampleRotationReference(*clip, track, time);
+			}
+			if (track.scaleCount > 0) {
+				*scale = sampleVec3Reference(clip->scaleTimes, clip->scaleKeys, track.scaleBegin, track.scaleCount, time);
+			}
+		}
+	}
+
+	void evaluateAnimationReference(const Skeleton& skeleton, const std::vector<AnimationClip>& clips, const AnimationState& state,
+		glm::mat4* skinningMatrices)
+	{
+		const AnimationClip* clipA = getClip(clips, state.clipA);
+		const AnimationClip* clipB = getClip(clips, state.clipB);
+		std::vector<glm::mat4> globals(skeleton.getNumJoints());
+		for (size_t i = 0; i < skeleton.getNumJoints(); i++)
+		{
+			glm::vec3 translation, scale;
+			glm::quat rotation;
+			sampleLocalReference(skeleton, clipA, state.timeA, state.loop, i, &translation, &rotation, &scale);
+			if (clipB && state.blend > 0.0f) {
+				glm::vec3 translationB, scaleB;
+				glm::quat rotationB;
+				sampleLocalReference(skeleton, clipB, state.timeB, state.loop, i, &translationB, &rotationB, &scaleB);
+				translation = glm::mix(translation, translationB, state.blend);
+				//Blending is defined as normalized lerp, same as blendPoses. Slerp would differ noticeably for large angles.
+				glm::quat nearestB = glm::dot(rotation, rotationB) < 0.0f ? -rotationB : rotationB;
+				rotation = glm::normalize(rotation * (1.0f - state.blend) + nearestB * state.blend);
+				scale = glm::mix(scale, scaleB, state.blend);
+			}
+			glm::mat4 local = glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+			int parent = skeleton.parents[i];
+			globals[i] = parent < 0 ? local : globals[parent] * local;
+			skinningMatrices[i] = skeleton.globalInverse * globals[i] * skeleton.inverseBindMatrices[i];
+		}
+	}
+
+	void skinVerticesReference(const Vertex* bindVertices, const SkinWeights& skin, const glm::mat4* skinningMatrices, size_t numVertices, Vertex* out)
+	{
+		for (size_t i = 0; i < numVertices; i++)
+		{
+			glm::mat4 m = glm::mat4(0.0f);
+			for (int j = 0; j < MAX_BONE_INFLUENCES; j++)
+			{
+				m = m + skinningMatrices[skin.joints[i][j]] * skin.weights[i][j];
+			}
+			out[i] = bindVertices[i];
+			out[i].pos = glm::vec3(m * glm::vec4(bindVertices[i].pos, 1.0f));
+			//Matches the shader: no inverse transpose, so non-uniform joint scale skews normals slightly
+			out[i].normal = glm::normalize(glm::vec3(m * glm::vec4(bindVertices[i].normal, 0.0f)));
+			out[i].tangent = glm::vec4(glm::normalize(glm::vec3(m * glm::vec4(glm::vec3(bindVertices[i].tangent), 0.0f))), bindVertices[i].tangent.w);
+		}
+	}
+}
@@ -0,0 +1,110 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include "mesh.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+namespace ew {
+	static const int MAX_BONE_INFLUENCES = 4;
+
+	//Local joint transforms, one array per channel so sampling and blending run down contiguous memory
+	struct Pose {
+		Pose() : Pose(std::pmr::get_default_resource()) {};
+		explicit Pose(std::pmr::memory_resource* resource) : translations(resource), rotations(resource), scales(resource) {};
+		std::pmr::vector<glm::vec3> translations;
+		std::pmr::vector<glm::quat> rotations;
+		std::pmr::vector<glm::vec3> scales;
+		void resize(size_t numJoints);
+		inline size_t getNumJoints()const { return rotations.size(); }
+	};
+
+	/// <summary>
+	/// Joint hierarchy, stored as parallel arrays.
+	/// Parents always come before their children, so global transforms resolve in one pass front to back.
+	/// </summary>
+	struct Skeleton {
+		std::vector<std::string> names;
+		std::vector<int> parents; //-1 for the root
+		std::vector<glm::mat4> inverseBindMatrices; //Mesh space to joint space. Identity for joints no vertex uses.
+		Pose restPose; //Used for joints a clip doesn't animate
+		glm::mat4 globalInverse = glm::mat4(1.0f); //Undoes the scene root transform
+		inline size_t getNumJoints()const { return parents.size(); }
+		//Returns -1 if no joint has this name
+		int findJoint(const std::string& name)const;
+	};
+
+	/// <summary>
+	/// Keyframes of every joint in one clip. Keys of all joints share flat arrays,
+	/// and each joint's track is a range into them. Times are in seconds.
+	/// </summary>
+	struct AnimationClip {
+		struct Track {
+			unsigned int translationBegin = 0, translationCount = 0;
+			unsigned int rotationBegin = 0, rotationCount = 0;
+			unsigned int scaleBegin = 0, scaleCount = 0;
+		};
+		std::string name;
+		float duration = 0.0f;
+		std::vector<Track> tracks; //One per joint. Empty channels fall back to the rest pose.
+		std::vector<float> translationTimes;
+		std::vector<glm::vec3> translationKeys;
+		std::vector<float> rotationTimes;
+		std::vector<glm::quat> rotationKeys;
+		std::vector<float> scaleTimes;
+		std::vector<glm::vec3> scaleKeys;
+	};
+
+	//Up to four joints per vertex, in parallel arrays laid out to upload straight into a std430 buffer
+	struct SkinWeights {
+		std::vector<glm::uvec4> joints;
+		std::vector<glm::vec4> weights; //Sum to 1
+	};
+
+	//Key each channel of a joint was last sampled at. Time mostly moves forward a little each frame,
+	//so the next sample finds its key in one or two compares instead of a binary search.
+	struct KeyCursor {
+		unsigned int translation = 0;
+		unsigned int rotation = 0;
+		unsigned int scale = 0;
+	};
+
+	//What one animated instance is playing. clipB < 0 plays clipA alone.
+	struct AnimationState {
+		int clipA = 0;
+		float timeA = 0.0f;
+		int clipB = -1;
+		float timeB = 0.0f;
+		float blend = 0.0f; //0 = all clipA, 1 = all clipB
+		bool loop = true;
+		//One per joint, filled in by evaluateAnimations. Any values are safe, stale ones just cost a search.
+		std::vector<KeyCursor> cursorsA;
+		std::vector<KeyCursor> cursorsB;
+	};
+
+	//Samples every joint of a clip at time. Looping clips wrap, others clamp.
+	//cursors is optional, one per joint, and updated to the keys that were sampled.
+	void samplePose(const Skeleton& skeleton, const AnimationClip& clip, float time, bool loop, Pose* pose, KeyCursor* cursors = nullptr);
+	//out = lerp(a, b, weight), with rotations normalized-lerped along the shortest arc. out may alias a or b.
+	void blendPoses(const Pose& a, const Pose& b, float weight, Pose* out);
+	//Resolves the hierarchy and writes one skinning matrix per joint
+	void computeSkinningMatrices(const Skeleton& skeleton, const Pose& pose, glm::mat4* skinningMatrices);
+	/// <summary>
+	/// Evaluates many instances at once. Writes skeleton.getNumJoints() matrices per instance, in instance order.
+	/// Scratch poses come from scratch, e.g. a FrameArena, and only the states' key cursors are written.
+	/// </summary>
+	void evaluateAnimations(const Skeleton& skeleton, const std::vector<AnimationClip>& clips, AnimationState* states, size_t numStates,
+		glm::mat4* skinningMatrices, JobSystem* jobSystem = nullptr, std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+	//Straightforward single instance evaluation with slerp between keys and full matrices.
+	//Slow, but easy to trust when checking the fast path, which should match it to within about 1e-3.
+	void evaluateAnimationReference(const Skeleton& skeleton, const std::vector<AnimationClip>& clips, const AnimationState& state,
+		glm::mat4* skinningMatrices);
+	//CPU skinning of positions, normals and tangents, for checking the compute shader
+	void skinVerticesReference(const Vertex* bindVertices, const SkinWeights& skin, const glm::mat4* skinningMatrices, size_t numVertices, Vertex* out);
+}
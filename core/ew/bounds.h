@@ -0,0 +1,87 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include <glm/glm.hpp>
+#include <float.h>
+
+namespace ew {
+	//Axis aligned bounding box. Default constructed box is empty, so any point expands it.
+	struct AABB {
+		glm::vec3 min = glm::vec3(FLT_MAX);
+		glm::vec3 max = glm::vec3(-FLT_MAX);
+
+		inline bool isEmpty()const { return min.x > max.x; }
+		inline glm::vec3 center()const { return (min + max) * 0.5f; }
+		inline glm::vec3 extents()const { return (max - min) * 0.5f; }
+		inline glm::vec3 corner(int i)const {
+			return glm::vec3((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+		}
+		inline void expand(const glm::vec3& p) {
+			min = glm::min(min, p);
+			max = glm::max(max, p);
+		}
+		inline void expand(const AABB& other) {
+			if (!other.isEmpty()) {
+				expand(other.min);
+				expand(other.max);
+			}
+		}
+		//Smallest box holding this one after transforming it by m
+		inline AABB transformed(const glm::mat4& m)const {
+			AABB result;
+			if (!isEmpty()) {
+				for (int i = 0; i < 8; i++)
+				{
+					result.expand(glm::vec3(m * glm::vec4(corner(i), 1.0f)));
+				}
+			}
+			return result;
+		}
+	};
+
+	//Six planes pointing inward, extracted from a view projection matrix. Spheres are tested in the matrix's input space.
+	struct Frustum {
+		glm::vec4 planes[6]; //Left, right, bottom, top, near, far
+
+		Frustum() {};
+		explicit Frustum(const glm::mat4& viewProjection) {
+			glm::vec4 rows[4];
+			for (int i = 0; i < 4; i++)
+			{
+				rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+			}
+			for (int i = 0; i < 3; i++)
+			{
+				planes[i * 2] = rows[3] + rows[i];
+				planes[i * 2 + 1] = rows[3] - rows[i];
+			}
+			for (int i = 0; i < 6; i++)
+			{
+				planes[i] /= glm::length(glm::vec3(planes[i]));
+			}
+		}
+		inline bool intersectsSphere(const glm::vec3& center, float radius)const {
+			for (int i = 0; i < 6; i++)
+			{
+				if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius) {
+					return false;
+				}
+			}
+			return true;
+		}
+		//Conservative: boxes near a frustum corner can pass without actually touching it
+		inline bool intersectsAABB(const AABB& box)const {
+			for (int i = 0; i < 6; i++)
+			{
+				//Corner furthest along the plane normal
+				glm::vec3 p = glm::vec3(planes[i].x >= 0.0f ? box.max.x : box.min.x, planes[i].y >= 0.0f ? box.max.y : box.min.y, planes[i].z >= 0.0f ? box.max.z : box.min.z);
+				if (glm::dot(glm::vec3(planes[i]), p) + planes[i].w < 0.0f) {
+					return false;
+				}
+			}
+			return true;
+		}
+	};
+}
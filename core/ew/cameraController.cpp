@@ -5,36 +5,63 @@
 #include "cameraController.h"
 namespace ew {
 	void CameraController::move(GLFWwindow* window, ew::Camera* camera, float deltaTime) {
+		update(gatherInput(window), camera, deltaTime);
+	}
+
+	CameraInput CameraController::gatherInput(GLFWwindow* window) {
+		CameraInput input;
 		//Only allow movement if right mouse is held
 		if (!glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_2)) {
 			//Release cursor
 			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 			firstMouse = true;
-			return;
+			return input;
 		}
 		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-	
-		//MOUSE AIMING
-		{
-			double mouseX, mouseY;
-			glfwGetCursorPos(window, &mouseX, &mouseY);
+		input.active = true;
 
-			//First frame, set prevMouse values
-			if (firstMouse) {
-				firstMouse = false;
-				prevMouseX = mouseX;
-				prevMouseY = mouseY;
-			}
-
-			float mouseDeltaX = (float)(mouseX - prevMouseX);
-			float mouseDeltaY = (float)(mouseY - prevMouseY);
+		double mouseX, mouseY;
+		glfwGetCursorPos(window, &mouseX, &mouseY);
 
+		//First frame, set prevMouse values
+		if (firstMouse) {
+			firstMouse = false;
 			prevMouseX = mouseX;
 			prevMouseY = mouseY;
+		}
+
+		input.mouseDeltaX = (float)(mouseX - prevMouseX);
+		input.mouseDeltaY = (float)(mouseY - prevMouseY);
 
+		prevMouseX = mouseX;
+		prevMouseY = mouseY;
+
+		const int keyMap[][2] = {
+			{ GLFW_KEY_W, CAMERA_KEY_FORWARD },
+			{ GLFW_KEY_S, CAMERA_KEY_BACK },
+			{ GLFW_KEY_D, CAMERA_KEY_RIGHT },
+			{ GLFW_KEY_A, CAMERA_KEY_LEFT },
+			{ GLFW_KEY_E, CAMERA_KEY_UP },
+			{ GLFW_KEY_Q, CAMERA_KEY_DOWN },
+			{ GLFW_KEY_LEFT_SHIFT, CAMERA_KEY_SPRINT }
+		};
+		for (const auto& key : keyMap) {
+			if (glfwGetKey(window, key[0])) {
+				input.keys |= key[1];
+			}
+		}
+		return input;
+	}
+
+	void CameraController::update(const CameraInput& input, ew::Camera* camera, float deltaTime) {
+		if (!input.active) {
+			return;
+		}
+		//MOUSE AIMING
+		{
 			//Change yaw and pitch (degrees)
-			yaw += mouseDeltaX * mouseSensitivity;
-			pitch -= mouseDeltaY * mouseSensitivity;
+			yaw += input.mouseDeltaX * mouseSensitivity;
+			pitch -= input.mouseDeltaY * mouseSensitivity;
 			pitch = glm::clamp(pitch, -89.0f, 89.0f);
 
 		}
@@ -54,24 +81,24 @@ namespace ew {
 			glm::vec3 up = glm::normalize(glm::cross(right, forward));
 
 			//Keyboard movement
-			float speed = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) ? sprintMoveSpeed : moveSpeed;
+			float speed = (input.keys & CAMERA_KEY_SPRINT) ? sprintMoveSpeed : moveSpeed;
 			float moveDelta = speed * deltaTime;
-			if (glfwGetKey(window, GLFW_KEY_W)) {
+			if (input.keys & CAMERA_KEY_FORWARD) {
 				camera->position += forward * moveDelta;
 			}
-			if (glfwGetKey(window, GLFW_KEY_S)) {
+			if (input.keys & CAMERA_KEY_BACK) {
 				camera->position -= forward * moveDelta;
 			}
-			if (glfwGetKey(window, GLFW_KEY_D)) {
+			if (input.keys & CAMERA_KEY_RIGHT) {
 				camera->position += right * moveDelta;
 			}
-			if (glfwGetKey(window, GLFW_KEY_A)) {
+			if (input.keys & CAMERA_KEY_LEFT) {
 				camera->position -= right * moveDelta;
 			}
-			if (glfwGetKey(window, GLFW_KEY_E)) {
+			if (input.keys & CAMERA_KEY_UP) {
 				camera->position += up * moveDelta;
 			}
-			if (glfwGetKey(window, GLFW_KEY_Q)) {
+			if (input.keys & CAMERA_KEY_DOWN) {
 				camera->position -= up * moveDelta;
 			}
 
@@ -79,4 +106,4 @@ namespace ew {
 			camera->target = camera->position + forward;
 		}
 	}
-}
\ No newline at end of file
+}
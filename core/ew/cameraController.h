@@ -7,6 +7,24 @@
 #include "camera.h"
 
 namespace ew {
+	enum CameraKey {
+		CAMERA_KEY_FORWARD = 1 << 0,
+		CAMERA_KEY_BACK = 1 << 1,
+		CAMERA_KEY_RIGHT = 1 << 2,
+		CAMERA_KEY_LEFT = 1 << 3,
+		CAMERA_KEY_UP = 1 << 4,
+		CAMERA_KEY_DOWN = 1 << 5,
+		CAMERA_KEY_SPRINT = 1 << 6
+	};
+
+	//One frame of camera input, independent of where it came from
+	struct CameraInput {
+		bool active = false; //Right mouse held. Camera ignores everything else when false.
+		float mouseDeltaX = 0.0f;
+		float mouseDeltaY = 0.0f;
+		unsigned int keys = 0; //CameraKey flags
+	};
+
 	struct CameraController {
 		float moveSpeed = 3.0f; //Default speed
 		float sprintMoveSpeed = 6.0f; //Speed when left shift is held
@@ -19,5 +37,9 @@ namespace ew {
 
 		//Using input from window, aim and rotate camera
 		void move(GLFWwindow* window, ew::Camera* camera, float deltaTime);
+		//Reads mouse and keyboard state from window. Also captures or releases the cursor.
+		CameraInput gatherInput(GLFWwindow* window);
+		//Aims and moves camera from input. Doesn't touch the window, so it can be driven by recorded input.
+		void update(const CameraInput& input, ew::Camera* camera, float deltaTime);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,319 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include "file.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ew {
+	//Archive layout: header, entry table, name table, then 16 byte aligned file data
+	static const char ARCHIVE_MAGIC[4] = { 'E','W','P','K' };
+	static const uint32_t ARCHIVE_VERSION = 1;
+	static const uint64_t ARCHIVE_DATA_ALIGNMENT = 16;
+
+	struct ArchiveHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t numEntries;
+		uint32_t nameTableSize;
+	};
+
+	struct ArchiveEntry {
+		uint64_t dataOffset;
+		uint64_t dataSize;
+		uint32_t nameOffset;
+		uint32_t nameLength;
+	};
+
+	MappedFile::MappedFile(const std::string& filePath)
+	{
+		open(filePath);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other) {
+			close();
+			std::swap(m_isOpen, other.m_isOpen);
+			std::swap(m_data, other.m_data);
+			std::swap(m_size, other.m_size);
+#ifdef _WIN32
+			std::swap(m_fileHandle, other.m_fileHandle);
+			std::swap(m_mappingHandle, other.m_mappingHandle);
+#endif
+		}
+		return *this;
+	}
+
+	/// <summary>
+	/// Maps a file into memory read-only. Any previously mapped file is closed.
+	/// </summary>
+	/// <param name="filePath">Path to the file</param>
+	/// <returns>False if the file could not be opened or mapped</returns>
+	bool MappedFile::open(const std::string& filePath)
+	{
+		close();
+#ifdef _WIN32
+		HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			printf("Failed to open file %s", filePath.c_str());
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		GetFileSizeEx(file, &fileSize);
+		m_fileHandle = file;
+		m_size = (size_t)fileSize.QuadPart;
+		//Empty files can't be mapped, but are still valid
+		if (m_size > 0) {
+			HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mapping == NULL) {
+				printf("Failed to map file %s", filePath.c_str());
+				close();
+				return false;
+			}
+			m_mappingHandle = mapping;
+			m_data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (m_data == NULL) {
+				printf("Failed to map file %s", filePath.c_str());
+				close();
+				return false;
+			}
+		}
+#else
+		int fd = ::open(filePath.c_str(), O_RDONLY);
+		if (fd < 0) {
+			printf("Failed to open file %s", filePath.c_str());
+			return false;
+		}
+		struct stat fileStat;
+		if (fstat(fd, &fileStat) != 0) {
+			printf("Failed to open file %s", filePath.c_str());
+			::close(fd);
+			return false;
+		}
+		m_size = (size_t)fileStat.st_size;
+		//Empty files can't be mapped, but are still valid
+		if (m_size > 0) {
+			void* mapped = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapped == MAP_FAILED) {
+				printf("Failed to map file %s", filePath.c_str());
+				::close(fd);
+				m_size = 0;
+				return false;
+			}
+			//Assets are read front to back, so let the kernel read ahead
+			madvise(mapped, m_size, MADV_SEQUENTIAL);
+			m_data = (const unsigned char*)mapped;
+		}
+		//The mapping keeps its own reference to the file
+		::close(fd);
+#endif
+		m_isOpen = true;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+#ifdef _WIN32
+		if (m_data != nullptr) {
+			UnmapViewOfFile(m_data);
+		}
+		if (m_mappingHandle != nullptr) {
+			CloseHandle((HANDLE)m_mappingHandle);
+		}
+		if (m_fileHandle != nullptr) {
+			CloseHandle((HANDLE)m_fileHandle);
+		}
+		m_fileHandle = m_mappingHandle = nullptr;
+#else
+		if (m_data != nullptr) {
+			munmap((void*)m_data, m_size);
+		}
+#endif
+		m_data = nullptr;
+		m_size = 0;
+		m_isOpen = false;
+	}
+
+	AssetArchive::AssetArchive(const std::string& filePath)
+	{
+		open(filePath);
+	}
+
+	/// <summary>
+	/// Maps an archive written by packAssetArchive and reads its directory
+	/// </summary>
+	/// <param name="filePath">Path to the archive</param>
+	/// <returns>False if the file is missing or is not a valid archive</returns>
+	bool AssetArchive::open(const std::string& filePath)
+	{
+		m_entries.clear();
+		if (!m_file.open(filePath)) {
+			return false;
+		}
+		const unsigned char* base = m_file.data();
+		size_t size = m_file.size();
+		ArchiveHeader header;
+		if (size < sizeof(header)) {
+			printf("Invalid asset archive %s", filePath.c_str());
+			m_file.close();
+			return false;
+		}
+		memcpy(&header, base, sizeof(header));
+		if (memcmp(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0 || header.version != ARCHIVE_VERSION) {
+			printf("Invalid asset archive %s", filePath.c_str());
+			m_file.close();
+			return false;
+		}
+		//Sizes come from the file, so every check is written so a malformed archive can't overflow it
+		uint64_t entryTableOffset = sizeof(ArchiveHeader);
+		uint64_t nameTableOffset = entryTableOffset + (uint64_t)sizeof(ArchiveEntry) * header.numEntries;
+		if (nameTableOffset > size || header.nameTableSize > size - nameTableOffset) {
+			printf("Truncated asset archive %s", filePath.c_str());
+			m_file.close();
+			return false;
+		}
+		const char* nameTable = (const char*)base + nameTableOffset;
+		m_entries.reserve(header.numEntries);
+		for (uint32_t i = 0; i < header.numEntries; i++)
+		{
+			ArchiveEntry entry;
+			memcpy(&entry, base + entryTableOffset + sizeof(ArchiveEntry) * i, sizeof(entry));
+			bool nameValid = (uint64_t)entry.nameOffset + entry.nameLength <= header.nameTableSize;
+			bool dataValid = entry.dataOffset <= size && entry.dataSize <= size - entry.dataOffset;
+			if (!nameValid || !dataValid) {
+				printf("Truncated asset archive %s", filePath.c_str());
+				m_entries.clear();
+				m_file.close();
+				return false;
+			}
+			Entry e;
+			e.name = std::string_view(nameTable + entry.nameOffset, entry.nameLength);
+			e.data = std::string_view((const char*)base + entry.dataOffset, (size_t)entry.dataSize);
+			m_entries.push_back(e);
+		}
+		//Packer writes entries sorted, but don't rely on it
+		std::sort(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b) { return a.name < b.name; });
+		return true;
+	}
+
+	const AssetArchive::Entry* AssetArchive::findEntry(std::string_view name) const
+	{
+		auto it = std::lower_bound(m_entries.begin(), m_entries.end(), name, [](const Entry& e, std::string_view n) { return e.name < n; });
+		if (it == m_entries.end() || it->name != name) {
+			return nullptr;
+		}
+		return &(*it);
+	}
+
+	bool AssetArchive::contains(std::string_view name) const
+	{
+		return findEntry(name) != nullptr;
+	}
+
+	bool AssetArchive::find(std::string_view name, std::string_view* data) const
+	{
+		const Entry* entry = findEntry(name);
+		if (entry == nullptr) {
+			return false;
+		}
+		*data = entry->data;
+		return true;
+	}
+
+	/// <summary>
+	/// Packs a list of files into a single archive that can be opened with AssetArchive
+	/// </summary>
+	/// <param name="archivePath">Path of the archive to write</param>
+	/// <param name="filePaths">Files to pack. Each entry is named by its path as given here.</param>
+	/// <returns>False if any file could not be read or the archive could not be written</returns>
+	bool packAssetArchive(const std::string& archivePath, const std::vector<std::string>& filePaths)
+	{
+		std::vector<std::string> names = filePaths;
+		std::sort(names.begin(), names.end());
+		names.erase(std::unique(names.begin(), names.end()), names.end());
+
+		std::vector<MappedFile> files(names.size());
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			if (!files[i].open(names[i])) {
+				return false;
+			}
+		}
+
+		ArchiveHeader header;
+		memcpy(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+		header.version = ARCHIVE_VERSION;
+		header.numEntries = (uint32_t)names.size();
+		header.nameTableSize = 0;
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			header.nameTableSize += (uint32_t)names[i].size();
+		}
+
+		auto align = [](uint64_t offset) { return (offset + ARCHIVE_DATA_ALIGNMENT - 1) & ~(ARCHIVE_DATA_ALIGNMENT - 1); };
+		std::vector<ArchiveEntry> entries(names.size());
+		uint32_t nameOffset = 0;
+		uint64_t dataOffset = align(sizeof(ArchiveHeader) + sizeof(ArchiveEntry) * entries.size() + header.nameTableSize);
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			entries[i].nameOffset = nameOffset;
+			entries[i].nameLength = (uint32_t)names[i].size();
+			entries[i].dataOffset = dataOffset;
+			entries[i].dataSize = files[i].size();
+			nameOffset += entries[i].nameLength;
+			dataOffset = align(dataOffset + files[i].size());
+		}
+
+		FILE* out = fopen(archivePath.c_str(), "wb");
+		if (out == NULL) {
+			printf("Failed to write asset archive %s", archivePath.c_str());
+			return false;
+		}
+		//Track the position instead of asking ftell, which is limited to 2GB where long is 32 bits
+		uint64_t position = sizeof(header) + sizeof(ArchiveEntry) * entries.size() + header.nameTableSize;
+		bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+		ok &= entries.empty() || fwrite(entries.data(), sizeof(ArchiveEntry), entries.size(), out) == entries.size();
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			ok &= fwrite(names[i].data(), 1, names[i].size(), out) == names[i].size();
+		}
+		static const char padding[ARCHIVE_DATA_ALIGNMENT] = {};
+		for (size_t i = 0; i < files.size(); i++)
+		{
+			size_t paddingSize = (size_t)(entries[i].dataOffset - position);
+			ok &= fwrite(padding, 1, paddingSize, out) == paddingSize;
+			ok &= fwrite(files[i].data(), 1, files[i].size(), out) == files[i].size();
+			position = entries[i].dataOffset + files[i].size();
+		}
+		fclose(out);
+		if (!ok) {
+			printf("Failed to write asset archive %s", archivePath.c_str());
+		}
+		return ok;
+	}
+}
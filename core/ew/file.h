@@ -0,0 +1,66 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// Read-only view of a file mapped into memory.
+	/// Contents stay valid until the file is closed or the MappedFile is destroyed.
+	/// </summary>
+	class MappedFile {
+	public:
+		MappedFile() {};
+		MappedFile(const std::string& filePath);
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		bool open(const std::string& filePath);
+		void close();
+		inline bool isOpen()const { return m_isOpen; }
+		inline const unsigned char* data()const { return m_data; }
+		inline size_t size()const { return m_size; }
+		inline std::string_view view()const { return std::string_view((const char*)m_data, m_size); }
+	private:
+		bool m_isOpen = false;
+		const unsigned char* m_data = nullptr;
+		size_t m_size = 0;
+#ifdef _WIN32
+		void* m_fileHandle = nullptr;
+		void* m_mappingHandle = nullptr;
+#endif
+	};
+
+	/// <summary>
+	/// Many assets packed into a single file with a directory index.
+	/// Entries are views into one mapping, so looking them up never copies or touches the file system.
+	/// </summary>
+	class AssetArchive {
+	public:
+		AssetArchive() {};
+		AssetArchive(const std::string& filePath);
+		bool open(const std::string& filePath);
+		bool contains(std::string_view name)const;
+		//Returns false if no entry with this name exists
+		bool find(std::string_view name, std::string_view* data)const;
+		inline size_t getNumEntries()const { return m_entries.size(); }
+	private:
+		struct Entry {
+			std::string_view name;
+			std::string_view data;
+		};
+		const Entry* findEntry(std::string_view name)const;
+		MappedFile m_file;
+		std::vector<Entry> m_entries; //Sorted by name
+	};
+
+	//Packs files into an archive. Each entry is named by the path it was read from.
+	bool packAssetArchive(const std::string& archivePath, const std::vector<std::string>& filePaths);
+}
@@ -0,0 +1,204 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include "frameCapture.h"
+#include "file.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+namespace ew {
+	static const char CAPTURE_MAGIC[4] = { 'E','W','C','P' };
+	static const uint32_t CAPTURE_VERSION = 1;
+
+	struct CaptureHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t numFrames;
+		uint32_t recordSize;
+	};
+
+	//Fixed size, padding free record so the log can be read with one memcpy per frame
+	struct CaptureRecord {
+		float deltaTime;
+		float mouseDeltaX;
+		float mouseDeltaY;
+		float yaw;
+		float pitch;
+		float position[3];
+		float target[3];
+		uint8_t active;
+		uint8_t keys;
+		uint16_t reserved;
+	};
+	static_assert(sizeof(CaptureRecord) == 48, "CaptureRecord must not contain padding");
+
+	CaptureWriter::~CaptureWriter()
+	{
+		close();
+	}
+
+	bool CaptureWriter::open(const std::string& filePath)
+	{
+		close();
+		m_file = fopen(filePath.c_str(), "wb");
+		if (!m_file) {
+			printf("Failed to open capture %s for writing\n", filePath.c_str());
+			return false;
+		}
+		m_numFrames = 0;
+		CaptureHeader header = {};
+		memcpy(header.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+		header.version = CAPTURE_VERSION;
+		header.recordSize = sizeof(CaptureRecord);
+		fwrite(&header, sizeof(header), 1, m_file);
+		return true;
+	}
+
+	void CaptureWriter::write(const CapturedFrame& frame)
+	{
+		if (!m_file) {
+			return;
+		}
+		CaptureRecord record = {};
+		record.deltaTime = frame.deltaTime;
+		record.mouseDeltaX = frame.input.mouseDeltaX;
+		record.mouseDeltaY = frame.input.mouseDeltaY;
+		record.yaw = frame.yaw;
+		record.pitch = frame.pitch;
+		for (int i = 0; i < 3; i++) {
+			record.position[i] = frame.position[i];
+			record.target[i] = frame.target[i];
+		}
+		record.active = frame.input.active;
+		record.keys = (uint8_t)frame.input.keys;
+		fwrite(&record, sizeof(record), 1, m_file);
+		m_numFrames++;
+	}
+
+	void CaptureWriter::close()
+	{
+		if (!m_file) {
+			return;
+		}
+		//Patch the frame count now that it's known
+		uint32_t numFrames = m_numFrames;
+		fseek(m_file, offsetof(CaptureHeader, numFrames), SEEK_SET);
+		fwrite(&numFrames, sizeof(numFrames), 1, m_file);
+		fclose(m_file);
+		m_file = nullptr;
+	}
+
+	/// <summary>
+	/// Reads every frame of a capture log
+	/// </summary>
+	/// <param name="filePath">Log written by CaptureWriter</param>
+	/// <param name="frames">Replaced with the captured frames</param>
+	/// <returns>False if the file is missing, invalid or truncated</returns>
+	bool loadCapture(const std::string& filePath, std::vector<CapturedFrame>* frames)
+	{
+		frames->clear();
+		MappedFile file;
+		if (!file.open(filePath)) {
+			return false;
+		}
+		CaptureHeader header;
+		if (file.size() < sizeof(header)) {
+			printf("Invalid capture %s\n", filePath.c_str());
+			return false;
+		}
+		memcpy(&header, file.data(), sizeof(header));
+		if (memcmp(header.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0 || header.version != CAPTURE_VERSION
+			|| header.recordSize != sizeof(CaptureRecord)) {
+			printf("Invalid capture %s\n", filePath.c_str());
+			return false;
+		}
+		if (file.size() < sizeof(header) + (size_t)header.numFrames * sizeof(CaptureRecord)) {
+			printf("Truncated capture %s\n", filePath.c_str());
+			return false;
+		}
+		frames->resize(header.numFrames);
+		const unsigned char* records = file.data() + sizeof(header);
+		for (uint32_t i = 0; i < header.numFrames; i++) {
+			CaptureRecord record;
+			memcpy(&record, records + sizeof(CaptureRecord) * i, sizeof(record));
+			CapturedFrame& frame = (*frames)[i];
+			frame.deltaTime = record.deltaTime;
+			frame.input.active = record.active != 0;
+			frame.input.mouseDeltaX = record.mouseDeltaX;
+			frame.input.mouseDeltaY = record.mouseDeltaY;
+			frame.input.keys = record.keys;
+			frame.yaw = record.yaw;
+			frame.pitch = record.pitch;
+			frame.position = glm::vec3(record.position[0], record.position[1], record.position[2]);
+			frame.target = glm::vec3(record.target[0], record.target[1], record.target[2]);
+		}
+		return true;
+	}
+
+	bool replayCapturedFrame(const CapturedFrame& frame, CameraController* controller, Camera* camera)
+	{
+		controller->update(frame.input, camera, frame.deltaTime);
+		//Same inputs through the same code give the same floats, so anything past rounding noise is a real divergence
+		const float TOLERANCE = 1e-4f;
+		bool matches = fabsf(controller->yaw - frame.yaw) <= TOLERANCE && fabsf(controller->pitch - frame.pitch) <= TOLERANCE
+			&& glm::length(camera->position - frame.position) <= TOLERANCE && glm::length(camera->target - frame.target) <= TOLERANCE;
+		if (!matches) {
+			controller->yaw = frame.yaw;
+			controller->pitch = frame.pitch;
+			camera->position = frame.position;
+			camera->target = frame.target;
+		}
+		return matches;
+	}
+
+	static float percentile(const std::vector<float>& sorted, float p)
+	{
+		size_t i = (size_t)(p * (sorted.size() - 1) + 0.5f);
+		return sorted[std::min(i, sorted.size() - 1)];
+	}
+
+	void printTimingSummary(const std::vector<FrameTiming>& timings)
+	{
+		if (timings.empty()) {
+			printf("No frames timed\n");
+			return;
+		}
+		std::vector<float> cpu, gpu;
+		cpu.reserve(timings.size());
+		gpu.reserve(timings.size());
+		double cpuTotal = 0.0, gpuTotal = 0.0;
+		for (const FrameTiming& timing : timings) {
+			cpu.push_back(timing.cpuMs);
+			gpu.push_back(timing.gpuMs);
+			cpuTotal += timing.cpuMs;
+			gpuTotal += timing.gpuMs;
+		}
+		std::sort(cpu.begin(), cpu.end());
+		std::sort(gpu.begin(), gpu.end());
+		printf("%zu frames\n", timings.size());
+		printf("       avg      min      p50      p95      p99      max\n");
+		printf("CPU %7.3f  %7.3f  %7.3f  %7.3f  %7.3f  %7.3f ms\n", cpuTotal / cpu.size(), cpu.front(),
+			percentile(cpu, 0.5f), percentile(cpu, 0.95f), percentile(cpu, 0.99f), cpu.back());
+		printf("GPU %7.3f  %7.3f  %7.3f  %7.3f  %7.3f  %7.3f ms\n", gpuTotal / gpu.size(), gpu.front(),
+			percentile(gpu, 0.5f), percentile(gpu, 0.95f), percentile(gpu, 0.99f), gpu.back());
+	}
+
+	bool writeTimingsCsv(const std::string& filePath, const std::vector<FrameTiming>& timings)
+	{
+		FILE* out = fopen(filePath.c_str(), "w");
+		if (!out) {
+			printf("Failed to open %s for writing\n", filePath.c_str());
+			return false;
+		}
+		fprintf(out, "frame,cpu_ms,gpu_ms\n");
+		for (size_t i = 0; i < timings.size(); i++) {
+			fprintf(out, "%zu,%.4f,%.4f\n", i, timings[i].cpuMs, timings[i].gpuMs);
+		}
+		fclose(out);
+		return true;
+	}
+}
@@ -0,0 +1,62 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include "cameraController.h"
+#include <glm/glm.hpp>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace ew {
+	//Input and resulting camera state for one frame
+	struct CapturedFrame {
+		float deltaTime = 0.0f; //Wall clock time of the frame when it was captured
+		CameraInput input;
+		float yaw = 0.0f; //Controller state after this frame's input was applied
+		float pitch = 0.0f;
+		glm::vec3 position = glm::vec3(0.0f);
+		glm::vec3 target = glm::vec3(0.0f);
+	};
+
+	/// <summary>
+	/// Streams captured frames to a compact binary log.
+	/// The frame count in the header is filled in when the log is closed.
+	/// </summary>
+	class CaptureWriter {
+	public:
+		CaptureWriter() {};
+		~CaptureWriter();
+		CaptureWriter(const CaptureWriter&) = delete;
+		CaptureWriter& operator=(const CaptureWriter&) = delete;
+		bool open(const std::string& filePath);
+		void write(const CapturedFrame& frame);
+		void close();
+		inline bool isOpen()const { return m_file != nullptr; }
+		inline unsigned int getNumFrames()const { return m_numFrames; }
+	private:
+		FILE* m_file = nullptr;
+		unsigned int m_numFrames = 0;
+	};
+
+	//Reads a log written by CaptureWriter. Returns false if the file is missing or invalid.
+	bool loadCapture(const std::string& filePath, std::vector<CapturedFrame>* frames);
+
+	/// <summary>
+	/// Plays one captured frame back by feeding its input to the controller, stepped by the frame's captured deltaTime
+	/// so movement covers the same distance it did live. Returns false if the result drifted from the captured state,
+	/// e.g. because the camera was reset from the UI while capturing, in which case camera and controller are snapped to it.
+	/// </summary>
+	bool replayCapturedFrame(const CapturedFrame& frame, CameraController* controller, Camera* camera);
+
+	struct FrameTiming {
+		float cpuMs = 0.0f; //Wall clock time of the whole frame
+		float gpuMs = 0.0f; //GPU time of the scene passes
+	};
+
+	//Prints average, min, max and percentiles of a run
+	void printTimingSummary(const std::vector<FrameTiming>& timings);
+	//One line per frame, for comparing runs across builds
+	bool writeTimingsCsv(const std::string& filePath, const std::vector<FrameTiming>& timings);
+}
@@ -0,0 +1,57 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include "gpuTimer.h"
+#include "external/glad.h"
+
+namespace ew {
+	GpuTimer::GpuTimer()
+	{
+		glCreateQueries(GL_TIMESTAMP, NUM_QUERIES, m_beginQueries);
+		glCreateQueries(GL_TIMESTAMP, NUM_QUERIES, m_endQueries);
+	}
+
+	GpuTimer::~GpuTimer()
+	{
+		glDeleteQueries(NUM_QUERIES, m_beginQueries);
+		glDeleteQueries(NUM_QUERIES, m_endQueries);
+	}
+
+	void GpuTimer::begin()
+	{
+		//Collect any finished results, oldest first so the newest wins
+		for (int i = 1; i <= NUM_QUERIES; i++)
+		{
+			int index = (m_current + i) % NUM_QUERIES;
+			if (!m_pending[index]) {
+				continue;
+			}
+			//The end timestamp is written last, so once it's available both are
+			GLint available = 0;
+			glGetQueryObjectiv(m_endQueries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available) {
+				GLuint64 beginNs = 0, endNs = 0;
+				glGetQueryObjectui64v(m_beginQueries[index], GL_QUERY_RESULT, &beginNs);
+				glGetQueryObjectui64v(m_endQueries[index], GL_QUERY_RESULT, &endNs);
+				m_lastMs = (endNs - beginNs) / 1000000.0f;
+				m_pending[index] = false;
+			}
+		}
+		m_current = (m_current + 1) % NUM_QUERIES;
+		//Every query still in flight: skip timing this frame rather than stall
+		m_active = !m_pending[m_current];
+		if (m_active) {
+			glQueryCounter(m_beginQueries[m_current], GL_TIMESTAMP);
+		}
+	}
+
+	void GpuTimer::end()
+	{
+		if (m_active) {
+			glQueryCounter(m_endQueries[m_current], GL_TIMESTAMP);
+			m_pending[m_current] = true;
+			m_active = false;
+		}
+	}
+}
@@ -0,0 +1,32 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+
+namespace ew {
+	/// <summary>
+	/// Measures GPU time between begin() and end() with a ring of timestamp query pairs.
+	/// Timestamps, unlike GL_TIME_ELAPSED queries, can overlap other timers, so timed sections may nest.
+	/// Results arrive a few frames late, but reading them never waits on the GPU.
+	/// </summary>
+	class GpuTimer {
+	public:
+		GpuTimer();
+		~GpuTimer();
+		GpuTimer(const GpuTimer&) = delete;
+		GpuTimer& operator=(const GpuTimer&) = delete;
+		void begin();
+		void end();
+		//Most recent finished measurement, in milliseconds
+		inline float getLastMs()const { return m_lastMs; }
+	private:
+		static const int NUM_QUERIES = 4;
+		unsigned int m_beginQueries[NUM_QUERIES] = {};
+		unsigned int m_endQueries[NUM_QUERIES] = {};
+		bool m_pending[NUM_QUERIES] = {};
+		int m_current = 0;
+		bool m_active = false;
+		float m_lastMs = 0.0f;
+	};
+}
@@ -0,0 +1,47 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include "imageWrite.h"
+#include "external/stb_image_write.h"
+#include <stdio.h>
+
+namespace ew {
+	static void appendToVector(void* context, void* data, int size) {
+		std::vector<unsigned char>* png = (std::vector<unsigned char>*)context;
+		png->insert(png->end(), (const unsigned char*)data, (const unsigned char*)data + size);
+	}
+
+	//Starting from the last row with a negative stride flips without stbi_flip_vertically_on_write, which is global
+	static bool getRows(const unsigned char* pixels, int width, int height, int channels, bool flipVertically, const unsigned char** firstRow, int* stride) {
+		if (pixels == nullptr || width <= 0 || height <= 0 || channels < 1 || channels > 4) {
+			return false;
+		}
+		*stride = flipVertically ? -width * channels : width * channels;
+		*firstRow = flipVertically ? pixels + (size_t)width * channels * (height - 1) : pixels;
+		return true;
+	}
+
+	bool encodePng(const unsigned char* pixels, int width, int height, int channels, bool flipVertically, std::vector<unsigned char>* png)
+	{
+		png->clear();
+		const unsigned char* firstRow;
+		int stride;
+		if (!getRows(pixels, width, height, channels, flipVertically, &firstRow, &stride)) {
+			return false;
+		}
+		return stbi_write_png_to_func(appendToVector, png, width, height, channels, firstRow, stride) != 0;
+	}
+
+	bool writePng(const std::string& filePath, const unsigned char* pixels, int width, int height, int channels, bool flipVertically)
+	{
+		const unsigned char* firstRow;
+		int stride;
+		if (!getRows(pixels, width, height, channels, flipVertically, &firstRow, &stride)
+			|| !stbi_write_png(filePath.c_str(), width, height, channels, firstRow, stride)) {
+			printf("Failed to write %s\n", filePath.c_str());
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,19 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include <string>
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// Encodes 8 bit pixels as a PNG. channels is 1 (gray), 2 (gray, alpha), 3 (RGB) or 4 (RGBA).
+	/// Rows are top first unless flipVertically is set, which suits GL readbacks that come bottom row first.
+	/// Encoded by stb_image_write, which only uses fixed Huffman deflate: fast enough to keep up with per frame captures,
+	/// at some cost in file size. Safe to call from any thread.
+	/// </summary>
+	bool encodePng(const unsigned char* pixels, int width, int height, int channels, bool flipVertically, std::vector<unsigned char>* png);
+	//Encodes and writes to a file. Returns false if encoding or writing failed.
+	bool writePng(const std::string& filePath, const unsigned char* pixels, int width, int height, int channels, bool flipVertically = false);
+}
@@ -0,0 +1,286 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include "jobSystem.h"
+#include <algorithm>
+
+namespace ew {
+	//Index of the queue owned by the current thread. Threads outside the pool share queue 0.
+	static thread_local unsigned int t_queueIndex = 0;
+	static thread_local const JobSystem* t_owner = nullptr;
+
+	JobSystem::JobSystem(unsigned int numWorkers)
+	{
+		if (numWorkers == 0) {
+			unsigned int hardwareThreads = std::thread::hardware_concurrency();
+			numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+		for (unsigned int i = 0; i <= numWorkers; i++)
+		{
+			m_queues.push_back(std::make_unique<WorkQueue>());
+		}
+		for (unsigned int i = 1; i <= numWorkers; i++)
+		{
+			m_threads.emplace_back(&JobSystem::workerLoop, this, i);
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_quit = true;
+		}
+		m_wakeCondition.notify_all();
+		for (size_t i = 0; i < m_threads.size(); i++)
+		{
+			m_threads[i].join();
+		}
+	}
+
+	/// <summary>
+	/// Queues a job on the current thread's queue
+	/// </summary>
+	/// <param name="job">Function to run</param>
+	/// <param name="counter">Optional counter. Incremented now, decremented once the job has run.</param>
+	void JobSystem::run(Job job, JobCounter* counter)
+	{
+		Task task;
+		task.job = std::move(job);
+		task.counter = counter;
+		push(std::move(task));
+	}
+
+	void JobSystem::push(Task&& task)
+	{
+		if (task.counter != nullptr) {
+			task.counter->value.fetch_add(1, std::memory_order_relaxed);
+		}
+		unsigned int queueIndex = t_owner == this ? t_queueIndex : 0;
+		{
+			WorkQueue& queue = *m_queues[queueIndex];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.pushBack(std::move(task));
+		}
+		bool wakeWaiters;
+		{
+			//Lock so a worker can't miss the wakeup between checking the count and going to sleep
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_numQueued.fetch_add(1, std::memory_order_release);
+			wakeWaiters = m_numWaiting > 0;
+		}
+		m_wakeCondition.notify_one();
+		//Blocked waiters help with new work, e.g. jobs queued by the jobs they are waiting on
+		if (wakeWaiters) {
+			m_doneCondition.notify_all();
+		}
+	}
+
+	void JobSystem::wait(JobCounter* counter)
+	{
+		unsigned int queueIndex = t_owner == this ? t_queueIndex : 0;
+		while (!counter->isDone()) {
+			if (tryRunTask(queueIndex)) {
+				continue;
+			}
+			//Remaining jobs are running on other threads. Sleep until one finishes a counter or more work is queued.
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_numWaiting++;
+			m_doneCondition.wait(lock, [this, counter]() { return counter->isDone() || m_numQueued.load(std::memory_order_acquire) > 0; });
+			m_numWaiting--;
+		}
+	}
+
+	void JobSystem::parallelForRanges(size_t count, size_t grainSize, RangeFunction function, const void* data)
+	{
+		if (count == 0) {
+			return;
+		}
+		grainSize = std::max<size_t>(grainSize, 1);
+		//Small ranges aren't worth the queueing overhead
+		if (count <= grainSize) {
+			function(data, 0, count);
+			return;
+		}
+		JobCounter counter;
+		for (size_t begin = grainSize; begin < count; begin += grainSize)
+		{
+			Task task;
+			task.function = function;
+			task.data = data;
+			task.begin = begin;
+			task.end = std::min(begin + grainSize, count);
+			task.counter = &counter;
+			push(std::move(task));
+		}
+		//First chunk runs on this thread while the rest are picked up
+		function(data, 0, grainSize);
+		wait(&counter);
+	}
+
+	void JobSystem::WorkQueue::pushBack(Task&& task)
+	{
+		if (count == tasks.size()) {
+			//Unwrap into a bigger ring, oldest first
+			std::vector<Task> grown(std::max<size_t>(tasks.size() * 2, 64));
+			for (size_t i = 0; i < count; i++)
+			{
+				grown[i] = std::move(tasks[(head + i) % tasks.size()]);
+			}
+			tasks.swap(grown);
+			head = 0;
+		}
+		tasks[(head + count) % tasks.size()] = std::move(task);
+		count++;
+	}
+
+	void JobSystem::WorkQueue::popBack(Task* task)
+	{
+		count--;
+		*task = std::move(tasks[(head + count) % tasks.size()]);
+	}
+
+	void JobSystem::WorkQueue::popFront(Task* task)
+	{
+		*task = std::move(tasks[head]);
+		head = (head + 1) % tasks.size();
+		count--;
+	}
+
+	/// <summary>
+	/// Takes a job from the back of our own queue, otherwise steals from the front of another
+	/// </summary>
+	bool JobSystem::popTask(unsigned int queueIndex, Task* task)
+	{
+		{
+			WorkQueue& queue = *m_queues[queueIndex];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.count > 0) {
+				queue.popBack(task);
+				return true;
+			}
+		}
+		size_t numQueues = m_queues.size();
+		for (size_t i = 1; i < numQueues; i++)
+		{
+			WorkQueue& victim = *m_queues[(queueIndex + i) % numQueues];
+			std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+			if (lock.owns_lock() && victim.count > 0) {
+				victim.popFront(task);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool JobSystem::tryRunTask(unsigned int queueIndex)
+	{
+		if (m_numQueued.load(std::memory_order_acquire) == 0) {
+			return false;
+		}
+		Task task;
+		if (!popTask(queueIndex, &task)) {
+			return false;
+		}
+		m_numQueued.fetch_sub(1, std::memory_order_relaxed);
+		if (task.function != nullptr) {
+			task.function(task.data, task.begin, task.end);
+		}
+		else {
+			task.job();
+		}
+		if (task.counter != nullptr && task.counter->value.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			//The counter may be gone as soon as it reads 0, so only the pool's own state is touched from here.
+			//Locking orders the decrement with a waiter checking the counter before it sleeps.
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			if (m_numWaiting > 0) {
+				m_doneCondition.notify_all();
+			}
+		}
+		return true;
+	}
+
+	void JobSystem::workerLoop(unsigned int queueIndex)
+	{
+		t_queueIndex = queueIndex;
+		t_owner = this;
+		while (true) {
+			if (tryRunTask(queueIndex)) {
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_wakeCondition.wait(lock, [this]() { return m_quit || m_numQueued.load(std::memory_order_acquire) > 0; });
+			if (m_quit) {
+				return;
+			}
+		}
+	}
+
+	JobGraph::Node JobGraph::add(Job job)
+	{
+		if (m_numNodes == m_nodes.size()) {
+			m_nodes.emplace_back();
+		}
+		NodeData& node = m_nodes[m_numNodes];
+		node.job = std::move(job);
+		node.successors.clear();
+		node.numDependencies = 0;
+		return m_numNodes++;
+	}
+
+	void JobGraph::addDependency(Node before, Node after)
+	{
+		m_nodes[before].successors.push_back(after);
+		m_nodes[after].numDependencies++;
+	}
+
+	void JobGraph::execute(JobSystem* jobSystem)
+	{
+		if (jobSystem == nullptr) {
+			//Dependencies always point at nodes added later, so add order is a valid order to run in
+			for (size_t i = 0; i < m_numNodes; i++)
+			{
+				m_nodes[i].job();
+			}
+			return;
+		}
+		if (m_remainingCapacity < m_numNodes) {
+			m_remaining = std::make_unique<std::atomic<int>[]>(m_numNodes);
+			m_remainingCapacity = m_numNodes;
+		}
+		for (size_t i = 0; i < m_numNodes; i++)
+		{
+			m_remaining[i].store(m_nodes[i].numDependencies, std::memory_order_relaxed);
+		}
+		JobCounter counter;
+		for (size_t i = 0; i < m_numNodes; i++)
+		{
+			if (m_nodes[i].numDependencies == 0) {
+				jobSystem->run([this, jobSystem, i, &counter]() { runNode(jobSystem, i, &counter); }, &counter);
+			}
+		}
+		jobSystem->wait(&counter);
+	}
+
+	void JobGraph::runNode(JobSystem* jobSystem, Node node, JobCounter* counter)
+	{
+		m_nodes[node].job();
+		//Last dependency to finish launches the successor. It's queued before this job's count is released.
+		for (Node successor : m_nodes[node].successors)
+		{
+			if (m_remaining[successor].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				jobSystem->run([this, jobSystem, successor, counter]() { runNode(jobSystem, successor, counter); }, counter);
+			}
+		}
+	}
+
+	void JobGraph::clear()
+	{
+		for (size_t i = 0; i < m_numNodes; i++)
+		{
+			m_nodes[i].job = nullptr;
+		}
+		m_numNodes = 0;
+	}
+}
@@ -0,0 +1,115 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ew {
+	typedef std::function<void()> Job;
+
+	//Number of jobs still in flight. Wait on it to block until a group of jobs is finished.
+	struct JobCounter {
+		std::atomic<int> value{ 0 };
+		inline bool isDone()const { return value.load(std::memory_order_acquire) == 0; }
+	};
+
+	/// <summary>
+	/// Work-stealing thread pool. Each thread owns a deque of jobs: it pops its own work from the back
+	/// and steals from the front of other threads' deques when it runs out.
+	/// </summary>
+	class JobSystem {
+	public:
+		//0 workers = one per hardware thread, minus the calling thread
+		JobSystem(unsigned int numWorkers = 0);
+		~JobSystem();
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		void run(Job job, JobCounter* counter = nullptr);
+		//Runs other jobs on this thread until counter reaches 0, sleeping while there is nothing to run
+		void wait(JobCounter* counter);
+		//Calls fn(begin, end) over [0, count) in chunks of at most grainSize and waits for all of them.
+		//Chunks point at fn instead of copying it into a Job, so this never allocates once the queues have grown.
+		template<typename Fn>
+		void parallelFor(size_t count, size_t grainSize, const Fn& fn);
+		//Worker threads plus the calling thread
+		inline unsigned int getNumThreads()const { return (unsigned int)m_threads.size() + 1; }
+	private:
+		typedef void (*RangeFunction)(const void* data, size_t begin, size_t end);
+		//Either a Job, or a range function called on data, as queued by parallelFor
+		struct Task {
+			Job job;
+			RangeFunction function = nullptr;
+			const void* data = nullptr;
+			size_t begin = 0;
+			size_t end = 0;
+			JobCounter* counter = nullptr;
+		};
+		//Ring buffer that only grows, so pushing and popping doesn't touch the heap in steady state
+		struct WorkQueue {
+			std::mutex mutex;
+			std::vector<Task> tasks;
+			size_t head = 0;
+			size_t count = 0;
+			void pushBack(Task&& task);
+			void popBack(Task* task);
+			void popFront(Task* task);
+		};
+		void push(Task&& task);
+		void parallelForRanges(size_t count, size_t grainSize, RangeFunction function, const void* data);
+		bool tryRunTask(unsigned int queueIndex);
+		bool popTask(unsigned int queueIndex, Task* task);
+		void workerLoop(unsigned int queueIndex);
+
+		std::vector<std::unique_ptr<WorkQueue>> m_queues; //0 belongs to threads outside the pool
+		std::vector<std::thread> m_threads;
+		std::atomic<int> m_numQueued{ 0 };
+		std::mutex m_sleepMutex;
+		std::condition_variable m_wakeCondition; //Workers sleep on this
+		std::condition_variable m_doneCondition; //Threads in wait() sleep on this
+		int m_numWaiting = 0; //Threads sleeping in wait(), guarded by m_sleepMutex
+		bool m_quit = false;
+	};
+
+	template<typename Fn>
+	void JobSystem::parallelFor(size_t count, size_t grainSize, const Fn& fn)
+	{
+		RangeFunction function = [](const void* data, size_t begin, size_t end) { (*static_cast<const Fn*>(data))(begin, end); };
+		parallelForRanges(count, grainSize, function, &fn);
+	}
+
+	/// <summary>
+	/// Jobs with dependencies between them, built once per frame then executed on a JobSystem.
+	/// A job starts once every job it depends on has finished.
+	/// </summary>
+	class JobGraph {
+	public:
+		typedef size_t Node;
+		Node add(Job job);
+		//after will not start until before has finished. after must have been added after before.
+		void addDependency(Node before, Node after);
+		//Runs all jobs and blocks until the graph is finished. Without a job system, runs them in the order they were added.
+		void execute(JobSystem* jobSystem);
+		//Removes all jobs so the graph can be rebuilt next frame. Keeps allocated memory.
+		void clear();
+		inline size_t getNumNodes()const { return m_numNodes; }
+	private:
+		struct NodeData {
+			Job job;
+			std::vector<Node> successors;
+			int numDependencies = 0;
+		};
+		void runNode(JobSystem* jobSystem, Node node, JobCounter* counter);
+		std::vector<NodeData> m_nodes;
+		size_t m_numNodes = 0;
+		std::unique_ptr<std::atomic<int>[]> m_remaining;
+		size_t m_remainingCapacity = 0;
+	};
+}
@@ -0,0 +1,96 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include "memory.h"
+#include <stdint.h>
+
+namespace ew {
+	void* CountingResource::do_allocate(size_t bytes, size_t alignment)
+	{
+		m_numAllocations.fetch_add(1, std::memory_order_relaxed);
+		m_numBytes.fetch_add(bytes, std::memory_order_relaxed);
+		return m_upstream->allocate(bytes, alignment);
+	}
+
+	void CountingResource::do_deallocate(void* p, size_t bytes, size_t alignment)
+	{
+		m_upstream->deallocate(p, bytes, alignment);
+	}
+
+	bool CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+	{
+		return this == &other;
+	}
+
+	/// <summary>
+	/// Creates an arena with an initial block
+	/// </summary>
+	/// <param name="capacity">Initial size in bytes. Grows to fit the largest frame seen.</param>
+	/// <param name="upstream">Where the block and any overflow come from</param>
+	FrameArena::FrameArena(size_t capacity, std::pmr::memory_resource* upstream)
+		: m_upstream(upstream), m_capacity(capacity)
+	{
+		if (m_capacity > 0) {
+			m_buffer = static_cast<unsigned char*>(m_upstream->allocate(m_capacity, alignof(std::max_align_t)));
+		}
+	}
+
+	FrameArena::~FrameArena()
+	{
+		freeOverflow();
+		if (m_buffer != nullptr) {
+			m_upstream->deallocate(m_buffer, m_capacity, alignof(std::max_align_t));
+		}
+	}
+
+	void FrameArena::reset()
+	{
+		//Last frame didn't fit, so grow enough to hold all of it next time
+		if (m_overflowBytes > 0) {
+			size_t newCapacity = m_capacity + m_overflowBytes;
+			newCapacity += newCapacity / 4;
+			if (m_buffer != nullptr) {
+				m_upstream->deallocate(m_buffer, m_capacity, alignof(std::max_align_t));
+			}
+			m_buffer = static_cast<unsigned char*>(m_upstream->allocate(newCapacity, alignof(std::max_align_t)));
+			m_capacity = newCapacity;
+		}
+		freeOverflow();
+		m_used = 0;
+		m_overflowBytes = 0;
+		m_numOverflowAllocations = 0;
+	}
+
+	void* FrameArena::do_allocate(size_t bytes, size_t alignment)
+	{
+		uintptr_t base = (uintptr_t)m_buffer;
+		uintptr_t aligned = (base + m_used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		size_t end = (size_t)(aligned - base) + bytes;
+		if (m_buffer != nullptr && end <= m_capacity) {
+			m_used = end;
+			return (void*)aligned;
+		}
+		//Out of space. Header is padded so the allocation after it keeps its alignment.
+		size_t headerSize = (sizeof(OverflowBlock) + alignment - 1) & ~(alignment - 1);
+		size_t blockAlignment = alignment > alignof(OverflowBlock) ? alignment : alignof(OverflowBlock);
+		unsigned char* memory = static_cast<unsigned char*>(m_upstream->allocate(headerSize + bytes, blockAlignment));
+		OverflowBlock* block = reinterpret_cast<OverflowBlock*>(memory);
+		block->next = m_overflow;
+		block->size = headerSize + bytes;
+		block->alignment = blockAlignment;
+		m_overflow = block;
+		m_overflowBytes += bytes + alignment;
+		m_numOverflowAllocations++;
+		return memory + headerSize;
+	}
+
+	void FrameArena::freeOverflow()
+	{
+		while (m_overflow != nullptr) {
+			OverflowBlock* next = m_overflow->next;
+			m_upstream->deallocate(m_overflow, m_overflow->size, m_overflow->alignment);
+			m_overflow = next;
+		}
+	}
+}
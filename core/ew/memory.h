@@ -0,0 +1,169 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include <atomic>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <stddef.h>
+
+namespace ew {
+	/// <summary>
+	/// Passes allocations through to another resource and counts them.
+	/// Installed as the default resource it sees every heap allocation made by pmr containers,
+	/// but not plain new, std::string or std::function. tests/frameAllocationTest counts those.
+	/// </summary>
+	class CountingResource : public std::pmr::memory_resource {
+	public:
+		CountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) : m_upstream(upstream) {};
+		inline size_t getNumAllocations()const { return m_numAllocations.load(std::memory_order_relaxed); }
+		inline size_t getNumBytesAllocated()const { return m_numBytes.load(std::memory_order_relaxed); }
+	protected:
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource& other)const noexcept override;
+	private:
+		std::pmr::memory_resource* m_upstream;
+		std::atomic<size_t> m_numAllocations{ 0 };
+		std::atomic<size_t> m_numBytes{ 0 };
+	};
+
+	/// <summary>
+	/// Makes a resource the pmr default until this goes out of scope, then puts the previous default back.
+	/// Declare it right after the resource, so the default never points at a destroyed resource.
+	/// </summary>
+	class ScopedDefaultResource {
+	public:
+		ScopedDefaultResource(std::pmr::memory_resource* resource) : m_previous(std::pmr::set_default_resource(resource)) {};
+		~ScopedDefaultResource() { std::pmr::set_default_resource(m_previous); }
+		ScopedDefaultResource(const ScopedDefaultResource&) = delete;
+		ScopedDefaultResource& operator=(const ScopedDefaultResource&) = delete;
+	private:
+		std::pmr::memory_resource* m_previous;
+	};
+
+	/// <summary>
+	/// Linear allocator for data that only lives for one frame (render queues, culling output, etc.)
+	/// Allocation bumps a pointer, deallocation does nothing, and reset() frees everything at once.
+	/// If a frame runs out of space the extra comes from upstream, and the block grows on the next reset
+	/// so steady state frames never touch the heap. Not thread safe.
+	/// </summary>
+	class FrameArena : public std::pmr::memory_resource {
+	public:
+		FrameArena(size_t capacity, std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+		~FrameArena();
+		FrameArena(const FrameArena&) = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+		//Call at the start of each frame. Everything allocated last frame is invalid after this.
+		void reset();
+		inline size_t getCapacity()const { return m_capacity; }
+		inline size_t getUsed()const { return m_used; }
+		//Allocations this frame that didn't fit and went to upstream
+		inline size_t getNumOverflowAllocations()const { return m_numOverflowAllocations; }
+	protected:
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override {};
+		bool do_is_equal(const std::pmr::memory_resource& other)const noexcept override { return this == &other; }
+	private:
+		struct OverflowBlock {
+			OverflowBlock* next;
+			size_t size;
+			size_t alignment;
+		};
+		void freeOverflow();
+		std::pmr::memory_resource* m_upstream;
+		unsigned char* m_buffer = nullptr;
+		size_t m_capacity = 0;
+		size_t m_used = 0;
+		size_t m_overflowBytes = 0;
+		size_t m_numOverflowAllocations = 0;
+		OverflowBlock* m_overflow = nullptr;
+	};
+
+	/// <summary>
+	/// Fixed-size object pool. Objects are carved out of blocks of BlockSize and recycled through a free list,
+	/// so creating and destroying objects only touches the heap when the pool has to grow.
+	/// </summary>
+	template<typename T, size_t BlockSize = 64>
+	class Pool {
+	public:
+		Pool(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) : m_upstream(upstream) {};
+		~Pool();
+		Pool(const Pool&) = delete;
+		Pool& operator=(const Pool&) = delete;
+
+		template<typename... Args>
+		T* create(Args&&... args);
+		void destroy(T* object);
+		inline size_t getNumAlive()const { return m_numAlive; }
+		inline size_t getNumBlocks()const { return m_numBlocks; }
+	private:
+		union Slot {
+			Slot* nextFree;
+			alignas(T) unsigned char storage[sizeof(T)];
+		};
+		struct Block {
+			Block* next;
+			Slot slots[BlockSize];
+		};
+		void grow();
+		std::pmr::memory_resource* m_upstream;
+		Block* m_blocks = nullptr;
+		Slot* m_freeList = nullptr;
+		size_t m_numAlive = 0;
+		size_t m_numBlocks = 0;
+	};
+
+	template<typename T, size_t BlockSize>
+	Pool<T, BlockSize>::~Pool()
+	{
+		//Objects still alive are not destroyed, only their memory is released
+		while (m_blocks != nullptr) {
+			Block* next = m_blocks->next;
+			m_upstream->deallocate(m_blocks, sizeof(Block), alignof(Block));
+			m_blocks = next;
+		}
+	}
+
+	template<typename T, size_t BlockSize>
+	template<typename... Args>
+	T* Pool<T, BlockSize>::create(Args&&... args)
+	{
+		if (m_freeList == nullptr) {
+			grow();
+		}
+		Slot* slot = m_freeList;
+		m_freeList = slot->nextFree;
+		m_numAlive++;
+		return new (slot->storage) T(std::forward<Args>(args)...);
+	}
+
+	template<typename T, size_t BlockSize>
+	void Pool<T, BlockSize>::destroy(T* object)
+	{
+		if (object == nullptr) {
+			return;
+		}
+		object->~T();
+		Slot* slot = reinterpret_cast<Slot*>(object);
+		slot->nextFree = m_freeList;
+		m_freeList = slot;
+		m_numAlive--;
+	}
+
+	template<typename T, size_t BlockSize>
+	void Pool<T, BlockSize>::grow()
+	{
+		Block* block = static_cast<Block*>(m_upstream->allocate(sizeof(Block), alignof(Block)));
+		block->next = m_blocks;
+		m_blocks = block;
+		m_numBlocks++;
+		for (size_t i = 0; i < BlockSize; i++)
+		{
+			block->slots[i].nextFree = i + 1 < BlockSize ? &block->slots[i + 1] : m_freeList;
+		}
+		m_freeList = &block->slots[0];
+	}
+}
@@ -6,65 +6,136 @@
 */
 
 #include "mesh.h"
+#include "meshCodec.h"
+#include "metrics.h"
 #include "external/glad.h"
+#include <stdio.h>
 
 namespace ew {
 	Mesh::Mesh(const MeshData& meshData)
 	{
 		load(meshData);
 	}
-	void Mesh::load(const MeshData& meshData)
+	//Buffer memory across all meshes, and upload time
+	static void recordMeshUpload(size_t oldBytes, size_t newBytes, std::chrono::steady_clock::time_point start)
+	{
+		static Gauge* bufferBytes = getMetrics().getGauge("ew_mesh_buffer_bytes", "GPU memory used by mesh vertex and index buffers");
+		static Histogram* uploadTime = getMetrics().getHistogram("ew_mesh_load_microseconds", "Mesh upload time, including decompression");
+		static Counter* meshesLoaded = getMetrics().getCounter("ew_meshes_loaded_total", "Meshes loaded");
+		bufferBytes->add((int64_t)newBytes - (int64_t)oldBytes);
+		uploadTime->record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+		meshesLoaded->add();
+	}
+	void Mesh::initialize(const VertexLayout& layout)
 	{
 		if (!m_initialized) {
-			glGenVertexArrays(1, &m_vao);
-			glBindVertexArray(m_vao);
-
-			glGenBuffers(1, &m_vbo);
-			glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-
-			glGenBuffers(1, &m_ebo);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-			//Position attribute
-			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, pos));
-			glEnableVertexAttribArray(0);
-
-			//Normal attribute
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
-			glEnableVertexAttribArray(1);
-
-			//UV attribute
-			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, uv)));
-			glEnableVertexAttribArray(2);
-
+			glCreateBuffers(1, &m_vbo);
+			glCreateBuffers(1, &m_ebo);
 			m_initialized = true;
 		}
+		//Attribute formats live in a vertex array shared by layout instead of one per mesh
+		m_layout = layout;
+		m_vao = getSharedVertexArray(layout);
+	}
+	void Mesh::load(const MeshData& meshData)
+	{
+		AABB bounds;
+		for (const Vertex& v : meshData.vertices) {
+			bounds.expand(v.pos);
+		}
+		upload(getVertexLayout<Vertex>(), meshData.vertices.data(), meshData.vertices.size(), meshData.indices.data(), meshData.indices.size(), bounds);
+	}
+	void Mesh::upload(const VertexLayout& layout, const void* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices, const AABB& bounds)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		initialize(layout);
 
-		glBindVertexArray(m_vao);
-		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-
-		if (meshData.vertices.size() > 0) {
-			glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * meshData.vertices.size(), meshData.vertices.data(), GL_STATIC_DRAW);
+		if (numVertices > 0) {
+			glNamedBufferData(m_vbo, (size_t)layout.stride * numVertices, vertices, GL_STATIC_DRAW);
 		}
-		if (meshData.indices.size() > 0) {
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * meshData.indices.size(), meshData.indices.data(), GL_STATIC_DRAW);
+		if (numIndices > 0) {
+			glNamedBufferData(m_ebo, sizeof(unsigned int) * numIndices, indices, GL_STATIC_DRAW);
 		}
-		m_numVertices = meshData.vertices.size();
-		m_numIndices = meshData.indices.size();
+		m_numVertices = numVertices;
+		m_numIndices = numIndices;
+		m_bounds = bounds;
+		size_t bufferBytes = (size_t)layout.stride * m_numVertices + sizeof(unsigned int) * m_numIndices;
+		recordMeshUpload(m_bufferBytes, bufferBytes, start);
+		m_bufferBytes = bufferBytes;
+	}
+	/// <summary>
+	/// Loads a mesh compressed with compressMesh. Buffers are mapped and decoded into directly, so no CPU copy is made.
+	/// </summary>
+	/// <param name="data">Compressed mesh, e.g. a mapped file or archive entry</param>
+	/// <param name="size">Size of data in bytes</param>
+	/// <param name="jobSystem">Optional. Blocks are decoded in parallel.</param>
+	/// <returns>False if the data is not a valid compressed mesh</returns>
+	bool Mesh::loadCompressed(const void* data, size_t size, JobSystem* jobSystem)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		CompressedMeshInfo info;
+		if (!getCompressedMeshInfo(data, size, &info)) {
+			printf("Invalid compressed mesh");
+			return false;
+		}
+		initialize(getVertexLayout<Vertex>());
+
+		//Allocate storage then map it, so decoding writes straight into driver memory
+		size_t vertexBytes = sizeof(Vertex) * info.numVertices;
+		size_t indexBytes = sizeof(unsigned int) * info.numIndices;
+		glNamedBufferData(m_vbo, vertexBytes, NULL, GL_STATIC_DRAW);
+		glNamedBufferData(m_ebo, indexBytes, NULL, GL_STATIC_DRAW);
+		bool decoded = true;
+		if (info.numVertices > 0) {
+			const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+			Vertex* vertices = (Vertex*)glMapNamedBufferRange(m_vbo, 0, vertexBytes, access);
+			unsigned int* indices = indexBytes > 0 ? (unsigned int*)glMapNamedBufferRange(m_ebo, 0, indexBytes, access) : nullptr;
+			decoded = vertices != nullptr && (indexBytes == 0 || indices != nullptr)
+				&& decompressMesh(data, size, vertices, indices, jobSystem);
+			if (indices != nullptr) {
+				glUnmapNamedBuffer(m_ebo);
+			}
+			if (vertices != nullptr) {
+				glUnmapNamedBuffer(m_vbo);
+			}
+		}
+		m_numVertices = decoded ? info.numVertices : 0;
+		m_numIndices = decoded ? info.numIndices : 0;
+		m_bounds = decoded ? info.bounds : AABB();
+		//Storage was allocated whether or not decoding worked
+		recordMeshUpload(m_bufferBytes, vertexBytes + indexBytes, start);
+		m_bufferBytes = vertexBytes + indexBytes;
 
-		glBindVertexArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		if (!decoded) {
+			printf("Failed to decode compressed mesh\n");
+		}
+		return decoded;
 	}
-	void Mesh::draw(ew::DrawMode drawMode) const
+	void Mesh::bind(unsigned int indexBuffer) const
 	{
+		glVertexArrayVertexBuffer(m_vao, 0, m_vbo, 0, m_layout.stride);
+		glVertexArrayElementBuffer(m_vao, indexBuffer);
 		glBindVertexArray(m_vao);
+	}
+	void Mesh::draw(ew::DrawMode drawMode) const
+	{
+		if (!m_initialized) {
+			return;
+		}
+		bind(m_ebo);
 		if (drawMode == DrawMode::TRIANGLES) {
 			glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, NULL);
 		}
 		else {
 			glDrawArrays(GL_POINTS, 0, m_numVertices);
 		}
-		
+	}
+	void Mesh::drawIndexRanges(unsigned int indexBuffer, const int* counts, const void* const* offsets, int numRanges) const
+	{
+		if (!m_initialized || numRanges <= 0) {
+			return;
+		}
+		bind(indexBuffer);
+		glMultiDrawElements(GL_TRIANGLES, counts, GL_UNSIGNED_INT, offsets, numRanges);
 	}
 }
\ No newline at end of file
@@ -3,7 +3,10 @@
 */
 
 #pragma once
+#include "bounds.h"
+#include "vertexLayout.h"
 #include <glm/glm.hpp>
+#include <memory_resource>
 #include <vector>
 
 namespace ew {
@@ -11,11 +14,24 @@ namespace ew {
 		glm::vec3 pos;
 		glm::vec3 normal;
 		glm::vec2 uv;
+		glm::vec4 tangent; //xyz = tangent, w = bitangent sign
 	};
 
+	template<> struct VertexFormat<Vertex> {
+		static constexpr VertexAttribute attributes[] = {
+			EW_VERTEX_ATTRIBUTE(0, Vertex, pos),
+			EW_VERTEX_ATTRIBUTE(1, Vertex, normal),
+			EW_VERTEX_ATTRIBUTE(2, Vertex, uv),
+			EW_VERTEX_ATTRIBUTE(3, Vertex, tangent)
+		};
+	};
+
+	//Allocates from the given memory resource, so transient meshes can live in a FrameArena
 	struct MeshData {
-		std::vector<Vertex> vertices;
-		std::vector<unsigned int> indices;
+		MeshData() : MeshData(std::pmr::get_default_resource()) {};
+		explicit MeshData(std::pmr::memory_resource* resource) : vertices(resource), indices(resource) {};
+		std::pmr::vector<Vertex> vertices;
+		std::pmr::vector<unsigned int> indices;
 	};
 
 	enum class DrawMode {
@@ -23,20 +39,45 @@ namespace ew {
 		POINTS = 1
 	};
 
+	class JobSystem;
+
 	class Mesh {
 	public:
 		Mesh() {};
 		Mesh(const MeshData& meshData);
 		void load(const MeshData& meshData);
+		//Loads vertices of any type with a VertexFormat, such as compact formats with normalized integer attributes.
+		//bounds are the model space bounds of the vertices.
+		template<typename V>
+		void load(const V* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices, const AABB& bounds) {
+			upload(getVertexLayout<V>(), vertices, numVertices, indices, numIndices, bounds);
+		}
+		//Decodes a mesh from compressMesh straight into mapped GPU buffers. Returns false if the data is invalid.
+		bool loadCompressed(const void* data, size_t size, JobSystem* jobSystem = nullptr);
 		void draw(DrawMode drawMode = DrawMode::TRIANGLES)const;
+		//Draws ranges of another index buffer over this mesh's vertices in one call, e.g. the meshlets that survived culling.
+		//offsets are in bytes, as glMultiDrawElements takes them.
+		void drawIndexRanges(unsigned int indexBuffer, const int* counts, const void* const* offsets, int numRanges)const;
 		inline int getNumVertices()const { return m_numVertices; }
 		inline int getNumIndices()const { return m_numIndices; }
+		//Vertex buffer handle, for compute shaders that write vertices in place
+		inline unsigned int getVertexBuffer()const { return m_vbo; }
+		//Model space bounds of the vertices last loaded
+		inline const AABB& getBounds()const { return m_bounds; }
+		inline const VertexLayout& getLayout()const { return m_layout; }
 	private:
+		void initialize(const VertexLayout& layout);
+		void upload(const VertexLayout& layout, const void* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices, const AABB& bounds);
+		//Points the shared vertex array at this mesh's buffers and binds it
+		void bind(unsigned int indexBuffer)const;
 		bool m_initialized = false;
-		unsigned int m_vao = 0;
+		VertexLayout m_layout;
+		unsigned int m_vao = 0; //Shared with every mesh of the same layout
 		unsigned int m_vbo = 0;
 		unsigned int m_ebo = 0;
 		unsigned int m_numVertices = 0;
 		unsigned int m_numIndices = 0;
+		size_t m_bufferBytes = 0; //Vertex + index buffer storage, reported to metrics
+		AABB m_bounds;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,518 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include "meshCodec.h"
+#include "jobSystem.h"
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+
+namespace ew {
+	static const char CODEC_MAGIC[4] = { 'E','W','M','Z' };
+	static const uint32_t CODEC_VERSION = 2; //2 added tangents
+	//Vertices per vertex block and triangles per index block. Each block decodes on its own.
+	static const uint32_t VERTEX_BLOCK_SIZE = 4096;
+	static const uint32_t INDEX_BLOCK_TRIANGLES = 4096;
+	static const int NUM_CHANNELS = 10; //Position xyz, octahedral normal xy, uv, octahedral tangent xy, bitangent sign
+	static const int EDGE_FIFO_SIZE = 15;
+	static const int VERTEX_FIFO_SIZE = 14;
+	//Vertex codes: 0 = next new vertex, 1-14 = vertex FIFO slot, 15 = explicit index follows
+	static const uint8_t VERTEX_CODE_EXPLICIT = 15;
+	//High nibble of a triangle code when no recent edge matched
+	static const uint8_t NO_EDGE = 15;
+
+	struct CodecHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t numVertices;
+		uint32_t numIndices;
+		uint32_t numVertexBlocks;
+		uint32_t numIndexBlocks;
+		float posMin[3];
+		float posMax[3];
+		float uvMin[2];
+		float uvMax[2];
+	};
+
+	//Bounds checked reader over the compressed payload
+	struct ByteReader {
+		const uint8_t* p;
+		const uint8_t* end;
+		bool ok = true;
+		inline uint8_t readByte() {
+			if (p >= end) {
+				ok = false;
+				return 0;
+			}
+			return *p++;
+		}
+		inline uint32_t readVarint() {
+			uint32_t value = 0;
+			for (int shift = 0; shift < 35; shift += 7) {
+				uint8_t byte = readByte();
+				value |= (uint32_t)(byte & 0x7f) << shift;
+				if (!(byte & 0x80)) {
+					return value;
+				}
+			}
+			ok = false;
+			return 0;
+		}
+	};
+
+	static void writeVarint(std::vector<uint8_t>& out, uint32_t value) {
+		while (value >= 0x80) {
+			out.push_back((uint8_t)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((uint8_t)value);
+	}
+
+	static inline uint32_t zigzag(int32_t v) {
+		return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+	}
+
+	static inline int32_t unzigzag(uint32_t v) {
+		return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+	}
+
+	static inline uint16_t quantize(float v, float min, float max) {
+		float range = max - min;
+		if (range <= 0.0f) {
+			return 0;
+		}
+		float t = glm::clamp((v - min) / range, 0.0f, 1.0f);
+		return (uint16_t)(t * 65535.0f + 0.5f);
+	}
+
+	static inline float dequantize(uint16_t q, float min, float max) {
+		return min + (max - min) * (q / 65535.0f);
+	}
+
+	//Maps a unit vector onto the octahedron folded into [-1,1]^2
+	static glm::vec2 octEncode(glm::vec3 n) {
+		float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+		if (l1 <= 0.0f) {
+			return glm::vec2(0.0f);
+		}
+		n /= l1;
+		glm::vec2 e = glm::vec2(n.x, n.y);
+		if (n.z < 0.0f) {
+			e.x = (1.0f - fabsf(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+			e.y = (1.0f - fabsf(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+		}
+		return e;
+	}
+
+	static glm::vec3 octDecode(glm::vec2 e) {
+		glm::vec3 n = glm::vec3(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
+		float t = glm::clamp(-n.z, 0.0f, 1.0f);
+		n.x += n.x >= 0.0f ? -t : t;
+		n.y += n.y >= 0.0f ? -t : t;
+		return glm::normalize(n);
+	}
+
+	/// <summary>
+	/// Recently seen edges and vertices. Encoder and decoder update it identically, so small FIFO slots
+	/// stand in for full indices. Slot 0 is always the most recent entry.
+	/// </summary>
+	struct IndexCodecState {
+		uint32_t edgeA[EDGE_FIFO_SIZE];
+		uint32_t edgeB[EDGE_FIFO_SIZE];
+		uint32_t vertices[VERTEX_FIFO_SIZE];
+		int edgeHead = 0;
+		int vertexHead = 0;
+		uint32_t next = 0; //One past the highest index seen
+
+		IndexCodecState(uint32_t firstIndex) : next(firstIndex) {
+			memset(edgeA, 0xff, sizeof(edgeA));
+			memset(edgeB, 0xff, sizeof(edgeB));
+			memset(vertices, 0xff, sizeof(vertices));
+		}
+		inline int findEdge(uint32_t a, uint32_t b)const {
+			for (int i = 0; i < EDGE_FIFO_SIZE; i++)
+			{
+				int slot = (edgeHead - 1 - i + EDGE_FIFO_SIZE) % EDGE_FIFO_SIZE;
+				if (edgeA[slot] == a && edgeB[slot] == b) {
+					return i;
+				}
+			}
+			return -1;
+		}
+		inline uint32_t getEdgeA(int i)const { return edgeA[(edgeHead - 1 - i + EDGE_FIFO_SIZE) % EDGE_FIFO_SIZE]; }
+		inline uint32_t getEdgeB(int i)const { return edgeB[(edgeHead - 1 - i + EDGE_FIFO_SIZE) % EDGE_FIFO_SIZE]; }
+		inline int findVertex(uint32_t v)const {
+			for (int i = 0; i < VERTEX_FIFO_SIZE; i++)
+			{
+				if (vertices[(vertexHead - 1 - i + VERTEX_FIFO_SIZE) % VERTEX_FIFO_SIZE] == v) {
+					return i;
+				}
+			}
+			return -1;
+		}
+		inline uint32_t getVertex(int i)const { return vertices[(vertexHead - 1 - i + VERTEX_FIFO_SIZE) % VERTEX_FIFO_SIZE]; }
+		inline void pushVertex(uint32_t v) {
+			vertices[vertexHead] = v;
+			vertexHead = (vertexHead + 1) % VERTEX_FIFO_SIZE;
+			next = std::max(next, v + 1);
+		}
+		//The neighbour across an edge walks it in the opposite direction, so store it reversed
+		inline void pushTriangle(uint32_t a, uint32_t b, uint32_t c) {
+			const uint32_t reversed[3][2] = { { b, a }, { c, b }, { a, c } };
+			for (int i = 0; i < 3; i++)
+			{
+				edgeA[edgeHead] = reversed[i][0];
+				edgeB[edgeHead] = reversed[i][1];
+				edgeHead = (edgeHead + 1) % EDGE_FIFO_SIZE;
+			}
+		}
+	};
+
+	//Returns the 4 bit code for v and updates state. Explicit indices are appended to explicitOut.
+	static uint8_t encodeVertex(IndexCodecState& state, uint32_t v, std::vector<uint32_t>& explicitOut) {
+		if (v == state.next) {
+			state.pushVertex(v);
+			return 0;
+		}
+		int slot = state.findVertex(v);
+		if (slot >= 0) {
+			return (uint8_t)(1 + slot);
+		}
+		explicitOut.push_back(zigzag((int32_t)(v - state.next)));
+		state.pushVertex(v);
+		return VERTEX_CODE_EXPLICIT;
+	}
+
+	static uint32_t decodeVertex(IndexCodecState& state, uint8_t code, ByteReader& reader) {
+		if (code == 0) {
+			uint32_t v = state.next;
+			state.pushVertex(v);
+			return v;
+		}
+		if (code != VERTEX_CODE_EXPLICIT) {
+			return state.getVertex(code - 1);
+		}
+		uint32_t v = state.next + (uint32_t)unzigzag(reader.readVarint());
+		state.pushVertex(v);
+		return v;
+	}
+
+	static void encodeIndexBlock(const unsigned int* indices, size_t numTriangles, std::vector<uint8_t>& out) {
+		IndexCodecState state(numTriangles > 0 ? indices[0] : 0);
+		writeVarint(out, state.next);
+		std::vector<uint32_t> explicitIndices;
+		for (size_t t = 0; t < numTriangles; t++)
+		{
+			const unsigned int* tri = indices + t * 3;
+			explicitIndices.clear();
+			//Any rotation keeps the winding, so use whichever one starts on a known edge
+			int edge = -1;
+			int rotation = 0;
+			for (int r = 0; r < 3 && edge < 0; r++)
+			{
+				edge = state.findEdge(tri[r], tri[(r + 1) % 3]);
+				rotation = r;
+			}
+			uint32_t a = tri[rotation], b = tri[(rotation + 1) % 3], c = tri[(rotation + 2) % 3];
+			if (edge >= 0) {
+				uint8_t code = encodeVertex(state, c, explicitIndices);
+				out.push_back((uint8_t)((edge << 4) | code));
+			}
+			else {
+				a = tri[0], b = tri[1], c = tri[2];
+				uint8_t codeA = encodeVertex(state, a, explicitIndices);
+				uint8_t codeB = encodeVertex(state, b, explicitIndices);
+				uint8_t codeC = encodeVertex(state, c, explicitIndices);
+				out.push_back((uint8_t)((NO_EDGE << 4) | codeA));
+				out.push_back((uint8_t)((codeB << 4) | codeC));
+			}
+			for (uint32_t e : explicitIndices) {
+				writeVarint(out, e);
+			}
+			state.pushTriangle(a, b, c);
+		}
+	}
+
+	static bool decodeIndexBlock(ByteReader reader, size_t numTriangles, uint32_t numVertices, unsigned int* indices) {
+		IndexCodecState state(reader.readVarint());
+		for (size_t t = 0; t < numTriangles && reader.ok; t++)
+		{
+			uint8_t code = reader.readByte();
+			uint32_t a, b, c;
+			if ((code >> 4) != NO_EDGE) {
+				int edge = code >> 4;
+				a = state.getEdgeA(edge);
+				b = state.getEdgeB(edge);
+				c = decodeVertex(state, code & 0xf, reader);
+			}
+			else {
+				uint8_t codesBC = reader.readByte();
+				a = decodeVertex(state, code & 0xf, reader);
+				b = decodeVertex(state, codesBC >> 4, reader);
+				c = decodeVertex(state, codesBC & 0xf, reader);
+			}
+			//Corrupt data could point past the vertex buffer
+			if (a >= numVertices || b >= numVertices || c >= numVertices) {
+				return false;
+			}
+			indices[t * 3] = a;
+			indices[t * 3 + 1] = b;
+			indices[t * 3 + 2] = c;
+			state.pushTriangle(a, b, c);
+		}
+		return reader.ok;
+	}
+
+	static void encodeVertexBlock(const uint16_t* channels, size_t numVertices, size_t stride, std::vector<uint8_t>& out) {
+		//Channel-major so each delta stream only sees one attribute
+		for (int c = 0; c < NUM_CHANNELS; c++)
+		{
+			int32_t prev = 0;
+			for (size_t i = 0; i < numVertices; i++)
+			{
+				int32_t value = channels[c * stride + i];
+				writeVarint(out, zigzag(value - prev));
+				prev = value;
+			}
+		}
+	}
+
+	//Decodes to scratch first so the destination (possibly write-combined GPU memory) is written once, in order
+	static bool decodeVertexBlock(ByteReader reader, const CodecHeader& header, size_t numVertices, Vertex* vertices, std::vector<uint16_t>& scratch) {
+		scratch.resize(numVertices * NUM_CHANNELS);
+		for (int c = 0; c < NUM_CHANNELS; c++)
+		{
+			int32_t prev = 0;
+			uint16_t* channel = scratch.data() + c * numVertices;
+			for (size_t i = 0; i < numVertices; i++)
+			{
+				prev += unzigzag(reader.readVarint());
+				channel[i] = (uint16_t)prev;
+			}
+		}
+		if (!reader.ok) {
+			return false;
+		}
+		const uint16_t* q = scratch.data();
+		for (size_t i = 0; i < numVertices; i++)
+		{
+			Vertex v;
+			v.pos.x = dequantize(q[i], header.posMin[0], header.posMax[0]);
+			v.pos.y = dequantize(q[numVertices + i], header.posMin[1], header.posMax[1]);
+			v.pos.z = dequantize(q[numVertices * 2 + i], header.posMin[2], header.posMax[2]);
+			v.normal = octDecode(glm::vec2(dequantize(q[numVertices * 3 + i], -1.0f, 1.0f), dequantize(q[numVertices * 4 + i], -1.0f, 1.0f)));
+			v.uv.x = dequantize(q[numVertices * 5 + i], header.uvMin[0], header.uvMax[0]);
+			v.uv.y = dequantize(q[numVertices * 6 + i], header.uvMin[1], header.uvMax[1]);
+			glm::vec3 tangent = octDecode(glm::vec2(dequantize(q[numVertices * 7 + i], -1.0f, 1.0f), dequantize(q[numVertices * 8 + i], -1.0f, 1.0f)));
+			v.tangent = glm::vec4(tangent, q[numVertices * 9 + i] != 0 ? 1.0f : -1.0f);
+			vertices[i] = v;
+		}
+		return true;
+	}
+
+	static size_t numBlocks(size_t count, size_t blockSize) {
+		return (count + blockSize - 1) / blockSize;
+	}
+
+	std::vector<unsigned char> compressMesh(const MeshData& mesh, MeshCodecStats* stats)
+	{
+		CodecHeader header;
+		memcpy(header.magic, CODEC_MAGIC, sizeof(CODEC_MAGIC));
+		header.version = CODEC_VERSION;
+		header.numVertices = (uint32_t)mesh.vertices.size();
+		header.numIndices = (uint32_t)(mesh.indices.size() / 3 * 3);
+		header.numVertexBlocks = (uint32_t)numBlocks(header.numVertices, VERTEX_BLOCK_SIZE);
+		header.numIndexBlocks = (uint32_t)numBlocks(header.numIndices / 3, INDEX_BLOCK_TRIANGLES);
+
+		AABB posBounds;
+		glm::vec2 uvMin = glm::vec2(0.0f), uvMax = glm::vec2(0.0f);
+		for (size_t i = 0; i < mesh.vertices.size(); i++)
+		{
+			const Vertex& v = mesh.vertices[i];
+			posBounds.expand(v.pos);
+			uvMin = i == 0 ? v.uv : glm::min(uvMin, v.uv);
+			uvMax = i == 0 ? v.uv : glm::max(uvMax, v.uv);
+		}
+		if (posBounds.isEmpty()) {
+			posBounds.expand(glm::vec3(0.0f));
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			header.posMin[i] = posBounds.min[i];
+			header.posMax[i] = posBounds.max[i];
+		}
+		for (int i = 0; i < 2; i++)
+		{
+			header.uvMin[i] = uvMin[i];
+			header.uvMax[i] = uvMax[i];
+		}
+
+		std::vector<uint8_t> payload;
+		std::vector<uint32_t> vertexOffsets, indexOffsets;
+		std::vector<uint16_t> channels;
+		for (uint32_t block = 0; block < header.numVertexBlocks; block++)
+		{
+			size_t first = (size_t)block * VERTEX_BLOCK_SIZE;
+			size_t count = std::min<size_t>(VERTEX_BLOCK_SIZE, header.numVertices - first);
+			channels.resize(count * NUM_CHANNELS);
+			for (size_t i = 0; i < count; i++)
+			{
+				const Vertex& v = mesh.vertices[first + i];
+				glm::vec2 oct = octEncode(v.normal);
+				glm::vec2 tangentOct = octEncode(glm::vec3(v.tangent));
+				channels[i] = quantize(v.pos.x, header.posMin[0], header.posMax[0]);
+				channels[count + i] = quantize(v.pos.y, header.posMin[1], header.posMax[1]);
+				channels[count * 2 + i] = quantize(v.pos.z, header.posMin[2], header.posMax[2]);
+				channels[count * 3 + i] = quantize(oct.x, -1.0f, 1.0f);
+				channels[count * 4 + i] = quantize(oct.y, -1.0f, 1.0f);
+				channels[count * 5 + i] = quantize(v.uv.x, header.uvMin[0], header.uvMax[0]);
+				channels[count * 6 + i] = quantize(v.uv.y, header.uvMin[1], header.uvMax[1]);
+				channels[count * 7 + i] = quantize(tangentOct.x, -1.0f, 1.0f);
+				channels[count * 8 + i] = quantize(tangentOct.y, -1.0f, 1.0f);
+				channels[count * 9 + i] = v.tangent.w < 0.0f ? 0 : 1;
+			}
+			vertexOffsets.push_back((uint32_t)payload.size());
+			encodeVertexBlock(channels.data(), count, count, payload);
+		}
+		vertexOffsets.push_back((uint32_t)payload.size());
+		size_t numTriangles = header.numIndices / 3;
+		for (uint32_t block = 0; block < header.numIndexBlocks; block++)
+		{
+			size_t first = (size_t)block * INDEX_BLOCK_TRIANGLES;
+			size_t count = std::min<size_t>(INDEX_BLOCK_TRIANGLES, numTriangles - first);
+			indexOffsets.push_back((uint32_t)payload.size());
+			encodeIndexBlock(mesh.indices.data() + first * 3, count, payload);
+		}
+		indexOffsets.push_back((uint32_t)payload.size());
+
+		std::vector<unsigned char> out(sizeof(CodecHeader) + sizeof(uint32_t) * (vertexOffsets.size() + indexOffsets.size()) + payload.size());
+		unsigned char* p = out.data();
+		memcpy(p, &header, sizeof(header));
+		p += sizeof(header);
+		memcpy(p, vertexOffsets.data(), sizeof(uint32_t) * vertexOffsets.size());
+		p += sizeof(uint32_t) * vertexOffsets.size();
+		memcpy(p, indexOffsets.data(), sizeof(uint32_t) * indexOffsets.size());
+		p += sizeof(uint32_t) * indexOffsets.size();
+		if (!payload.empty()) {
+			memcpy(p, payload.data(), payload.size());
+		}
+
+		if (stats != nullptr) {
+			stats->rawBytes = sizeof(Vertex) * mesh.vertices.size() + sizeof(unsigned int) * mesh.indices.size();
+			stats->compressedBytes = out.size();
+		}
+		return out;
+	}
+
+	static bool readHeader(const void* data, size_t size, CodecHeader* header) {
+		if (size < sizeof(CodecHeader)) {
+			return false;
+		}
+		memcpy(header, data, sizeof(CodecHeader));
+		if (memcmp(header->magic, CODEC_MAGIC, sizeof(CODEC_MAGIC)) != 0 || header->version != CODEC_VERSION) {
+			return false;
+		}
+		if (header->numVertexBlocks != numBlocks(header->numVertices, VERTEX_BLOCK_SIZE)
+			|| header->numIndexBlocks != numBlocks(header->numIndices / 3, INDEX_BLOCK_TRIANGLES)) {
+			return false;
+		}
+		size_t tableSize = sizeof(uint32_t) * ((size_t)header->numVertexBlocks + header->numIndexBlocks + 2);
+		return size >= sizeof(CodecHeader) + tableSize;
+	}
+
+	bool getCompressedMeshInfo(const void* data, size_t size, CompressedMeshInfo* info)
+	{
+		CodecHeader header;
+		if (!readHeader(data, size, &header)) {
+			return false;
+		}
+		info->numVertices = header.numVertices;
+		info->numIndices = header.numIndices;
+		info->bounds = AABB();
+		info->bounds.expand(glm::vec3(header.posMin[0], header.posMin[1], header.posMin[2]));
+		info->bounds.expand(glm::vec3(header.posMax[0], header.posMax[1], header.posMax[2]));
+		return true;
+	}
+
+	/// <summary>
+	/// Decodes a mesh written by compressMesh
+	/// </summary>
+	/// <param name="vertices">Room for numVertices from getCompressedMeshInfo</param>
+	/// <param name="indices">Room for numIndices from getCompressedMeshInfo</param>
+	/// <param name="jobSystem">Optional. Vertex and index blocks are decoded in parallel.</param>
+	/// <returns>False if the data is not a valid compressed mesh</returns>
+	bool decompressMesh(const void* data, size_t size, Vertex* vertices, unsigned int* indices, JobSystem* jobSystem)
+	{
+		CodecHeader header;
+		if (!readHeader(data, size, &header)) {
+			return false;
+		}
+		const uint8_t* bytes = (const uint8_t*)data;
+		const uint8_t* table = bytes + sizeof(CodecHeader);
+		const uint8_t* payload = table + sizeof(uint32_t) * (header.numVertexBlocks + header.numIndexBlocks + 2);
+		size_t payloadSize = size - (payload - bytes);
+		auto offset = [table](size_t i) {
+			uint32_t value;
+			memcpy(&value, table + sizeof(uint32_t) * i, sizeof(value));
+			return value;
+		};
+		auto blockReader = [&](size_t tableIndex) {
+			uint32_t begin = offset(tableIndex), end = offset(tableIndex + 1);
+			ByteReader reader = { payload + begin, payload + end };
+			reader.ok = begin <= end && end <= payloadSize;
+			if (!reader.ok) {
+				reader.p = reader.end = payload;
+			}
+			return reader;
+		};
+
+		//Vertex blocks first, then index blocks, all in one flat range
+		size_t numVertexBlocks = header.numVertexBlocks;
+		size_t numTotalBlocks = numVertexBlocks + header.numIndexBlocks;
+		std::atomic<bool> ok{ true };
+		auto decodeBlocks = [&](size_t begin, size_t end) {
+			//Owned by this range, so no buffer outlives the call
+			std::vector<uint16_t> scratch;
+			for (size_t block = begin; block < end; block++)
+			{
+				bool blockOk;
+				if (block < numVertexBlocks) {
+					size_t first = block * VERTEX_BLOCK_SIZE;
+					size_t count = std::min<size_t>(VERTEX_BLOCK_SIZE, header.numVertices - first);
+					blockOk = decodeVertexBlock(blockReader(block), header, count, vertices + first, scratch);
+				}
+				else {
+					size_t indexBlock = block - numVertexBlocks;
+					size_t first = indexBlock * INDEX_BLOCK_TRIANGLES;
+					size_t count = std::min<size_t>(INDEX_BLOCK_TRIANGLES, header.numIndices / 3 - first);
+					//Index offsets start after the vertex table's end marker
+					blockOk = decodeIndexBlock(blockReader(numVertexBlocks + 1 + indexBlock), count, header.numVertices, indices + first * 3);
+				}
+				if (!blockOk) {
+					ok = false;
+				}
+			}
+		};
+		if (jobSystem != nullptr) {
+			jobSystem->parallelFor(numTotalBlocks, 1, decodeBlocks);
+		}
+		else {
+			decodeBlocks(0, numTotalBlocks);
+		}
+		return ok;
+	}
+
+	bool decompressMesh(const void* data, size_t size, MeshData* mesh, JobSystem* jobSystem)
+	{
+		CompressedMeshInfo info;
+		if (!getCompressedMeshInfo(data, size, &info)) {
+			return false;
+		}
+		mesh->vertices.resize(info.numVertices);
+		mesh->indices.resize(info.numIndices);
+		return decompressMesh(data, size, mesh->vertices.data(), mesh->indices.data(), jobSystem);
+	}
+}
@@ -0,0 +1,37 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include "bounds.h"
+#include "mesh.h"
+#include <vector>
+
+namespace ew {
+	class JobSystem;
+
+	struct CompressedMeshInfo {
+		unsigned int numVertices = 0;
+		unsigned int numIndices = 0;
+		AABB bounds;
+	};
+
+	struct MeshCodecStats {
+		size_t rawBytes = 0; //Vertex + index buffer size
+		size_t compressedBytes = 0;
+		inline float ratio()const { return compressedBytes > 0 ? (float)rawBytes / compressedBytes : 0.0f; }
+	};
+
+	/// <summary>
+	/// Compresses a triangle mesh. Positions and UVs are quantized to 16 bits within their bounds, normals and tangents
+	/// are octahedral encoded, then each attribute is delta + zigzag + varint coded. Indices are coded per triangle
+	/// against recently seen edges and vertices. Both are split into blocks that decode independently.
+	/// Triangles may come back rotated (same winding), and attributes are lossy.
+	/// </summary>
+	std::vector<unsigned char> compressMesh(const MeshData& mesh, MeshCodecStats* stats = nullptr);
+	//Reads counts and bounds from the header. Returns false if this isn't a compressed mesh.
+	bool getCompressedMeshInfo(const void* data, size_t size, CompressedMeshInfo* info);
+	//Decodes straight into caller memory, e.g. mapped GPU buffers. Blocks fan out over the job system if given.
+	bool decompressMesh(const void* data, size_t size, Vertex* vertices, unsigned int* indices, JobSystem* jobSystem = nullptr);
+	bool decompressMesh(const void* data, size_t size, MeshData* mesh, JobSystem* jobSystem = nullptr);
+}
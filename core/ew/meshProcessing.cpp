@@ -0,0 +1,319 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include "meshProcessing.h"
+#include "jobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <memory_resource>
+#include <new>
+#include <numeric>
+#include <type_traits>
+#include <math.h>
+
+namespace ew {
+	static const size_t TRIANGLE_GRAIN = 4096;
+	static const size_t VERTEX_GRAIN = 8192;
+	static const float EPSILON = 1e-12f;
+
+	//Triangles sharing a vertex can land on different threads, so sums are added without a lock
+	static inline void atomicAdd(std::atomic<float>& target, float value) {
+		float expected = target.load(std::memory_order_relaxed);
+		while (!target.compare_exchange_weak(expected, expected + value, std::memory_order_relaxed)) {}
+	}
+
+	static inline void atomicAdd(std::atomic<float>* target, const glm::vec3& value) {
+		atomicAdd(target[0], value.x);
+		atomicAdd(target[1], value.y);
+		atomicAdd(target[2], value.z);
+	}
+
+	static inline glm::vec3 atomicLoad(const std::atomic<float>* source) {
+		return glm::vec3(source[0].load(std::memory_order_relaxed), source[1].load(std::memory_order_relaxed), source[2].load(std::memory_order_relaxed));
+	}
+
+	template<typename Fn>
+	static void forRange(size_t count, size_t grainSize, JobSystem* jobSystem, const Fn& fn) {
+		if (jobSystem != nullptr) {
+			jobSystem->parallelFor(count, grainSize, fn);
+		}
+		else {
+			fn(0, count);
+		}
+	}
+
+	/// <summary>
+	/// Uninitialized array from a memory resource, freed when this goes out of scope. Scratch comes from the mesh's own
+	/// resource, so a mesh built in a FrameArena doesn't touch the heap. Elements must be constructed before use.
+	/// </summary>
+	template<typename T>
+	class ScratchArray {
+	public:
+		static_assert(std::is_trivially_destructible<T>::value, "ScratchArray never runs destructors");
+		ScratchArray(size_t count, std::pmr::memory_resource* resource) : m_resource(resource), m_count(count) {
+			m_data = count > 0 ? static_cast<T*>(resource->allocate(sizeof(T) * count, alignof(T))) : nullptr;
+		}
+		~ScratchArray() {
+			if (m_data != nullptr) {
+				m_resource->deallocate(m_data, sizeof(T) * m_count, alignof(T));
+			}
+		}
+		ScratchArray(const ScratchArray&) = delete;
+		ScratchArray& operator=(const ScratchArray&) = delete;
+		inline T& operator[](size_t i) { return m_data[i]; }
+		inline const T& operator[](size_t i)const { return m_data[i]; }
+	private:
+		std::pmr::memory_resource* m_resource;
+		T* m_data;
+		size_t m_count;
+	};
+
+	//Constructs count zeroed floats, spread over the job system since it touches a lot of memory
+	static void zeroSums(ScratchArray<std::atomic<float>>& sums, size_t count, JobSystem* jobSystem) {
+		forRange(count, VERTEX_GRAIN, jobSystem, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+			{
+				new (&sums[i]) std::atomic<float>(0.0f);
+			}
+		});
+	}
+
+	static inline std::pmr::memory_resource* getResource(const MeshData& mesh) {
+		return mesh.vertices.get_allocator().resource();
+	}
+
+	//Interior angle at each corner. Each edge is normalized once and shared by the two corners it touches.
+	static void cornerAngles(const glm::vec3* p, float* angles) {
+		glm::vec3 edges[3];
+		for (int c = 0; c < 3; c++)
+		{
+			glm::vec3 e = p[(c + 1) % 3] - p[c];
+			float length2 = glm::dot(e, e);
+			edges[c] = length2 > EPSILON ? e / sqrtf(length2) : glm::vec3(0.0f);
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			//Outgoing edge against the reversed incoming edge
+			angles[c] = acosf(glm::clamp(-glm::dot(edges[c], edges[(c + 2) % 3]), -1.0f, 1.0f));
+		}
+	}
+
+	//Component of v perpendicular to unit vector n, normalized. Zero if v is (nearly) parallel to n.
+	static glm::vec3 projectOntoPlane(const glm::vec3& v, const glm::vec3& n) {
+		glm::vec3 p = v - n * glm::dot(n, v);
+		float length2 = glm::dot(p, p);
+		return length2 > EPSILON ? p / sqrtf(length2) : glm::vec3(0.0f);
+	}
+
+	//Any unit vector perpendicular to unit vector n
+	static glm::vec3 anyPerpendicular(const glm::vec3& n) {
+		glm::vec3 axis = fabsf(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		glm::vec3 p = glm::cross(axis, n);
+		float length2 = glm::dot(p, p);
+		return length2 > EPSILON ? p / sqrtf(length2) : axis;
+	}
+
+	//Reads triangle t's indices, rejecting any outside the vertex buffer
+	static inline bool getTriangle(const MeshData& mesh, size_t t, unsigned int* i) {
+		size_t numVertices = mesh.vertices.size();
+		for (int c = 0; c < 3; c++)
+		{
+			i[c] = mesh.indices[t * 3 + c];
+			if (i[c] >= numVertices) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//Index of the first vertex at each vertex's position. Importers copy the position exactly when they split a vertex
+	//along a UV seam or hard edge, so sorting finds the copies without an epsilon.
+	static std::pmr::vector<unsigned int> weldByPosition(const MeshData& mesh) {
+		size_t numVertices = mesh.vertices.size();
+		std::pmr::vector<unsigned int> order(numVertices, getResource(mesh));
+		std::iota(order.begin(), order.end(), 0u);
+		std::sort(order.begin(), order.end(), [&mesh](unsigned int a, unsigned int b) {
+			const glm::vec3& pa = mesh.vertices[a].pos;
+			const glm::vec3& pb = mesh.vertices[b].pos;
+			if (pa.x != pb.x) {
+				return pa.x < pb.x;
+			}
+			if (pa.y != pb.y) {
+				return pa.y < pb.y;
+			}
+			if (pa.z != pb.z) {
+				return pa.z < pb.z;
+			}
+			return a < b;
+		});
+		std::pmr::vector<unsigned int> welded(numVertices, getResource(mesh));
+		for (size_t i = 0; i < numVertices;)
+		{
+			unsigned int first = order[i];
+			for (; i < numVertices && mesh.vertices[order[i]].pos == mesh.vertices[first].pos; i++)
+			{
+				welded[order[i]] = first;
+			}
+		}
+		return welded;
+	}
+
+	void generateNormals(MeshData* mesh, JobSystem* jobSystem)
+	{
+		size_t numVertices = mesh->vertices.size();
+		size_t numTriangles = mesh->indices.size() / 3;
+		std::pmr::vector<unsigned int> welded = weldByPosition(*mesh);
+		ScratchArray<std::atomic<float>> sums(numVertices * 3, getResource(*mesh));
+		zeroSums(sums, numVertices * 3, jobSystem);
+
+		forRange(numTriangles, TRIANGLE_GRAIN, jobSystem, [&](size_t begin, size_t end) {
+			for (size_t t = begin; t < end; t++)
+			{
+				unsigned int i[3];
+				if (!getTriangle(*mesh, t, i)) {
+					continue;
+				}
+				glm::vec3 p[3] = { mesh->vertices[i[0]].pos, mesh->vertices[i[1]].pos, mesh->vertices[i[2]].pos };
+				glm::vec3 faceNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+				float length2 = glm::dot(faceNormal, faceNormal);
+				if (length2 <= EPSILON) {
+					continue;
+				}
+				faceNormal /= sqrtf(length2);
+				float angles[3];
+				cornerAngles(p, angles);
+				for (int c = 0; c < 3; c++)
+				{
+					atomicAdd(&sums[welded[i[c]] * 3], faceNormal * angles[c]);
+				}
+			}
+		});
+
+		forRange(numVertices, VERTEX_GRAIN, jobSystem, [&](size_t begin, size_t end) {
+			for (size_t v = begin; v < end; v++)
+			{
+				glm::vec3 sum = atomicLoad(&sums[welded[v] * 3]);
+				float length2 = glm::dot(sum, sum);
+				if (length2 > EPSILON) {
+					mesh->vertices[v].normal = sum / sqrtf(length2);
+				}
+			}
+		});
+	}
+
+	//Which way a triangle's UVs wind. Mirrored UVs wind the other way, and their tangent frames can't be averaged with unmirrored ones.
+	enum TriangleOrientation : unsigned char {
+		UV_POSITIVE = 0,
+		UV_NEGATIVE = 1,
+		UV_DEGENERATE = 2
+	};
+
+	void generateTangents(MeshData* mesh, JobSystem* jobSystem, std::vector<unsigned int>* splitSources)
+	{
+		size_t numVertices = mesh->vertices.size();
+		size_t numTriangles = mesh->indices.size() / 3;
+		std::pmr::memory_resource* resource = getResource(*mesh);
+		//Tangent xyz then bitangent xyz per vertex, once for each UV orientation
+		ScratchArray<std::atomic<float>> sums(numVertices * 12, resource);
+		zeroSums(sums, numVertices * 12, jobSystem);
+		//Bit per orientation of the triangles using each vertex
+		ScratchArray<std::atomic<unsigned char>> orientations(numVertices, resource);
+		for (size_t v = 0; v < numVertices; v++)
+		{
+			new (&orientations[v]) std::atomic<unsigned char>(0);
+		}
+		std::pmr::vector<unsigned char> triangleOrientations(numTriangles, UV_DEGENERATE, resource);
+
+		forRange(numTriangles, TRIANGLE_GRAIN, jobSystem, [&](size_t begin, size_t end) {
+			for (size_t t = begin; t < end; t++)
+			{
+				unsigned int i[3];
+				if (!getTriangle(*mesh, t, i)) {
+					continue;
+				}
+				const Vertex& v0 = mesh->vertices[i[0]];
+				const Vertex& v1 = mesh->vertices[i[1]];
+				const Vertex& v2 = mesh->vertices[i[2]];
+				glm::vec3 e1 = v1.pos - v0.pos, e2 = v2.pos - v0.pos;
+				glm::vec2 d1 = v1.uv - v0.uv, d2 = v2.uv - v0.uv;
+				//Signed UV area. Zero means the UVs can't define a tangent, so the triangle doesn't vote.
+				float det = d1.x * d2.y - d2.x * d1.y;
+				if (fabsf(det) <= EPSILON) {
+					continue;
+				}
+				unsigned char orientation = det > 0.0f ? UV_POSITIVE : UV_NEGATIVE;
+				triangleOrientations[t] = orientation;
+				float r = 1.0f / det;
+				glm::vec3 faceTangent = (e1 * d2.y - e2 * d1.y) * r;
+				glm::vec3 faceBitangent = (e2 * d1.x - e1 * d2.x) * r;
+				glm::vec3 p[3] = { v0.pos, v1.pos, v2.pos };
+				float angles[3];
+				cornerAngles(p, angles);
+				for (int c = 0; c < 3; c++)
+				{
+					const glm::vec3& n = mesh->vertices[i[c]].normal;
+					std::atomic<float>* sum = &sums[i[c] * 12 + orientation * 6];
+					atomicAdd(sum, projectOntoPlane(faceTangent, n) * angles[c]);
+					atomicAdd(sum + 3, projectOntoPlane(faceBitangent, n) * angles[c]);
+					orientations[i[c]].fetch_or((unsigned char)(1 << orientation), std::memory_order_relaxed);
+				}
+			}
+		});
+
+		//A vertex used by both orientations sits on a mirror seam. Like MikkTSpace, it is split in two:
+		//the original keeps the unmirrored frame, and a copy takes the mirrored one.
+		std::pmr::vector<unsigned int> splits(numVertices, 0, resource);
+		std::pmr::vector<unsigned int> sources(resource);
+		for (size_t v = 0; v < numVertices; v++)
+		{
+			if (orientations[v].load(std::memory_order_relaxed) == 3) {
+				splits[v] = (unsigned int)(numVertices + sources.size());
+				sources.push_back((unsigned int)v);
+			}
+		}
+		if (!sources.empty()) {
+			mesh->vertices.reserve(numVertices + sources.size());
+			for (unsigned int source : sources)
+			{
+				mesh->vertices.push_back(mesh->vertices[source]);
+			}
+			forRange(numTriangles, TRIANGLE_GRAIN, jobSystem, [&](size_t begin, size_t end) {
+				for (size_t t = begin; t < end; t++)
+				{
+					if (triangleOrientations[t] != UV_NEGATIVE) {
+						continue;
+					}
+					for (int c = 0; c < 3; c++)
+					{
+						unsigned int& index = mesh->indices[t * 3 + c];
+						if (splits[index] != 0) {
+							index = splits[index];
+						}
+					}
+				}
+			});
+		}
+
+		forRange(mesh->vertices.size(), VERTEX_GRAIN, jobSystem, [&](size_t begin, size_t end) {
+			for (size_t v = begin; v < end; v++)
+			{
+				Vertex& vertex = mesh->vertices[v];
+				//Copies read their source's mirrored sums. Vertices only mirrored triangles use read their own.
+				size_t source = v < numVertices ? v : sources[v - numVertices];
+				bool mirrored = v >= numVertices || orientations[v].load(std::memory_order_relaxed) == (1 << UV_NEGATIVE);
+				const std::atomic<float>* sum = &sums[source * 12 + (mirrored ? 6 : 0)];
+				glm::vec3 tangent = projectOntoPlane(atomicLoad(sum), vertex.normal);
+				if (tangent == glm::vec3(0.0f)) {
+					tangent = anyPerpendicular(vertex.normal);
+				}
+				glm::vec3 bitangent = atomicLoad(sum + 3);
+				float sign = glm::dot(glm::cross(vertex.normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+				vertex.tangent = glm::vec4(tangent, sign);
+			}
+		});
+		if (splitSources != nullptr) {
+			splitSources->assign(sources.begin(), sources.end());
+		}
+	}
+}
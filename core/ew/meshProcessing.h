@@ -0,0 +1,33 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include "mesh.h"
+#include <vector>
+
+namespace ew {
+	class JobSystem;
+
+	/// <summary>
+	/// Smooth vertex normals from the triangles around each position, weighted by the angle each triangle makes
+	/// at that vertex. Vertices at exactly the same position are welded first, so copies the importer made along
+	/// UV seams and hard edges get the same normal instead of showing a seam, as with Assimp's GenSmoothNormals.
+	/// Triangles are spread over the job system if given. Vertices no triangle uses keep their old normal.
+	/// Scratch comes from the mesh's memory resource.
+	/// </summary>
+	void generateNormals(MeshData* mesh, JobSystem* jobSystem = nullptr);
+
+	/// <summary>
+	/// Per vertex tangents following MikkTSpace's rules: each triangle's UV tangent and bitangent are projected
+	/// onto the plane of the vertex normal and angle weighted, then the sum is orthonormalized against the normal.
+	/// w holds the bitangent sign, so bitangent = cross(normal, tangent.xyz) * tangent.w in the shader.
+	/// Needs normals. Vertices without usable UVs get an arbitrary tangent perpendicular to the normal.
+	/// Vertices shared by triangles with mirrored and unmirrored UVs are split, since their frames would cancel out.
+	/// The copies are appended to the vertices and the mirrored triangles' indices are remapped to them.
+	/// Like generateNormals, scratch comes from the mesh's memory resource, so meshes in a FrameArena stay off the heap.
+	/// </summary>
+	/// <param name="splitSources">Optional. Receives the vertex each appended copy came from,
+	/// so per vertex data kept elsewhere, like skin weights, can be extended to match.</param>
+	void generateTangents(MeshData* mesh, JobSystem* jobSystem = nullptr, std::vector<unsigned int>* splitSources = nullptr);
+}
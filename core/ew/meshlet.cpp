@@ -0,0 +1,307 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include "meshlet.h"
+#include "bounds.h"
+#include <algorithm>
+#include <math.h>
+
+namespace ew {
+	//Normals spread wider than this (about 84 degrees from the axis) make a cone that could never cull
+	static const float MIN_CONE_DOT = 0.1f;
+
+	/// <summary>
+	/// Growth state for the meshlet being built. localIndex maps mesh vertices to meshlet vertices,
+	/// and is reset for just this meshlet's vertices once it's finished.
+	/// </summary>
+	struct MeshletBuilder {
+		const MeshData& mesh;
+		MeshletData& out;
+		std::vector<unsigned int> adjacencyOffsets; //Triangles around vertex v are adjacency[offsets[v] .. offsets[v + 1])
+		std::vector<unsigned int> adjacency;
+		std::vector<unsigned char> emitted; //Per triangle
+		std::vector<int> localIndex; //Per mesh vertex, -1 if not in the current meshlet
+		Meshlet meshlet;
+		glm::vec3 positionSum = glm::vec3(0.0f); //Of the current meshlet's vertices
+
+		MeshletBuilder(const MeshData& mesh, MeshletData& out) : mesh(mesh), out(out) {}
+
+		inline unsigned int corner(size_t triangle, int c)const { return mesh.indices[triangle * 3 + c]; }
+
+		int numNewVertices(size_t triangle)const {
+			int count = 0;
+			for (int c = 0; c < 3; c++)
+			{
+				count += localIndex[corner(triangle, c)] < 0;
+			}
+			return count;
+		}
+
+		void addTriangle(size_t triangle) {
+			for (int c = 0; c < 3; c++)
+			{
+				unsigned int v = corner(triangle, c);
+				if (localIndex[v] < 0) {
+					localIndex[v] = meshlet.numVertices++;
+					out.vertices.push_back(v);
+					positionSum += mesh.vertices[v].pos;
+				}
+				out.triangles.push_back((unsigned char)localIndex[v]);
+			}
+			meshlet.numTriangles++;
+			emitted[triangle] = 1;
+		}
+
+		/// <summary>
+		/// Unused triangle around vertex that adds the fewest new vertices and still fits. Ties go to the triangle
+		/// closest to the meshlet's centroid, which keeps meshlets round instead of growing long strips whose
+		/// normals spread too far to cull. Returns false if nothing better than the current best was found.
+		/// </summary>
+		bool findNeighbor(unsigned int vertex, size_t* best, int* bestNewVertices, float* bestDistance)const {
+			bool found = false;
+			glm::vec3 centroid = positionSum / (float)meshlet.numVertices;
+			for (unsigned int i = adjacencyOffsets[vertex]; i < adjacencyOffsets[vertex + 1]; i++)
+			{
+				unsigned int triangle = adjacency[i];
+				if (emitted[triangle]) {
+					continue;
+				}
+				int newVertices = numNewVertices(triangle);
+				if (meshlet.numVertices + newVertices > MAX_MESHLET_VERTICES || newVertices > *bestNewVertices) {
+					continue;
+				}
+				glm::vec3 d = (mesh.vertices[corner(triangle, 0)].pos + mesh.vertices[corner(triangle, 1)].pos
+					+ mesh.vertices[corner(triangle, 2)].pos) / 3.0f - centroid;
+				float distance = glm::dot(d, d);
+				if (newVertices < *bestNewVertices || distance < *bestDistance) {
+					*best = triangle;
+					*bestNewVertices = newVertices;
+					*bestDistance = distance;
+					found = true;
+				}
+			}
+			return found;
+		}
+	};
+
+	//Bounding sphere and normal cone from the meshlet's vertices and triangles
+	static void computeMeshletBounds(const MeshData& mesh, const MeshletData& data, Meshlet* meshlet) {
+		const unsigned int* vertices = data.vertices.data() + meshlet->vertexOffset;
+		AABB box;
+		for (unsigned int i = 0; i < meshlet->numVertices; i++)
+		{
+			box.expand(mesh.vertices[vertices[i]].pos);
+		}
+		meshlet->center = box.center();
+		float radius2 = 0.0f;
+		for (unsigned int i = 0; i < meshlet->numVertices; i++)
+		{
+			glm::vec3 d = mesh.vertices[vertices[i]].pos - meshlet->center;
+			radius2 = std::max(radius2, glm::dot(d, d));
+		}
+		meshlet->radius = sqrtf(radius2);
+
+		//Face normals, skipping degenerate triangles that can't be seen anyway
+		glm::vec3 normals[MAX_MESHLET_TRIANGLES];
+		glm::vec3 firstCorners[MAX_MESHLET_TRIANGLES];
+		unsigned int numNormals = 0;
+		glm::vec3 axis = glm::vec3(0.0f);
+		const unsigned char* triangles = data.triangles.data() + (size_t)meshlet->triangleOffset * 3;
+		for (unsigned int t = 0; t < meshlet->numTriangles; t++)
+		{
+			glm::vec3 a = mesh.vertices[vertices[triangles[t * 3]]].pos;
+			glm::vec3 b = mesh.vertices[vertices[triangles[t * 3 + 1]]].pos;
+			glm::vec3 c = mesh.vertices[vertices[triangles[t * 3 + 2]]].pos;
+			glm::vec3 n = glm::cross(b - a, c - a);
+			float length2 = glm::dot(n, n);
+			if (length2 <= 1e-20f) {
+				continue;
+			}
+			normals[numNormals] = n / sqrtf(length2);
+			firstCorners[numNormals] = a;
+			axis += normals[numNormals];
+			numNormals++;
+		}
+		meshlet->coneApex = meshlet->center;
+		meshlet->coneCutoff = 2.0f;
+		float axisLength = glm::length(axis);
+		if (numNormals == 0 || axisLength <= 1e-6f) {
+			return;
+		}
+		axis /= axisLength;
+		meshlet->coneAxis = axis;
+		float minDot = 1.0f;
+		for (unsigned int i = 0; i < numNormals; i++)
+		{
+			minDot = std::min(minDot, glm::dot(axis, normals[i]));
+		}
+		if (minDot <= MIN_CONE_DOT) {
+			return;
+		}
+		//Slide the apex back along the axis until it is behind every triangle's plane
+		float maxT = 0.0f;
+		for (unsigned int i = 0; i < numNormals; i++)
+		{
+			float t = glm::dot(meshlet->center - firstCorners[i], normals[i]) / glm::dot(axis, normals[i]);
+			maxT = std::max(maxT, t);
+		}
+		meshlet->coneApex = meshlet->center - axis * maxT;
+		meshlet->coneCutoff = sqrtf(1.0f - minDot * minDot);
+	}
+
+	MeshletData buildMeshlets(const MeshData& mesh)
+	{
+		MeshletData out;
+		size_t numVertices = mesh.vertices.size();
+		size_t numTriangles = mesh.indices.size() / 3;
+		MeshletBuilder builder(mesh, out);
+		builder.emitted.assign(numTriangles, 0);
+		builder.localIndex.assign(numVertices, -1);
+
+		//Triangles referencing vertices past the end are dropped up front
+		builder.adjacencyOffsets.assign(numVertices + 1, 0);
+		for (size_t t = 0; t < numTriangles; t++)
+		{
+			bool valid = builder.corner(t, 0) < numVertices && builder.corner(t, 1) < numVertices && builder.corner(t, 2) < numVertices;
+			if (!valid) {
+				builder.emitted[t] = 1;
+				continue;
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				builder.adjacencyOffsets[builder.corner(t, c) + 1]++;
+			}
+		}
+		for (size_t v = 0; v < numVertices; v++)
+		{
+			builder.adjacencyOffsets[v + 1] += builder.adjacencyOffsets[v];
+		}
+		builder.adjacency.resize(builder.adjacencyOffsets[numVertices]);
+		std::vector<unsigned int> cursor(builder.adjacencyOffsets.begin(), builder.adjacencyOffsets.end() - 1);
+		for (size_t t = 0; t < numTriangles; t++)
+		{
+			if (builder.emitted[t]) {
+				continue;
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				builder.adjacency[cursor[builder.corner(t, c)]++] = (unsigned int)t;
+			}
+		}
+
+		size_t seed = 0;
+		while (true)
+		{
+			while (seed < numTriangles && builder.emitted[seed]) {
+				seed++;
+			}
+			if (seed == numTriangles) {
+				break;
+			}
+			builder.meshlet = Meshlet();
+			builder.positionSum = glm::vec3(0.0f);
+			builder.meshlet.vertexOffset = (unsigned int)out.vertices.size();
+			builder.meshlet.triangleOffset = (unsigned int)out.getNumTriangles();
+			size_t last = seed;
+			builder.addTriangle(last);
+			while (builder.meshlet.numTriangles < MAX_MESHLET_TRIANGLES)
+			{
+				//Neighbors of the newest triangle first, since that's where the free edges are.
+				//Fall back to the whole meshlet's border, and stop once nothing connected fits.
+				size_t best = 0;
+				int bestNewVertices = 3;
+				float bestDistance = INFINITY;
+				bool found = false;
+				for (int c = 0; c < 3; c++)
+				{
+					found |= builder.findNeighbor(builder.corner(last, c), &best, &bestNewVertices, &bestDistance);
+				}
+				for (unsigned int i = 0; i < builder.meshlet.numVertices && !found; i++)
+				{
+					found |= builder.findNeighbor(out.vertices[builder.meshlet.vertexOffset + i], &best, &bestNewVertices, &bestDistance);
+				}
+				if (!found) {
+					break;
+				}
+				builder.addTriangle(best);
+				last = best;
+			}
+			for (unsigned int i = 0; i < builder.meshlet.numVertices; i++)
+			{
+				builder.localIndex[out.vertices[builder.meshlet.vertexOffset + i]] = -1;
+			}
+			computeMeshletBounds(mesh, out, &builder.meshlet);
+			out.meshlets.push_back(builder.meshlet);
+		}
+		return out;
+	}
+
+	std::vector<unsigned int> buildMeshletIndices(const MeshletData& meshletData)
+	{
+		std::vector<unsigned int> indices;
+		indices.reserve(meshletData.triangles.size());
+		for (const Meshlet& meshlet : meshletData.meshlets)
+		{
+			const unsigned int* vertices = meshletData.vertices.data() + meshlet.vertexOffset;
+			const unsigned char* triangles = meshletData.triangles.data() + (size_t)meshlet.triangleOffset * 3;
+			for (unsigned int i = 0; i < meshlet.numTriangles * 3; i++)
+			{
+				indices.push_back(vertices[triangles[i]]);
+			}
+		}
+		return indices;
+	}
+
+	void cullMeshlets(const MeshletData& meshletData, const glm::mat4& modelMatrix, const Camera& camera,
+		MeshletDrawRanges* ranges, MeshletCullStats* stats)
+	{
+		ranges->clear();
+		//Spheres are tested in model space, so the frustum is too
+		Frustum frustum(camera.projectionMatrix() * camera.viewMatrix() * modelMatrix);
+		//Cones are tested in world space. Axes only stay valid under rotation and uniform scale.
+		glm::mat3 linear = glm::mat3(modelMatrix);
+		float scaleX = glm::length(linear[0]), scaleY = glm::length(linear[1]), scaleZ = glm::length(linear[2]);
+		float maxScale = std::max(scaleX, std::max(scaleY, scaleZ));
+		float minScale = std::min(scaleX, std::min(scaleY, scaleZ));
+		bool coneCulling = minScale > 0.0f && maxScale - minScale <= maxScale * 0.01f;
+		glm::vec3 forward = glm::normalize(camera.target - camera.position);
+
+		MeshletCullStats frameStats;
+		frameStats.numMeshlets = (unsigned int)meshletData.meshlets.size();
+		frameStats.numTriangles = (unsigned int)meshletData.getNumTriangles();
+		for (const Meshlet& meshlet : meshletData.meshlets)
+		{
+			if (!frustum.intersectsSphere(meshlet.center, meshlet.radius)) {
+				frameStats.numFrustumCulled++;
+				continue;
+			}
+			if (coneCulling && meshlet.coneCutoff <= 1.0f) {
+				glm::vec3 apex = glm::vec3(modelMatrix * glm::vec4(meshlet.coneApex, 1.0f));
+				glm::vec3 axis = linear * meshlet.coneAxis / scaleX;
+				//Orthographic cameras view every point along the same direction
+				glm::vec3 view = camera.orthographic ? forward : glm::normalize(apex - camera.position);
+				if (glm::dot(view, axis) >= meshlet.coneCutoff) {
+					frameStats.numBackfaceCulled++;
+					continue;
+				}
+			}
+			//Meshlets are laid out back to back, so a survivor right after the last one extends its range
+			size_t first = (size_t)meshlet.triangleOffset * 3;
+			int count = (int)(meshlet.numTriangles * 3);
+			size_t end = ranges->counts.empty() ? ~(size_t)0
+				: (size_t)ranges->offsets.back() / sizeof(unsigned int) + ranges->counts.back();
+			if (end == first) {
+				ranges->counts.back() += count;
+			}
+			else {
+				ranges->counts.push_back(count);
+				ranges->offsets.push_back((const void*)(first * sizeof(unsigned int)));
+			}
+			frameStats.numTrianglesDrawn += meshlet.numTriangles;
+		}
+		if (stats != nullptr) {
+			*stats = frameStats;
+		}
+	}
+}
@@ -0,0 +1,86 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include "camera.h"
+#include "mesh.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace ew {
+	static const unsigned int MAX_MESHLET_VERTICES = 64;
+	static const unsigned int MAX_MESHLET_TRIANGLES = 124;
+
+	struct Meshlet {
+		unsigned int vertexOffset = 0; //First entry in MeshletData::vertices
+		unsigned int triangleOffset = 0; //First triangle in MeshletData::triangles
+		unsigned int numVertices = 0;
+		unsigned int numTriangles = 0;
+		//Model space bounding sphere
+		glm::vec3 center = glm::vec3(0.0f);
+		float radius = 0.0f;
+		//Normal cone. Every triangle faces away from a viewer at v when dot(normalize(coneApex - v), coneAxis) >= coneCutoff.
+		//coneCutoff is above 1 if the normals spread too far for the test to ever pass.
+		glm::vec3 coneApex = glm::vec3(0.0f);
+		glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+		float coneCutoff = 2.0f;
+	};
+
+	struct MeshletData {
+		std::vector<Meshlet> meshlets;
+		std::vector<unsigned int> vertices; //Mesh vertex indices, numVertices per meshlet
+		std::vector<unsigned char> triangles; //Indices into the meshlet's vertices, 3 per triangle
+		inline size_t getNumTriangles()const { return triangles.size() / 3; }
+	};
+
+	struct MeshletCullStats {
+		unsigned int numMeshlets = 0;
+		unsigned int numFrustumCulled = 0;
+		unsigned int numBackfaceCulled = 0;
+		unsigned int numTriangles = 0;
+		unsigned int numTrianglesDrawn = 0;
+		inline float rejectedFraction()const { return numTriangles > 0 ? 1.0f - (float)numTrianglesDrawn / numTriangles : 0.0f; }
+		inline void add(const MeshletCullStats& other) {
+			numMeshlets += other.numMeshlets;
+			numFrustumCulled += other.numFrustumCulled;
+			numBackfaceCulled += other.numBackfaceCulled;
+			numTriangles += other.numTriangles;
+			numTrianglesDrawn += other.numTrianglesDrawn;
+		}
+	};
+
+	/// <summary>
+	/// What survived a cull, as ranges of the index buffer from buildMeshletIndices.
+	/// Neighboring meshlets that both survive share a range, so a mostly visible mesh is a handful of draws.
+	/// </summary>
+	struct MeshletDrawRanges {
+		std::vector<int> counts; //Indices per range
+		std::vector<const void*> offsets; //Byte offset of each range, as the pointers glMultiDrawElements takes
+		inline size_t getNumRanges()const { return counts.size(); }
+		inline void clear() {
+			counts.clear();
+			offsets.clear();
+		}
+	};
+
+	/// <summary>
+	/// Splits a triangle mesh into meshlets of at most MAX_MESHLET_VERTICES vertices and MAX_MESHLET_TRIANGLES triangles.
+	/// Each meshlet grows from a seed triangle into neighbors that add the fewest new vertices, nearest its centroid first, so meshlets stay compact
+	/// and their bounds and normal cones tight. Vertices are not copied: meshlets index into the mesh's vertices.
+	/// Pure CPU work, so it can run at import or offline.
+	/// </summary>
+	MeshletData buildMeshlets(const MeshData& mesh);
+
+	//Mesh indices of every triangle in meshlet order, so meshlet m starts at index triangleOffset * 3.
+	//Uploaded once, after which culling only has to pick ranges of it.
+	std::vector<unsigned int> buildMeshletIndices(const MeshletData& meshletData);
+
+	/// <summary>
+	/// Culls meshlets outside the camera frustum or facing entirely away from it, and writes the surviving ones
+	/// as ranges of the buildMeshletIndices buffer, ready for one glMultiDrawElements.
+	/// Backface culling is skipped if modelMatrix scales non-uniformly, since that bends the normal cones.
+	/// </summary>
+	void cullMeshlets(const MeshletData& meshletData, const glm::mat4& modelMatrix, const Camera& camera,
+		MeshletDrawRanges* ranges, MeshletCullStats* stats = nullptr);
+}
@@ -0,0 +1,453 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include "metrics.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <intrin.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace ew {
+	//Index of the highest set bit. value must not be 0.
+	static inline int highestBit(uint64_t value) {
+#ifdef _WIN32
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return (int)index;
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+
+	int Histogram::getBucketIndex(uint64_t value)
+	{
+		if (value < (uint64_t)SUB_BUCKETS) {
+			return (int)value;
+		}
+		int bit = highestBit(value);
+		if (bit >= MAX_BITS) {
+			return NUM_BUCKETS - 1;
+		}
+		int shift = bit - SUB_BUCKET_BITS;
+		int subBucket = (int)(value >> shift) & (SUB_BUCKETS - 1);
+		return (shift + 1) * SUB_BUCKETS + subBucket;
+	}
+
+	uint64_t Histogram::getBucketUpperBound(int index)
+	{
+		if (index < SUB_BUCKETS) {
+			return (uint64_t)index;
+		}
+		if (index >= NUM_BUCKETS - 1) {
+			return UINT64_MAX;
+		}
+		int shift = index / SUB_BUCKETS - 1;
+		uint64_t lower = (uint64_t)(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+		return lower + ((uint64_t)1 << shift) - 1;
+	}
+
+	void Histogram::record(uint64_t value)
+	{
+		m_buckets[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+		m_sum.fetch_add(value, std::memory_order_relaxed);
+		uint64_t max = m_max.load(std::memory_order_relaxed);
+		while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+	}
+
+	HistogramSnapshot Histogram::snapshot() const
+	{
+		HistogramSnapshot snapshot;
+		snapshot.buckets.resize(NUM_BUCKETS);
+		for (int i = 0; i < NUM_BUCKETS; i++)
+		{
+			snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+			snapshot.count += snapshot.buckets[i];
+		}
+		snapshot.sum = m_sum.load(std::memory_order_relaxed);
+		snapshot.max = m_max.load(std::memory_order_relaxed);
+		return snapshot;
+	}
+
+	uint64_t HistogramSnapshot::percentile(double fraction) const
+	{
+		if (count == 0) {
+			return 0;
+		}
+		uint64_t rank = (uint64_t)std::max(1.0, fraction * count + 0.5);
+		uint64_t seen = 0;
+		for (size_t i = 0; i < buckets.size(); i++)
+		{
+			seen += buckets[i];
+			if (seen >= rank) {
+				return std::min(Histogram::getBucketUpperBound((int)i), max);
+			}
+		}
+		return max;
+	}
+
+	ScopedTimer::~ScopedTimer()
+	{
+		std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - m_start;
+		m_histogram->record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+	}
+
+	//Sets taken if name is registered at all, and returns the metric only if it is also the right type
+	void* MetricsRegistry::find(const std::string& name, MetricType type, bool* taken) const
+	{
+		*taken = false;
+		for (const Entry& entry : m_entries)
+		{
+			if (entry.name == name) {
+				*taken = true;
+				if (entry.type != type) {
+					printf("Metric %s is already registered as a different type\n", name.c_str());
+					return nullptr;
+				}
+				return entry.metric;
+			}
+		}
+		return nullptr;
+	}
+
+	//A name clash with another type still gets a working metric, it just isn't exported
+	Counter* MetricsRegistry::getCounter(const std::string& name, const std::string& help)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		bool taken;
+		if (void* metric = find(name, MetricType::COUNTER, &taken)) {
+			return (Counter*)metric;
+		}
+		m_counters.emplace_back();
+		if (!taken) {
+			m_entries.push_back({ name, help, MetricType::COUNTER, &m_counters.back() });
+		}
+		return &m_counters.back();
+	}
+
+	Gauge* MetricsRegistry::getGauge(const std::string& name, const std::string& help)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		bool taken;
+		if (void* metric = find(name, MetricType::GAUGE, &taken)) {
+			return (Gauge*)metric;
+		}
+		m_gauges.emplace_back();
+		if (!taken) {
+			m_entries.push_back({ name, help, MetricType::GAUGE, &m_gauges.back() });
+		}
+		return &m_gauges.back();
+	}
+
+	Histogram* MetricsRegistry::getHistogram(const std::string& name, const std::string& help)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		bool taken;
+		if (void* metric = find(name, MetricType::HISTOGRAM, &taken)) {
+			return (Histogram*)metric;
+		}
+		m_histograms.emplace_back();
+		if (!taken) {
+			m_entries.push_back({ name, help, MetricType::HISTOGRAM, &m_histograms.back() });
+		}
+		return &m_histograms.back();
+	}
+
+	static const double QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+	static const char* QUANTILE_NAMES[] = { "p50", "p90", "p99", "p999" };
+
+	static void appendf(std::string* out, const char* format, ...) {
+		char buffer[512];
+		va_list args;
+		va_start(args, format);
+		int length = vsnprintf(buffer, sizeof(buffer), format, args);
+		va_end(args);
+		if (length > 0) {
+			out->append(buffer, std::min((size_t)length, sizeof(buffer) - 1));
+		}
+	}
+
+	//Quoted, with quotes, backslashes and control characters escaped
+	static void appendJsonString(std::string* out, const std::string& str) {
+		out->push_back('"');
+		for (char c : str)
+		{
+			if (c == '"' || c == '\\') {
+				out->push_back('\\');
+				out->push_back(c);
+			}
+			else if ((unsigned char)c < 0x20) {
+				appendf(out, "\\u%04x", (unsigned int)c);
+			}
+			else {
+				out->push_back(c);
+			}
+		}
+		out->push_back('"');
+	}
+
+	//Prometheus names are [a-zA-Z_:][a-zA-Z0-9_:]*, anything else becomes an underscore
+	static void appendPrometheusName(std::string* out, const std::string& name) {
+		for (size_t i = 0; i < name.size(); i++)
+		{
+			char c = name[i];
+			bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':' || (i > 0 && c >= '0' && c <= '9');
+			out->push_back(valid ? c : '_');
+		}
+		if (name.empty()) {
+			out->push_back('_');
+		}
+	}
+
+	//Help text may not span lines, so backslashes and newlines are escaped
+	static void appendPrometheusHelp(std::string* out, const std::string& help) {
+		for (char c : help)
+		{
+			if (c == '\\') {
+				out->append("\\\\");
+			}
+			else if (c == '\n') {
+				out->append("\\n");
+			}
+			else {
+				out->push_back(c);
+			}
+		}
+	}
+
+	void MetricsRegistry::writeJson(std::string* out) const
+	{
+		long long timestamp = (long long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		appendf(out, "{\"timestamp\":%lld", timestamp);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (const Entry& entry : m_entries)
+		{
+			out->push_back(',');
+			appendJsonString(out, entry.name);
+			switch (entry.type) {
+			case MetricType::COUNTER:
+				appendf(out, ":%llu", (unsigned long long)((const Counter*)entry.metric)->get());
+				break;
+			case MetricType::GAUGE:
+				appendf(out, ":%lld", (long long)((const Gauge*)entry.metric)->get());
+				break;
+			case MetricType::HISTOGRAM: {
+				HistogramSnapshot snapshot = ((const Histogram*)entry.metric)->snapshot();
+				appendf(out, ":{\"count\":%llu,\"sum\":%llu,\"max\":%llu",
+					(unsigned long long)snapshot.count, (unsigned long long)snapshot.sum, (unsigned long long)snapshot.max);
+				for (int i = 0; i < 4; i++)
+				{
+					appendf(out, ",\"%s\":%llu", QUANTILE_NAMES[i], (unsigned long long)snapshot.percentile(QUANTILES[i]));
+				}
+				out->push_back('}');
+				break;
+			}
+			}
+		}
+		out->append("}\n");
+	}
+
+	void MetricsRegistry::writePrometheus(std::string* out) const
+	{
+		static const char* TYPE_NAMES[] = { "counter", "gauge", "summary" };
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::string name;
+		for (const Entry& entry : m_entries)
+		{
+			name.clear();
+			appendPrometheusName(&name, entry.name);
+			if (!entry.help.empty()) {
+				out->append("# HELP " + name + " ");
+				appendPrometheusHelp(out, entry.help);
+				out->push_back('\n');
+			}
+			out->append("# TYPE " + name + " " + TYPE_NAMES[(int)entry.type] + "\n");
+			switch (entry.type) {
+			case MetricType::COUNTER:
+				out->append(name);
+				appendf(out, " %llu\n", (unsigned long long)((const Counter*)entry.metric)->get());
+				break;
+			case MetricType::GAUGE:
+				out->append(name);
+				appendf(out, " %lld\n", (long long)((const Gauge*)entry.metric)->get());
+				break;
+			case MetricType::HISTOGRAM: {
+				HistogramSnapshot snapshot = ((const Histogram*)entry.metric)->snapshot();
+				for (int i = 0; i < 4; i++)
+				{
+					out->append(name);
+					appendf(out, "{quantile=\"%g\"} %llu\n", QUANTILES[i], (unsigned long long)snapshot.percentile(QUANTILES[i]));
+				}
+				out->append(name);
+				appendf(out, "_sum %llu\n", (unsigned long long)snapshot.sum);
+				out->append(name);
+				appendf(out, "_count %llu\n", (unsigned long long)snapshot.count);
+				break;
+			}
+			}
+		}
+	}
+
+	void recordBufferBytes(int64_t deltaBytes)
+	{
+		static Gauge* bufferBytes = getMetrics().getGauge("ew_buffer_bytes", "GPU memory used by buffers other than mesh vertices and indices: meshlet indices, skinning inputs, particles");
+		bufferBytes->add(deltaBytes);
+	}
+
+	MetricsRegistry& getMetrics()
+	{
+		static MetricsRegistry registry;
+		return registry;
+	}
+
+	MetricsExporter::MetricsExporter(const MetricsRegistry* registry, const std::string& destination, MetricsFormat format, float intervalSeconds)
+		: m_registry(registry), m_format(format),
+		m_interval(std::chrono::milliseconds((long long)(std::max(intervalSeconds, 0.01f) * 1000.0f)))
+	{
+		const std::string udpPrefix = "udp://";
+		if (destination.compare(0, udpPrefix.size(), udpPrefix) == 0) {
+			m_udp = true;
+			m_open = openSocket(destination.substr(udpPrefix.size()));
+		}
+		else {
+			m_path = destination;
+			m_open = true;
+		}
+		if (!m_open) {
+			printf("Failed to open metrics destination %s\n", destination.c_str());
+			return;
+		}
+		m_thread = std::thread(&MetricsExporter::threadLoop, this);
+	}
+
+	MetricsExporter::~MetricsExporter()
+	{
+		if (m_thread.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(m_sleepMutex);
+				m_quit = true;
+			}
+			m_wakeCondition.notify_one();
+			m_thread.join();
+			exportNow();
+		}
+		if (m_socket != -1) {
+#ifdef _WIN32
+			closesocket((SOCKET)m_socket);
+			WSACleanup();
+#else
+			close((int)m_socket);
+#endif
+		}
+	}
+
+	void MetricsExporter::threadLoop()
+	{
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		while (!m_quit)
+		{
+			if (m_wakeCondition.wait_for(lock, m_interval, [this]() { return m_quit; })) {
+				break;
+			}
+			lock.unlock();
+			exportNow();
+			lock.lock();
+		}
+	}
+
+	//host:port, IPv4 only
+	bool MetricsExporter::openSocket(const std::string& address)
+	{
+		size_t colon = address.rfind(':');
+		if (colon == std::string::npos) {
+			return false;
+		}
+		std::string host = address.substr(0, colon);
+		std::string port = address.substr(colon + 1);
+#ifdef _WIN32
+		WSADATA wsaData;
+		if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+			return false;
+		}
+#endif
+		addrinfo hints = {};
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_DGRAM;
+		addrinfo* result = nullptr;
+		if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0 || result == nullptr) {
+#ifdef _WIN32
+			WSACleanup();
+#endif
+			return false;
+		}
+		static_assert(sizeof(sockaddr_in) <= sizeof(m_address), "m_address too small");
+		memcpy(m_address, result->ai_addr, sizeof(sockaddr_in));
+		m_socket = (intptr_t)socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+		freeaddrinfo(result);
+#ifdef _WIN32
+		if ((SOCKET)m_socket == INVALID_SOCKET) {
+			m_socket = -1;
+			WSACleanup();
+		}
+#endif
+		return m_socket != -1;
+	}
+
+	bool MetricsExporter::exportNow()
+	{
+		if (!m_open) {
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(m_exportMutex);
+		m_buffer.clear();
+		if (m_format == MetricsFormat::PROMETHEUS) {
+			m_registry->writePrometheus(&m_buffer);
+		}
+		else {
+			m_registry->writeJson(&m_buffer);
+		}
+
+		if (m_udp) {
+#ifdef _WIN32
+			int sent = sendto((SOCKET)m_socket, m_buffer.data(), (int)m_buffer.size(), 0, (const sockaddr*)m_address, sizeof(sockaddr_in));
+#else
+			ssize_t sent = sendto((int)m_socket, m_buffer.data(), m_buffer.size(), 0, (const sockaddr*)m_address, sizeof(sockaddr_in));
+#endif
+			return sent == (long long)m_buffer.size();
+		}
+		if (m_format == MetricsFormat::JSON_LINES) {
+			FILE* file = fopen(m_path.c_str(), "ab");
+			if (file == NULL) {
+				return false;
+			}
+			bool written = fwrite(m_buffer.data(), 1, m_buffer.size(), file) == m_buffer.size();
+			fclose(file);
+			return written;
+		}
+		//Readers must never see a half written file, so write next to it and swap it in
+		std::string tempPath = m_path + ".tmp";
+		FILE* file = fopen(tempPath.c_str(), "wb");
+		if (file == NULL) {
+			return false;
+		}
+		bool written = fwrite(m_buffer.data(), 1, m_buffer.size(), file) == m_buffer.size();
+		written &= fclose(file) == 0;
+		std::error_code error;
+		std::filesystem::rename(tempPath, m_path, error);
+		return written && !error;
+	}
+}
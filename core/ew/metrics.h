@@ -0,0 +1,161 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+namespace ew {
+	//Only ever goes up
+	class Counter {
+	public:
+		inline void add(uint64_t amount = 1) { m_value.fetch_add(amount, std::memory_order_relaxed); }
+		inline uint64_t get()const { return m_value.load(std::memory_order_relaxed); }
+	private:
+		std::atomic<uint64_t> m_value{ 0 };
+	};
+
+	//Current level of something, e.g. bytes allocated
+	class Gauge {
+	public:
+		inline void set(int64_t value) { m_value.store(value, std::memory_order_relaxed); }
+		inline void add(int64_t delta) { m_value.fetch_add(delta, std::memory_order_relaxed); }
+		inline int64_t get()const { return m_value.load(std::memory_order_relaxed); }
+	private:
+		std::atomic<int64_t> m_value{ 0 };
+	};
+
+	struct HistogramSnapshot {
+		uint64_t count = 0;
+		uint64_t sum = 0;
+		uint64_t max = 0;
+		std::vector<uint64_t> buckets;
+		//Highest value in the bucket holding the given fraction (0-1) of samples, capped at max
+		uint64_t percentile(double fraction)const;
+		inline double mean()const { return count > 0 ? (double)sum / count : 0.0; }
+	};
+
+	/// <summary>
+	/// HDR style histogram of non-negative integers. Values below 16 are exact, then every power of two is split
+	/// into 16 linear buckets, so a value is never more than 1/16 off from its bucket's bounds.
+	/// Recording is a few relaxed atomic adds, safe from any thread.
+	/// </summary>
+	class Histogram {
+	public:
+		static const int SUB_BUCKET_BITS = 4;
+		static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+		static const int MAX_BITS = 40; //Values from 2^40 up share the last bucket
+		static const int NUM_BUCKETS = SUB_BUCKETS * (MAX_BITS - SUB_BUCKET_BITS + 1) + 1;
+
+		void record(uint64_t value);
+		//Counts are read one at a time while others may record, so totals can be off by in-flight samples
+		HistogramSnapshot snapshot()const;
+		static int getBucketIndex(uint64_t value);
+		//Highest value that lands in the bucket. The last bucket is unbounded.
+		static uint64_t getBucketUpperBound(int index);
+	private:
+		std::atomic<uint64_t> m_buckets[NUM_BUCKETS] = {};
+		std::atomic<uint64_t> m_sum{ 0 };
+		std::atomic<uint64_t> m_max{ 0 };
+	};
+
+	//Records the time from construction to destruction into a histogram, in microseconds
+	class ScopedTimer {
+	public:
+		ScopedTimer(Histogram* histogram) : m_histogram(histogram), m_start(std::chrono::steady_clock::now()) {};
+		~ScopedTimer();
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer& operator=(const ScopedTimer&) = delete;
+	private:
+		Histogram* m_histogram;
+		std::chrono::steady_clock::time_point m_start;
+	};
+
+	/// <summary>
+	/// Named counters, gauges and histograms. Registering takes a lock, so look metrics up once and keep the pointer;
+	/// updating them is lock-free. Metrics live as long as the registry.
+	/// </summary>
+	class MetricsRegistry {
+	public:
+		//Returns the metric already registered under name, if any
+		Counter* getCounter(const std::string& name, const std::string& help = "");
+		Gauge* getGauge(const std::string& name, const std::string& help = "");
+		Histogram* getHistogram(const std::string& name, const std::string& help = "");
+		//One JSON object on a single line, with a millisecond Unix timestamp. Names are escaped as JSON strings.
+		void writeJson(std::string* out)const;
+		//Prometheus text exposition format. Histograms are written as summaries with quantiles.
+		//Characters Prometheus doesn't allow in names become underscores.
+		void writePrometheus(std::string* out)const;
+	private:
+		enum class MetricType {
+			COUNTER = 0,
+			GAUGE = 1,
+			HISTOGRAM = 2
+		};
+		struct Entry {
+			std::string name;
+			std::string help;
+			MetricType type;
+			void* metric;
+		};
+		void* find(const std::string& name, MetricType type, bool* taken)const;
+		mutable std::mutex m_mutex;
+		std::vector<Entry> m_entries;
+		//Deques never move their elements, so pointers handed out stay valid
+		std::deque<Counter> m_counters;
+		std::deque<Gauge> m_gauges;
+		std::deque<Histogram> m_histograms;
+	};
+
+	//Process wide registry the engine's own instrumentation reports to
+	MetricsRegistry& getMetrics();
+
+	//Adds to the ew_buffer_bytes gauge, for GPU buffers allocated outside of Mesh. Negative when they are deleted.
+	void recordBufferBytes(int64_t deltaBytes);
+
+	enum class MetricsFormat {
+		JSON_LINES = 0,
+		PROMETHEUS = 1
+	};
+
+	/// <summary>
+	/// Writes a registry out on a background thread every interval, and once more when destroyed.
+	/// destination is a file path, or udp://host:port to send each export as a datagram to a local collector.
+	/// JSON lines are appended to the file. Prometheus text replaces it atomically, as a textfile collector expects.
+	/// </summary>
+	class MetricsExporter {
+	public:
+		MetricsExporter(const MetricsRegistry* registry, const std::string& destination, MetricsFormat format, float intervalSeconds = 10.0f);
+		~MetricsExporter();
+		MetricsExporter(const MetricsExporter&) = delete;
+		MetricsExporter& operator=(const MetricsExporter&) = delete;
+		//Exports right away on the calling thread. Returns false if the write failed.
+		bool exportNow();
+		inline bool isOpen()const { return m_open; }
+	private:
+		void threadLoop();
+		bool openSocket(const std::string& address);
+		const MetricsRegistry* m_registry;
+		std::string m_path;
+		MetricsFormat m_format;
+		std::chrono::milliseconds m_interval;
+		bool m_open = false;
+		bool m_udp = false;
+		intptr_t m_socket = -1;
+		unsigned char m_address[16] = {}; //sockaddr_in, kept opaque so socket headers stay out of this header
+		std::mutex m_exportMutex; //exportNow can race the thread
+		std::mutex m_sleepMutex;
+		std::condition_variable m_wakeCondition;
+		bool m_quit = false;
+		std::thread m_thread;
+		std::string m_buffer;
+	};
+}
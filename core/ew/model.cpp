@@ -3,24 +3,160 @@
 */
 
 #include "model.h"
+#include "jobSystem.h"
+#include "meshProcessing.h"
+#include "metrics.h"
+#include "occlusion.h"
+#include "external/glad.h"
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 
 #include <assimp/scene.h>
 #include <glm/glm.hpp>
+#include <unordered_map>
 
 namespace ew {
-	ew::Mesh processAiMesh(aiMesh* aiMesh);
+	typedef std::unordered_map<std::string, int> JointMap;
+	ew::MeshData processAiMesh(aiMesh* aiMesh);
+	static void importSkeleton(const aiScene* aiScene, Skeleton* skeleton, JointMap* jointMap);
+	static SkinWeights processAiSkin(const aiMesh* aiMesh, const JointMap& jointMap);
+	static AnimationClip processAiAnimation(const aiAnimation* aiAnimation, const JointMap& jointMap, size_t numJoints);
 
-	Model::Model(const std::string& filePath)
+	Model::Model(const std::string& filePath, JobSystem* jobSystem)
 	{
+		static Histogram* loadTime = getMetrics().getHistogram("ew_model_load_microseconds", "Model import time, from file to GPU buffers");
+		ScopedTimer timer(loadTime);
 		Assimp::Importer importer;
 		const aiScene* aiScene = importer.ReadFile(filePath, aiProcess_Triangulate);
-		for (size_t i = 0; i < aiScene->mNumMeshes; i++)
+		bool hasBones = false;
+		for (unsigned int i = 0; i < aiScene->mNumMeshes; i++)
 		{
-			aiMesh* aiMesh = aiScene->mMeshes[i];
-			m_meshes.push_back(processAiMesh(aiMesh));
+			hasBones |= aiScene->mMeshes[i]->HasBones();
 		}
+		//Conversion only touches CPU memory, so it runs as a graph of jobs. GL uploads stay on this thread.
+		//Meshes don't depend on anything, while skins and clips need the joint map from the skeleton.
+		//Skins also wait for their mesh, since tangent generation can append vertices they need weights for.
+		JointMap jointMap;
+		std::vector<ew::MeshData> meshData(aiScene->mNumMeshes);
+		std::vector<SkinWeights> skinWeights(aiScene->mNumMeshes);
+		//Vertices tangent generation split along mirror seams, which skins have to copy weights for
+		std::vector<std::vector<unsigned int>> splitSources(aiScene->mNumMeshes);
+		std::vector<JobGraph::Node> meshNodes(aiScene->mNumMeshes);
+		m_clusters.resize(aiScene->mNumMeshes);
+		JobGraph graph;
+		for (unsigned int i = 0; i < aiScene->mNumMeshes; i++)
+		{
+			meshNodes[i] = graph.add([&, i]() {
+				meshData[i] = processAiMesh(aiScene->mMeshes[i]);
+				//Generated here rather than by Assimp so large meshes spread over the job system
+				if (!aiScene->mMeshes[i]->HasNormals()) {
+					generateNormals(&meshData[i], jobSystem);
+				}
+				generateTangents(&meshData[i], jobSystem, &splitSources[i]);
+				if (!aiScene->mMeshes[i]->HasBones()) {
+					m_clusters[i].meshlets = buildMeshlets(meshData[i]);
+				}
+			});
+		}
+		if (hasBones) {
+			m_clips.resize(aiScene->mNumAnimations);
+			JobGraph::Node skeleton = graph.add([&]() { importSkeleton(aiScene, &m_skeleton, &jointMap); });
+			for (unsigned int i = 0; i < aiScene->mNumMeshes; i++)
+			{
+				if (aiScene->mMeshes[i]->HasBones()) {
+					JobGraph::Node skin = graph.add([&, i]() {
+						skinWeights[i] = processAiSkin(aiScene->mMeshes[i], jointMap);
+						for (unsigned int source : splitSources[i])
+						{
+							skinWeights[i].joints.push_back(skinWeights[i].joints[source]);
+							skinWeights[i].weights.push_back(skinWeights[i].weights[source]);
+						}
+					});
+					graph.addDependency(skeleton, skin);
+					graph.addDependency(meshNodes[i], skin);
+				}
+			}
+			for (unsigned int i = 0; i < aiScene->mNumAnimations; i++)
+			{
+				JobGraph::Node clip = graph.add([&, i]() { m_clips[i] = processAiAnimation(aiScene->mAnimations[i], jointMap, m_skeleton.getNumJoints()); });
+				graph.addDependency(skeleton, clip);
+			}
+		}
+		graph.execute(jobSystem);
+		//Mesh reports its own buffers, everything else created here is added up for ew_buffer_bytes
+		size_t bufferBytes = 0;
+		for (size_t i = 0; i < meshData.size(); i++)
+		{
+			m_meshes.push_back(ew::Mesh(meshData[i]));
+			m_bounds.expand(m_meshes.back().getBounds());
+			ClusteredMesh& clusters = m_clusters[i];
+			if (!clusters.meshlets.meshlets.empty()) {
+				std::vector<unsigned int> meshletIndices = buildMeshletIndices(clusters.meshlets);
+				glCreateBuffers(1, &clusters.indexBuffer);
+				glNamedBufferStorage(clusters.indexBuffer, sizeof(unsigned int) * meshletIndices.size(), meshletIndices.data(), 0);
+				bufferBytes += sizeof(unsigned int) * meshletIndices.size();
+				//Starts out as one range holding every triangle, so drawCulled works before the first cull
+				clusters.ranges.counts.push_back((int)meshletIndices.size());
+				clusters.ranges.offsets.push_back(nullptr);
+			}
+			if (skinWeights[i].joints.empty()) {
+				m_occluders.push_back(std::move(meshData[i]));
+				continue;
+			}
+			//Skinning reads the bind pose from its own buffer and overwrites the mesh's vertex buffer
+			SkinnedMesh skinnedMesh;
+			skinnedMesh.mesh = i;
+			skinnedMesh.weights = std::move(skinWeights[i]);
+			size_t numVertices = meshData[i].vertices.size();
+			glCreateBuffers(1, &skinnedMesh.bindVertexBuffer);
+			glNamedBufferStorage(skinnedMesh.bindVertexBuffer, sizeof(Vertex) * numVertices, meshData[i].vertices.data(), 0);
+			glCreateBuffers(1, &skinnedMesh.jointBuffer);
+			glNamedBufferStorage(skinnedMesh.jointBuffer, sizeof(glm::uvec4) * numVertices, skinnedMesh.weights.joints.data(), 0);
+			glCreateBuffers(1, &skinnedMesh.weightBuffer);
+			glNamedBufferStorage(skinnedMesh.weightBuffer, sizeof(glm::vec4) * numVertices, skinnedMesh.weights.weights.data(), 0);
+			bufferBytes += (sizeof(Vertex) + sizeof(glm::uvec4) + sizeof(glm::vec4)) * numVertices;
+			m_skins.push_back(std::move(skinnedMesh));
+		}
+		if (!m_skins.empty()) {
+			glCreateBuffers(1, &m_skinningMatrixBuffer);
+			glNamedBufferStorage(m_skinningMatrixBuffer, sizeof(glm::mat4) * m_skeleton.getNumJoints(), nullptr, GL_DYNAMIC_STORAGE_BIT);
+			bufferBytes += sizeof(glm::mat4) * m_skeleton.getNumJoints();
+			//Joints that move at least one vertex. The rest don't affect the skinned bounds.
+			std::vector<bool> weighted(m_skeleton.getNumJoints(), false);
+			for (const SkinnedMesh& skinnedMesh : m_skins)
+			{
+				for (size_t v = 0; v < skinnedMesh.weights.joints.size(); v++)
+				{
+					for (int k = 0; k < MAX_BONE_INFLUENCES; k++)
+					{
+						if (skinnedMesh.weights.weights[v][k] > 0.0f) {
+							weighted[skinnedMesh.weights.joints[v][k]] = true;
+						}
+					}
+				}
+			}
+			for (size_t i = 0; i < weighted.size(); i++)
+			{
+				if (weighted[i]) {
+					m_weightedJoints.push_back((unsigned int)i);
+				}
+			}
+		}
+		recordBufferBytes((int64_t)bufferBytes);
+	}
+
+	/// <summary>
+	/// Every skinned vertex is a weighted average of its bind position moved by a few joints,
+	/// so it stays inside the union of the bind bounds moved by each weighted joint.
+	/// </summary>
+	AABB Model::getSkinnedBounds(const glm::mat4* skinningMatrices) const
+	{
+		AABB bounds = m_bounds;
+		for (unsigned int joint : m_weightedJoints)
+		{
+			bounds.expand(m_bounds.transformed(skinningMatrices[joint]));
+		}
+		return bounds;
 	}
 
 	void Model::draw()
@@ -31,23 +167,102 @@ namespace ew {
 		}
 	}
 
+	/// <summary>
+	/// Runs the skinning compute shader over every skinned mesh, writing straight into the vertex buffers draw() uses.
+	/// </summary>
+	/// <param name="skinningShader">Compute shader built from skinning.comp</param>
+	/// <param name="skinningMatrices">One matrix per skeleton joint</param>
+	void Model::skin(const Shader& skinningShader, const glm::mat4* skinningMatrices)
+	{
+		if (m_skins.empty()) {
+			return;
+		}
+		glNamedBufferSubData(m_skinningMatrixBuffer, 0, sizeof(glm::mat4) * m_skeleton.getNumJoints(), skinningMatrices);
+		skinningShader.use();
+		skinningShader.setInt("_VertexStride", sizeof(Vertex) / sizeof(float));
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_skinningMatrixBuffer);
+		for (const SkinnedMesh& skinnedMesh : m_skins)
+		{
+			const Mesh& mesh = m_meshes[skinnedMesh.mesh];
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, skinnedMesh.bindVertexBuffer);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mesh.getVertexBuffer());
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, skinnedMesh.jointBuffer);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, skinnedMesh.weightBuffer);
+			skinningShader.setInt("_NumVertices", mesh.getNumVertices());
+			skinningShader.dispatch((mesh.getNumVertices() + 63) / 64);
+		}
+		//Vertices are read as attributes by the next draw
+		glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+	}
+
+	/// <summary>
+	/// CPU meshlet culling. Only picks ranges of the static index buffers, so nothing goes to the GPU until the draw.
+	/// </summary>
+	void Model::cullMeshlets(const glm::mat4& modelMatrix, const Camera& camera, MeshletCullStats* stats)
+	{
+		MeshletCullStats totals;
+		for (ClusteredMesh& clusters : m_clusters)
+		{
+			if (clusters.meshlets.meshlets.empty()) {
+				continue;
+			}
+			MeshletCullStats meshStats;
+			ew::cullMeshlets(clusters.meshlets, modelMatrix, camera, &clusters.ranges, &meshStats);
+			totals.add(meshStats);
+		}
+		if (stats != nullptr) {
+			*stats = totals;
+		}
+	}
+
+	void Model::drawCulled()
+	{
+		for (size_t i = 0; i < m_meshes.size(); i++)
+		{
+			const ClusteredMesh& clusters = m_clusters[i];
+			if (clusters.meshlets.meshlets.empty()) {
+				m_meshes[i].draw();
+			}
+			else {
+				m_meshes[i].drawIndexRanges(clusters.indexBuffer, clusters.ranges.counts.data(), clusters.ranges.offsets.data(), (int)clusters.ranges.getNumRanges());
+			}
+		}
+	}
+
+	void Model::rasterizeOccluders(DepthRasterizer* rasterizer, const glm::mat4& modelViewProjection) const
+	{
+		for (const MeshData& occluder : m_occluders)
+		{
+			rasterizer->drawMesh(occluder, modelViewProjection);
+		}
+	}
+
 	glm::vec3 convertAIVec3(const aiVector3D& v) {
 		return glm::vec3(v.x, v.y, v.z);
 	}
 
+	//Assimp matrices are row major
+	static glm::mat4 convertAIMat4(const aiMatrix4x4& m) {
+		return glm::mat4(
+			m.a1, m.b1, m.c1, m.d1,
+			m.a2, m.b2, m.c2, m.d2,
+			m.a3, m.b3, m.c3, m.d3,
+			m.a4, m.b4, m.c4, m.d4);
+	}
+
 	//Utility functions local to this file
-	ew::Mesh processAiMesh(aiMesh* aiMesh) {
+	ew::MeshData processAiMesh(aiMesh* aiMesh) {
 		ew::MeshData meshData;
+		meshData.vertices.reserve(aiMesh->mNumVertices);
+		meshData.indices.reserve(aiMesh->mNumFaces * 3); //Triangulated
 		for (size_t i = 0; i < aiMesh->mNumVertices; i++)
 		{
 			ew::Vertex vertex;
 			vertex.pos = convertAIVec3(aiMesh->mVertices[i]);
-			if (aiMesh->HasNormals()) {
-				vertex.normal = convertAIVec3(aiMesh->mNormals[i]);
-			}
-			if (aiMesh->HasTextureCoords(0)) {
-				vertex.uv = glm::vec2(convertAIVec3(aiMesh->mTextureCoords[0][i]));
-			}
+			//Missing attributes are zeroed, then generated by the caller
+			vertex.normal = aiMesh->HasNormals() ? convertAIVec3(aiMesh->mNormals[i]) : glm::vec3(0.0f);
+			vertex.uv = aiMesh->HasTextureCoords(0) ? glm::vec2(convertAIVec3(aiMesh->mTextureCoords[0][i])) : glm::vec2(0.0f);
+			vertex.tangent = glm::vec4(0.0f);
 			meshData.vertices.push_back(vertex);
 		}
 		//Convert faces to indices
@@ -58,7 +273,140 @@ namespace ew {
 				meshData.indices.push_back(aiMesh->mFaces[i].mIndices[j]);
 			}
 		}
-		return ew::Mesh(meshData);
+		return meshData;
+	}
+
+	/// <summary>
+	/// Flattens the node tree into joints, parents before children. Every node becomes a joint,
+	/// since animation channels and bone parents can both refer to nodes that aren't bones.
+	/// </summary>
+	static void importSkeleton(const aiScene* aiScene, Skeleton* skeleton, JointMap* jointMap) {
+		std::vector<std::pair<const aiNode*, int>> stack;
+		stack.push_back({ aiScene->mRootNode, -1 });
+		while (!stack.empty())
+		{
+			const aiNode* node = stack.back().first;
+			int parent = stack.back().second;
+			stack.pop_back();
+			int joint = (int)skeleton->parents.size();
+			skeleton->names.push_back(node->mName.C_Str());
+			skeleton->parents.push_back(parent);
+			skeleton->inverseBindMatrices.push_back(glm::mat4(1.0f));
+			aiVector3D scale, position;
+			aiQuaternion rotation;
+			node->mTransformation.Decompose(scale, rotation, position);
+			skeleton->restPose.translations.push_back(convertAIVec3(position));
+			skeleton->restPose.rotations.push_back(glm::quat(rotation.w, rotation.x, rotation.y, rotation.z));
+			skeleton->restPose.scales.push_back(convertAIVec3(scale));
+			(*jointMap)[skeleton->names.back()] = joint;
+			for (unsigned int i = 0; i < node->mNumChildren; i++)
+			{
+				stack.push_back({ node->mChildren[i], joint });
+			}
+		}
+		skeleton->globalInverse = glm::inverse(convertAIMat4(aiScene->mRootNode->mTransformation));
+		for (unsigned int i = 0; i < aiScene->mNumMeshes; i++)
+		{
+			const aiMesh* aiMesh = aiScene->mMeshes[i];
+			for (unsigned int j = 0; j < aiMesh->mNumBones; j++)
+			{
+				auto it = jointMap->find(aiMesh->mBones[j]->mName.C_Str());
+				if (it != jointMap->end()) {
+					skeleton->inverseBindMatrices[it->second] = convertAIMat4(aiMesh->mBones[j]->mOffsetMatrix);
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Keeps the four strongest influences on each vertex and renormalizes them
+	/// </summary>
+	static SkinWeights processAiSkin(const aiMesh* aiMesh, const JointMap& jointMap) {
+		SkinWeights skin;
+		skin.joints.assign(aiMesh->mNumVertices, glm::uvec4(0u));
+		skin.weights.assign(aiMesh->mNumVertices, glm::vec4(0.0f));
+		for (unsigned int i = 0; i < aiMesh->mNumBones; i++)
+		{
+			const aiBone* bone = aiMesh->mBones[i];
+			auto it = jointMap.find(bone->mName.C_Str());
+			if (it == jointMap.end()) {
+				continue;
+			}
+			for (unsigned int j = 0; j < bone->mNumWeights; j++)
+			{
+				unsigned int v = bone->mWeights[j].mVertexId;
+				float weight = bone->mWeights[j].mWeight;
+				glm::vec4& weights = skin.weights[v];
+				int smallest = 0;
+				for (int k = 1; k < MAX_BONE_INFLUENCES; k++)
+				{
+					if (weights[k] < weights[smallest]) {
+						smallest = k;
+					}
+				}
+				if (weight > weights[smallest]) {
+					weights[smallest] = weight;
+					skin.joints[v][smallest] = (unsigned int)it->second;
+				}
+			}
+		}
+		for (size_t i = 0; i < skin.weights.size(); i++)
+		{
+			glm::vec4& weights = skin.weights[i];
+			float sum = weights.x + weights.y + weights.z + weights.w;
+			if (sum > 0.0f) {
+				weights /= sum;
+			}
+			else {
+				//Unweighted vertices follow the root
+				weights = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+				skin.joints[i] = glm::uvec4(0u);
+			}
+		}
+		return skin;
+	}
+
+	/// <summary>
+	/// Copies a clip's channels into flat key arrays, converting ticks to seconds
+	/// </summary>
+	static AnimationClip processAiAnimation(const aiAnimation* aiAnimation, const JointMap& jointMap, size_t numJoints) {
+		AnimationClip clip;
+		clip.name = aiAnimation->mName.C_Str();
+		double ticksPerSecond = aiAnimation->mTicksPerSecond > 0.0 ? aiAnimation->mTicksPerSecond : 25.0;
+		clip.duration = (float)(aiAnimation->mDuration / ticksPerSecond);
+		clip.tracks.resize(numJoints);
+		for (unsigned int i = 0; i < aiAnimation->mNumChannels; i++)
+		{
+			const aiNodeAnim* channel = aiAnimation->mChannels[i];
+			auto it = jointMap.find(channel->mNodeName.C_Str());
+			if (it == jointMap.end()) {
+				continue;
+			}
+			AnimationClip::Track& track = clip.tracks[it->second];
+			track.translationBegin = (unsigned int)clip.translationKeys.size();
+			track.translationCount = channel->mNumPositionKeys;
+			for (unsigned int k = 0; k < channel->mNumPositionKeys; k++)
+			{
+				clip.translationTimes.push_back((float)(channel->mPositionKeys[k].mTime / ticksPerSecond));
+				clip.translationKeys.push_back(convertAIVec3(channel->mPositionKeys[k].mValue));
+			}
+			track.rotationBegin = (unsigned int)clip.rotationKeys.size();
+			track.rotationCount = channel->mNumRotationKeys;
+			for (unsigned int k = 0; k < channel->mNumRotationKeys; k++)
+			{
+				const aiQuaternion& q = channel->mRotationKeys[k].mValue;
+				clip.rotationTimes.push_back((float)(channel->mRotationKeys[k].mTime / ticksPerSecond));
+				clip.rotationKeys.push_back(glm::quat(q.w, q.x, q.y, q.z));
+			}
+			track.scaleBegin = (unsigned int)clip.scaleKeys.size();
+			track.scaleCount = channel->mNumScalingKeys;
+			for (unsigned int k = 0; k < channel->mNumScalingKeys; k++)
+			{
+				clip.scaleTimes.push_back((float)(channel->mScalingKeys[k].mTime / ticksPerSecond));
+				clip.scaleKeys.push_back(convertAIVec3(channel->mScalingKeys[k].mValue));
+			}
+		}
+		return clip;
 	}
 
 }
@@ -5,14 +5,60 @@
 #pragma once
 #include "mesh.h"
 #include "shader.h"
+#include "animation.h"
+#include "meshlet.h"
 #include <vector>
 
 namespace ew {
+	class JobSystem;
+	class DepthRasterizer;
 	class Model {
 	public:
-		Model(const std::string& filePath);
+		//If a job system is given, meshes are converted on worker threads
+		Model(const std::string& filePath, JobSystem* jobSystem = nullptr);
 		void draw();
+		//Model space bounds of all meshes
+		inline const AABB& getBounds()const { return m_bounds; }
+		//Model space bounds that hold every vertex once skinned with these matrices. Loose, but never too small.
+		AABB getSkinnedBounds(const glm::mat4* skinningMatrices)const;
+
+		//True if any mesh has bones. Skeleton and clips are empty otherwise.
+		inline bool isSkinned()const { return !m_skins.empty(); }
+		inline const Skeleton& getSkeleton()const { return m_skeleton; }
+		inline const std::vector<AnimationClip>& getClips()const { return m_clips; }
+		//Skins every skinned mesh into its own vertex buffer with a compute shader.
+		//skinningMatrices holds one matrix per skeleton joint, e.g. from evaluateAnimations.
+		void skin(const Shader& skinningShader, const glm::mat4* skinningMatrices);
+
+		//Culls the meshlets of every unskinned mesh against the camera and keeps the surviving index ranges for drawCulled.
+		//Nothing is uploaded: each mesh's meshlet ordered index buffer is static.
+		//Results are per model, so instances sharing a model need to cull again before each draw.
+		void cullMeshlets(const glm::mat4& modelMatrix, const Camera& camera, MeshletCullStats* stats = nullptr);
+		//Draws what survived the last cullMeshlets. Skinned meshes move out of their meshlet bounds, so they draw whole.
+		void drawCulled();
+		//Draws every unskinned mesh into a software depth buffer, for occlusion culling without GPU depth
+		void rasterizeOccluders(DepthRasterizer* rasterizer, const glm::mat4& modelViewProjection)const;
 	private:
+		struct SkinnedMesh {
+			size_t mesh; //Index into m_meshes
+			SkinWeights weights;
+			unsigned int bindVertexBuffer; //Unskinned vertices the shader reads from
+			unsigned int jointBuffer;
+			unsigned int weightBuffer;
+		};
 		std::vector<ew::Mesh> m_meshes;
+		std::vector<ew::MeshData> m_occluders; //CPU copies of unskinned meshes, skinned ones don't stay put
+		AABB m_bounds;
+		Skeleton m_skeleton;
+		std::vector<AnimationClip> m_clips;
+		std::vector<SkinnedMesh> m_skins;
+		std::vector<unsigned int> m_weightedJoints; //Joints at least one skinned vertex follows
+		struct ClusteredMesh {
+			MeshletData meshlets; //Empty for skinned meshes
+			unsigned int indexBuffer = 0; //Every triangle in meshlet order, from buildMeshletIndices
+			MeshletDrawRanges ranges; //Survivors of the last cull
+		};
+		std::vector<ClusteredMesh> m_clusters; //One per mesh
+		unsigned int m_skinningMatrixBuffer = 0;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,209 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include "occlusion.h"
+#include "external/glad.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+namespace ew {
+	DepthRasterizer::DepthRasterizer(int width, int height)
+	{
+		resize(width, height);
+	}
+
+	void DepthRasterizer::resize(int width, int height)
+	{
+		m_width = width;
+		m_height = height;
+		m_depth.assign((size_t)width * height, 1.0f);
+	}
+
+	void DepthRasterizer::clear()
+	{
+		std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+	}
+
+	void DepthRasterizer::drawMesh(const MeshData& mesh, const glm::mat4& modelViewProjection)
+	{
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			glm::vec4 a = modelViewProjection * glm::vec4(mesh.vertices[mesh.indices[i]].pos, 1.0f);
+			glm::vec4 b = modelViewProjection * glm::vec4(mesh.vertices[mesh.indices[i + 1]].pos, 1.0f);
+			glm::vec4 c = modelViewProjection * glm::vec4(mesh.vertices[mesh.indices[i + 2]].pos, 1.0f);
+			drawTriangle(a, b, c);
+		}
+	}
+
+	/// <summary>
+	/// Rasterizes one clip space triangle, keeping the nearest depth. Both windings are drawn.
+	/// </summary>
+	void DepthRasterizer::drawTriangle(const glm::vec4& clipA, const glm::vec4& clipB, const glm::vec4& clipC)
+	{
+		//Anything touching the near plane would need clipping. Dropping it just means fewer occluders.
+		const float minW = 1e-5f;
+		if (clipA.w < minW || clipB.w < minW || clipC.w < minW) {
+			return;
+		}
+		//To window space: pixels for xy, [0,1] for depth
+		glm::vec3 p[3];
+		const glm::vec4* clip[3] = { &clipA, &clipB, &clipC };
+		for (int i = 0; i < 3; i++)
+		{
+			glm::vec3 ndc = glm::vec3(*clip[i]) / clip[i]->w;
+			p[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * m_width, (ndc.y * 0.5f + 0.5f) * m_height, ndc.z * 0.5f + 0.5f);
+		}
+		float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+		if (fabsf(area) < 1e-8f) {
+			return;
+		}
+		int minX = std::max(0, (int)floorf(std::min({ p[0].x, p[1].x, p[2].x })));
+		int maxX = std::min(m_width - 1, (int)ceilf(std::max({ p[0].x, p[1].x, p[2].x })));
+		int minY = std::max(0, (int)floorf(std::min({ p[0].y, p[1].y, p[2].y })));
+		int maxY = std::min(m_height - 1, (int)ceilf(std::max({ p[0].y, p[1].y, p[2].y })));
+		float invArea = 1.0f / area;
+		for (int y = minY; y <= maxY; y++)
+		{
+			float py = y + 0.5f;
+			for (int x = minX; x <= maxX; x++)
+			{
+				float px = x + 0.5f;
+				//Barycentric weights from edge functions, signed by winding
+				float w0 = ((p[2].x - p[1].x) * (py - p[1].y) - (p[2].y - p[1].y) * (px - p[1].x)) * invArea;
+				float w1 = ((p[0].x - p[2].x) * (py - p[2].y) - (p[0].y - p[2].y) * (px - p[2].x)) * invArea;
+				float w2 = 1.0f - w0 - w1;
+				if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+					continue;
+				}
+				//Window space depth is linear in screen space, no perspective correction needed
+				float z = w0 * p[0].z + w1 * p[1].z + w2 * p[2].z;
+				if (z < 0.0f) {
+					continue;
+				}
+				float& depth = m_depth[(size_t)y * m_width + x];
+				depth = std::min(depth, z);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Builds all mip levels from a full resolution depth buffer
+	/// </summary>
+	/// <param name="depth">Window space depth [0,1], width * height floats</param>
+	/// <param name="viewProjection">Matrix the depth was rendered with. Used to project bounds when testing.</param>
+	void HiZPyramid::build(const float* depth, int width, int height, const glm::mat4& viewProjection)
+	{
+		m_viewProjection = viewProjection;
+		if (m_levels.empty() || m_levels[0].width != width || m_levels[0].height != height) {
+			m_levels.clear();
+			int w = width, h = height;
+			while (true) {
+				m_levels.push_back({ w, h, std::vector<float>((size_t)w * h) });
+				if (w == 1 && h == 1) {
+					break;
+				}
+				w = std::max(1, (w + 1) / 2);
+				h = std::max(1, (h + 1) / 2);
+			}
+		}
+		memcpy(m_levels[0].depth.data(), depth, sizeof(float) * width * height);
+		for (size_t i = 1; i < m_levels.size(); i++)
+		{
+			const Level& src = m_levels[i - 1];
+			Level& dst = m_levels[i];
+			for (int y = 0; y < dst.height; y++)
+			{
+				//Odd sizes clamp to the last row/column, so every source texel is covered
+				int y0 = std::min(y * 2, src.height - 1);
+				int y1 = std::min(y * 2 + 1, src.height - 1);
+				for (int x = 0; x < dst.width; x++)
+				{
+					int x0 = std::min(x * 2, src.width - 1);
+					int x1 = std::min(x * 2 + 1, src.width - 1);
+					float d = std::max(std::max(src.depth[(size_t)y0 * src.width + x0], src.depth[(size_t)y0 * src.width + x1]),
+						std::max(src.depth[(size_t)y1 * src.width + x0], src.depth[(size_t)y1 * src.width + x1]));
+					dst.depth[(size_t)y * dst.width + x] = d;
+				}
+			}
+		}
+	}
+
+	bool HiZPyramid::isOccluded(const AABB& bounds, const glm::mat4& model) const
+	{
+		if (m_levels.empty() || bounds.isEmpty()) {
+			return false;
+		}
+		glm::mat4 mvp = m_viewProjection * model;
+		glm::vec2 ndcMin = glm::vec2(1.0f), ndcMax = glm::vec2(-1.0f);
+		float nearestDepth = 1.0f;
+		for (int i = 0; i < 8; i++)
+		{
+			glm::vec4 clip = mvp * glm::vec4(bounds.corner(i), 1.0f);
+			//Crosses the near plane, so treat as visible
+			if (clip.w <= 1e-5f) {
+				return false;
+			}
+			glm::vec3 ndc = glm::vec3(clip) / clip.w;
+			ndcMin = glm::min(ndcMin, glm::vec2(ndc));
+			ndcMax = glm::max(ndcMax, glm::vec2(ndc));
+			nearestDepth = std::min(nearestDepth, ndc.z * 0.5f + 0.5f);
+		}
+		//Off screen entirely: frustum culling's job, not ours
+		if (ndcMax.x < -1.0f || ndcMax.y < -1.0f || ndcMin.x > 1.0f || ndcMin.y > 1.0f) {
+			return false;
+		}
+		const Level& base = m_levels[0];
+		float x0 = glm::clamp((ndcMin.x * 0.5f + 0.5f) * base.width, 0.0f, base.width - 1.0f);
+		float x1 = glm::clamp((ndcMax.x * 0.5f + 0.5f) * base.width, 0.0f, base.width - 1.0f);
+		float y0 = glm::clamp((ndcMin.y * 0.5f + 0.5f) * base.height, 0.0f, base.height - 1.0f);
+		float y1 = glm::clamp((ndcMax.y * 0.5f + 0.5f) * base.height, 0.0f, base.height - 1.0f);
+		//Pick the level where the rectangle spans at most 4 texels per side. Coarser levels are cheaper,
+		//but a rectangle straddling a texel border would then pull in a lot of unrelated depth.
+		float size = std::max(x1 - x0, y1 - y0);
+		int level = size > 4.0f ? (int)ceilf(log2f(size / 4.0f)) : 0;
+		level = std::min(level, (int)m_levels.size() - 1);
+		const Level& l = m_levels[level];
+		int tx0 = std::min((int)x0 >> level, l.width - 1);
+		int tx1 = std::min((int)x1 >> level, l.width - 1);
+		int ty0 = std::min((int)y0 >> level, l.height - 1);
+		int ty1 = std::min((int)y1 >> level, l.height - 1);
+		float farthest = 0.0f;
+		for (int y = ty0; y <= ty1; y++)
+		{
+			for (int x = tx0; x <= tx1; x++)
+			{
+				farthest = std::max(farthest, l.depth[(size_t)y * l.width + x]);
+			}
+		}
+		return nearestDepth > farthest;
+	}
+
+	void DepthReadback::request(int width, int height, const glm::mat4& viewProjection)
+	{
+		m_queue.readPixels(0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, [this, viewProjection](const ReadbackResult& result) {
+			const float* depth = (const float*)result.data;
+			m_depth.assign(depth, depth + (size_t)result.width * result.height);
+			m_width = result.width;
+			m_height = result.height;
+			m_viewProjection = viewProjection;
+			m_hasNew = true;
+		});
+	}
+
+	bool DepthReadback::poll(std::vector<float>* depth, int* width, int* height, glm::mat4* viewProjection)
+	{
+		m_queue.poll();
+		if (!m_hasNew) {
+			return false;
+		}
+		m_hasNew = false;
+		//Swapping hands the caller's old buffer back for the next copy, so steady state never allocates
+		depth->swap(m_depth);
+		*width = m_width;
+		*height = m_height;
+		*viewProjection = m_viewProjection;
+		return true;
+	}
+}
@@ -0,0 +1,78 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include "bounds.h"
+#include "mesh.h"
+#include "readback.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// Software depth rasterizer for occluders. Writes the nearest depth per pixel in [0,1] (GL window depth),
+	/// so culling can run without a GPU or before the GPU has produced a depth buffer.
+	/// </summary>
+	class DepthRasterizer {
+	public:
+		DepthRasterizer(int width = 256, int height = 128);
+		void resize(int width, int height);
+		//Fills with the far plane
+		void clear();
+		//Triangles crossing the near plane are skipped, which only ever makes occlusion more conservative
+		void drawMesh(const MeshData& mesh, const glm::mat4& modelViewProjection);
+		void drawTriangle(const glm::vec4& clipA, const glm::vec4& clipB, const glm::vec4& clipC);
+		inline int getWidth()const { return m_width; }
+		inline int getHeight()const { return m_height; }
+		inline const float* getDepth()const { return m_depth.data(); }
+	private:
+		int m_width;
+		int m_height;
+		std::vector<float> m_depth;
+	};
+
+	/// <summary>
+	/// Hierarchical depth buffer. Each level stores the farthest depth of the 2x2 texels below it,
+	/// so one or two lookups tell whether everything behind a screen rectangle is hidden.
+	/// </summary>
+	class HiZPyramid {
+	public:
+		//depth is bottom-to-top rows, same as glReadPixels. viewProjection is the matrix the depth was rendered with.
+		void build(const float* depth, int width, int height, const glm::mat4& viewProjection);
+		//True if bounds (transformed by model) is entirely behind the depth this pyramid was built from
+		bool isOccluded(const AABB& bounds, const glm::mat4& model)const;
+		inline bool isValid()const { return !m_levels.empty(); }
+		inline int getNumLevels()const { return (int)m_levels.size(); }
+		inline const glm::mat4& getViewProjection()const { return m_viewProjection; }
+	private:
+		struct Level {
+			int width;
+			int height;
+			std::vector<float> depth;
+		};
+		std::vector<Level> m_levels;
+		glm::mat4 m_viewProjection = glm::mat4(1.0f);
+	};
+
+	/// <summary>
+	/// Copies the depth of the bound read framebuffer into pixel buffers without waiting on the GPU.
+	/// Results come back a frame or more later, together with the matrix they were rendered with.
+	/// </summary>
+	class DepthReadback {
+	public:
+		DepthReadback() : m_queue(3) {};
+		//Starts copying the current depth buffer. Skipped if every buffer is still in flight.
+		void request(int width, int height, const glm::mat4& viewProjection);
+		//Gets the newest finished copy, if any. Returns false if nothing new has arrived.
+		bool poll(std::vector<float>* depth, int* width, int* height, glm::mat4* viewProjection);
+	private:
+		ReadbackQueue m_queue;
+		//Newest delivered copy. Older ones that arrive in the same poll are overwritten.
+		std::vector<float> m_depth;
+		int m_width = 0;
+		int m_height = 0;
+		glm::mat4 m_viewProjection = glm::mat4(1.0f);
+		bool m_hasNew = false;
+	};
+}
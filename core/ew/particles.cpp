@@ -0,0 +1,236 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include "particles.h"
+#include "metrics.h"
+#include "external/glad.h"
+#include <stddef.h>
+#include <algorithm>
+#include <math.h>
+
+namespace ew {
+	//Mirrors the Counters block in the particle shaders
+	struct ParticleCounters {
+		unsigned int pointsCommand[4]; //DrawArraysIndirectCommand: count, instanceCount, first, baseInstance
+		unsigned int quadsCommand[4];
+		unsigned int dispatchCommand[3]; //Work groups for the next simulate pass
+		unsigned int aliveCount; //Particles in the current buffer
+		unsigned int newAliveCount; //Append cursor into the other buffer
+		unsigned int padding[3];
+	};
+
+	static const unsigned int WORK_GROUP_SIZE = 256;
+
+	//Both particle buffers, the counters and the sort keys
+	static int64_t getBufferBytes(unsigned int capacity, unsigned int sortSize) {
+		return (int64_t)(sizeof(Particle) * capacity * 2 + sizeof(ParticleCounters) + sizeof(float) * 2 * sortSize);
+	}
+
+	ParticleSystem::ParticleSystem(unsigned int capacity, const std::string& shaderFolder)
+		: m_capacity(std::max(capacity, 1u)),
+		m_emitShader(shaderFolder + "particleEmit.comp"),
+		m_simulateShader(shaderFolder + "particleSimulate.comp"),
+		m_finalizeShader(shaderFolder + "particleFinalize.comp"),
+		m_sortShader(shaderFolder + "particleSort.comp")
+	{
+		m_sortSize = 1;
+		while (m_sortSize < m_capacity) {
+			m_sortSize <<= 1;
+		}
+		glCreateBuffers(2, m_particleBuffers);
+		for (int i = 0; i < 2; i++) {
+			glNamedBufferStorage(m_particleBuffers[i], sizeof(Particle) * m_capacity, nullptr, 0);
+		}
+		glCreateBuffers(1, &m_counterBuffer);
+		glNamedBufferStorage(m_counterBuffer, sizeof(ParticleCounters), nullptr, GL_DYNAMIC_STORAGE_BIT);
+		glCreateBuffers(1, &m_sortBuffer);
+		glNamedBufferStorage(m_sortBuffer, sizeof(float) * 2 * m_sortSize, nullptr, 0);
+		recordBufferBytes(getBufferBytes(m_capacity, m_sortSize));
+		glCreateVertexArrays(1, &m_vao);
+		clear();
+	}
+
+	ParticleSystem::~ParticleSystem()
+	{
+		glDeleteVertexArrays(1, &m_vao);
+		glDeleteBuffers(1, &m_sortBuffer);
+		glDeleteBuffers(1, &m_counterBuffer);
+		glDeleteBuffers(2, m_particleBuffers);
+		recordBufferBytes(-getBufferBytes(m_capacity, m_sortSize));
+	}
+
+	void ParticleSystem::clear()
+	{
+		ParticleCounters counters = {};
+		counters.pointsCommand[1] = 1;
+		counters.quadsCommand[0] = 4;
+		counters.dispatchCommand[1] = counters.dispatchCommand[2] = 1;
+		glNamedBufferSubData(m_counterBuffer, 0, sizeof(counters), &counters);
+		m_emitRemainder = 0.0f;
+		m_sorted = false;
+	}
+
+	/// <summary>
+	/// Advances the simulation one step. Three dependent compute passes:
+	/// simulate survivors from the current buffer into the other, append new particles after them,
+	/// then a single thread publishes the new count as draw and dispatch arguments.
+	/// </summary>
+	void ParticleSystem::update(float deltaTime, const ParticleEmitter& emitter, const ParticleSimulation& simulation)
+	{
+		unsigned int source = m_particleBuffers[m_current];
+		unsigned int destination = m_particleBuffers[1 - m_current];
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, source);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, destination);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_counterBuffer);
+
+		//SIMULATE + COMPACT
+		//Sized by last update's alive count, without the CPU ever reading it
+		m_simulateShader.use();
+		m_simulateShader.setFloat("_DeltaTime", deltaTime);
+		m_simulateShader.setVec3("_Gravity", simulation.gravity);
+		m_simulateShader.setFloat("_Drag", simulation.drag);
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_counterBuffer);
+		glDispatchComputeIndirect(offsetof(ParticleCounters, dispatchCommand));
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		//EMIT
+		m_emitRemainder += std::max(emitter.rate, 0.0f) * deltaTime;
+		unsigned int numToEmit = (unsigned int)std::min(m_emitRemainder, (float)m_capacity);
+		m_emitRemainder -= numToEmit;
+		if (numToEmit > 0) {
+			m_emitShader.use();
+			m_emitShader.setInt("_NumToEmit", numToEmit);
+			m_emitShader.setInt("_Capacity", m_capacity);
+			m_emitShader.setInt("_Seed", m_frame);
+			m_emitShader.setVec3("_EmitterPosition", emitter.position);
+			m_emitShader.setFloat("_EmitterSize", emitter.size);
+			m_emitShader.setVec3("_EmitterVelocity", emitter.velocity);
+			m_emitShader.setFloat("_VelocitySpread", emitter.velocitySpread);
+			m_emitShader.setFloat("_MinLifetime", emitter.minLifetime);
+			m_emitShader.setFloat("_MaxLifetime", emitter.maxLifetime);
+			m_emitShader.dispatch((numToEmit + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE);
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		}
+
+		//FINALIZE
+		m_finalizeShader.use();
+		m_finalizeShader.setInt("_Capacity", m_capacity);
+		m_finalizeShader.dispatch(1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+		m_current = 1 - m_current;
+		m_frame++;
+		m_sorted = false;
+	}
+
+	/// <summary>
+	/// Bitonic sort of view depth and index pairs, farthest first. Runs over every slot up to a power of two,
+	/// since only the GPU knows the alive count. Dead slots sort to the end.
+	/// </summary>
+	void ParticleSystem::sort(const glm::mat4& view)
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_particleBuffers[m_current]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_counterBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_sortBuffer);
+		m_sortShader.use();
+		m_sortShader.setMat4("_View", view);
+		m_sortShader.setInt("_SortSize", m_sortSize);
+		unsigned int numGroups = (m_sortSize + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE;
+		//Write keys
+		m_sortShader.setInt("_Pass", 0);
+		m_sortShader.dispatch(numGroups);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		m_sortShader.setInt("_Pass", 1);
+		for (unsigned int k = 2; k <= m_sortSize; k <<= 1) {
+			m_sortShader.setInt("_K", k);
+			for (unsigned int j = k >> 1; j > 0; j >>= 1) {
+				m_sortShader.setInt("_J", j);
+				m_sortShader.dispatch(numGroups);
+				glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+			}
+		}
+		m_sorted = true;
+	}
+
+	void ParticleSystem::draw(const Shader& shader, ParticleDrawMode drawMode) const
+	{
+		bool quads = drawMode == ParticleDrawMode::QUADS;
+		shader.use();
+		shader.setInt("_DrawQuads", quads);
+		shader.setInt("_UseSortedIndices", quads && m_sorted);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_particleBuffers[m_current]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_sortBuffer);
+		glBindVertexArray(m_vao);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_counterBuffer);
+		if (quads) {
+			glDrawArraysIndirect(GL_TRIANGLE_STRIP, (const void*)offsetof(ParticleCounters, quadsCommand));
+		}
+		else {
+			glDrawArraysIndirect(GL_POINTS, (const void*)offsetof(ParticleCounters, pointsCommand));
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		glBindVertexArray(0);
+	}
+
+	void ParticleSystem::readParticles(std::vector<Particle>* particles) const
+	{
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		ParticleCounters counters;
+		glGetNamedBufferSubData(m_counterBuffer, 0, sizeof(counters), &counters);
+		particles->resize(std::min(counters.aliveCount, m_capacity));
+		if (!particles->empty()) {
+			glGetNamedBufferSubData(m_particleBuffers[m_current], 0, sizeof(Particle) * particles->size(), particles->data());
+		}
+	}
+
+	//PCG hash, identical to pcgHash in particleEmit.comp
+	static unsigned int pcgHash(unsigned int v)
+	{
+		unsigned int state = v * 747796405u + 2891336453u;
+		unsigned int word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+		return (word >> 22u) ^ word;
+	}
+
+	static float nextRandom(unsigned int* state)
+	{
+		*state = pcgHash(*state);
+		return (float)(*state >> 8) * (1.0f / 16777216.0f);
+	}
+
+	void emitParticlesReference(const ParticleEmitter& emitter, unsigned int seed, unsigned int count, std::vector<Particle>* particles)
+	{
+		for (unsigned int i = 0; i < count; i++) {
+			unsigned int state = pcgHash(i + pcgHash(seed));
+			glm::vec3 offset, jitter;
+			for (int c = 0; c < 3; c++) {
+				offset[c] = nextRandom(&state) * 2.0f - 1.0f;
+			}
+			for (int c = 0; c < 3; c++) {
+				jitter[c] = nextRandom(&state) * 2.0f - 1.0f;
+			}
+			float t = nextRandom(&state);
+			float lifetime = emitter.minLifetime * (1.0f - t) + emitter.maxLifetime * t;
+			Particle particle;
+			particle.positionLife = glm::vec4(emitter.position + offset * emitter.size, lifetime);
+			particle.velocityLifetime = glm::vec4(emitter.velocity + jitter * emitter.velocitySpread, lifetime);
+			particles->push_back(particle);
+		}
+	}
+
+	void simulateParticlesReference(const std::vector<Particle>& particles, const ParticleSimulation& simulation, float deltaTime, std::vector<Particle>* survivors)
+	{
+		survivors->clear();
+		float damping = std::max(1.0f - simulation.drag * deltaTime, 0.0f);
+		for (const Particle& particle : particles) {
+			float life = particle.positionLife.w - deltaTime;
+			if (life <= 0.0f) {
+				continue;
+			}
+			glm::vec3 velocity = (glm::vec3(particle.velocityLifetime) + simulation.gravity * deltaTime) * damping;
+			glm::vec3 position = glm::vec3(particle.positionLife) + velocity * deltaTime;
+			survivors->push_back({ glm::vec4(position, life), glm::vec4(velocity, particle.velocityLifetime.w) });
+		}
+	}
+}
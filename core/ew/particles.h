@@ -0,0 +1,82 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include "shader.h"
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+namespace ew {
+	//Matches the std430 layout in the particle shaders
+	struct Particle {
+		glm::vec4 positionLife; //xyz = position, w = seconds left to live
+		glm::vec4 velocityLifetime; //xyz = velocity, w = total lifetime
+	};
+
+	struct ParticleEmitter {
+		glm::vec3 position = glm::vec3(0.0f);
+		float size = 0.2f; //Half extent of the box particles spawn in
+		glm::vec3 velocity = glm::vec3(0.0f, 4.0f, 0.0f);
+		float velocitySpread = 1.5f; //Random velocity added per axis, up to this much either way
+		float minLifetime = 1.5f;
+		float maxLifetime = 3.0f;
+		float rate = 100000.0f; //Particles per second
+	};
+
+	struct ParticleSimulation {
+		glm::vec3 gravity = glm::vec3(0.0f, -9.8f, 0.0f);
+		float drag = 0.2f; //Fraction of velocity lost per second
+	};
+
+	enum class ParticleDrawMode {
+		POINTS = 0,
+		QUADS = 1 //Camera facing, instanced from a 4 vertex strip
+	};
+
+	/// <summary>
+	/// Particles simulated entirely on the GPU. Each update simulates the current buffer into the other one,
+	/// keeping only survivors, then appends newly emitted particles. The alive count never leaves the GPU:
+	/// it drives an indirect dispatch for the next update and indirect draws.
+	/// </summary>
+	class ParticleSystem {
+	public:
+		//Loads particleEmit.comp, particleSimulate.comp, particleFinalize.comp and particleSort.comp from shaderFolder
+		ParticleSystem(unsigned int capacity, const std::string& shaderFolder);
+		~ParticleSystem();
+		ParticleSystem(const ParticleSystem&) = delete;
+		ParticleSystem& operator=(const ParticleSystem&) = delete;
+		//Simulates, removes dead particles and emits new ones
+		void update(float deltaTime, const ParticleEmitter& emitter, const ParticleSimulation& simulation);
+		//Sorts alive particles back to front for alpha blending. Used by the next QUADS draw.
+		void sort(const glm::mat4& view);
+		//Draws alive particles with a shader built from particle.vert and particle.frag. Blend and depth state are left to the caller.
+		void draw(const Shader& shader, ParticleDrawMode drawMode)const;
+		//Kills every particle
+		void clear();
+		//Copies the alive particles back, in whatever order the GPU left them. Stalls, so only for tests and tools.
+		void readParticles(std::vector<Particle>* particles)const;
+		inline unsigned int getCapacity()const { return m_capacity; }
+	private:
+		unsigned int m_capacity;
+		unsigned int m_sortSize; //Capacity rounded up to a power of two
+		unsigned int m_particleBuffers[2] = {};
+		unsigned int m_counterBuffer = 0; //Indirect commands and alive counts
+		unsigned int m_sortBuffer = 0; //Depth and particle index pairs
+		unsigned int m_vao = 0; //Empty. Vertices are generated from gl_VertexID and gl_InstanceID.
+		int m_current = 0; //Buffer holding the latest alive particles
+		unsigned int m_frame = 0; //Seeds emission
+		float m_emitRemainder = 0.0f;
+		bool m_sorted = false;
+		Shader m_emitShader;
+		Shader m_simulateShader;
+		Shader m_finalizeShader;
+		Shader m_sortShader;
+	};
+
+	//Same random numbers as particleEmit.comp, so CPU and GPU spawn identical particles
+	void emitParticlesReference(const ParticleEmitter& emitter, unsigned int seed, unsigned int count, std::vector<Particle>* particles);
+	//Same math as particleSimulate.comp. Survivors keep their order, while the GPU's order is arbitrary.
+	void simulateParticlesReference(const std::vector<Particle>& particles, const ParticleSimulation& simulation, float deltaTime, std::vector<Particle>* survivors);
+}
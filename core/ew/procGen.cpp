@@ -3,6 +3,7 @@
 */
 
 #include "procGen.h"
+#include "meshProcessing.h"
 #include <stdlib.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
@@ -47,9 +48,9 @@ namespace ew {
 	/// Creates a cube of uniform size
 	/// </summary>
 	/// <param name="size">Total width, height, depth</param>
-	/// <param name="mesh">MeshData struct to fill. Will be cleared.</param>
-	MeshData createCube(float size) {
-		MeshData mesh;
+	/// <param name="resource">Memory resource the mesh allocates from</param>
+	MeshData createCube(float size, std::pmr::memory_resource* resource) {
+		MeshData mesh(resource);
 		mesh.vertices.reserve(24); //6 x 4 vertices
 		mesh.indices.reserve(36); //6 x 6 indices
 		createCubeFace(vec3{ +0.0f,+0.0f,+1.0f }, size, &mesh); //Front
@@ -58,13 +59,16 @@ namespace ew {
 		createCubeFace(vec3{ -1.0f,+0.0f,+0.0f }, size, &mesh); //Left
 		createCubeFace(vec3{ +0.0f,-1.0f,+0.0f }, size, &mesh); //Bottom
 		createCubeFace(vec3{ +0.0f,+0.0f,-1.0f }, size, &mesh); //Back
+		generateTangents(&mesh);
 		return mesh;
 	}
-	MeshData createPlane(float width, float height, int subdivisions)
+	MeshData createPlane(float width, float height, int subdivisions, std::pmr::memory_resource* resource)
 	{
 		//VERTICES
-		MeshData mesh;
+		MeshData mesh(resource);
 		int columns = subdivisions + 1;
+		mesh.vertices.reserve(columns * columns);
+		mesh.indices.reserve(subdivisions * subdivisions * 6);
 		for (size_t row = 0; row <= subdivisions; row++)
 		{
 			for (size_t col = 0; col <= subdivisions; col++)
@@ -93,11 +97,14 @@ namespace ew {
 				mesh.indices.push_back(start);
 			}
 		}
+		generateTangents(&mesh);
 		return mesh;
 	}
-	MeshData createSphere(float radius, int subdivisions)
+	MeshData createSphere(float radius, int subdivisions, std::pmr::memory_resource* resource)
 	{
-		MeshData mesh;
+		MeshData mesh(resource);
+		mesh.vertices.reserve((subdivisions + 1) * (subdivisions + 1));
+		mesh.indices.reserve(subdivisions * subdivisions * 6);
 		//VERTICES
 		float thetaStep = glm::two_pi<float>() / subdivisions;
 		float phiStep = glm::pi<float>() / subdivisions;
@@ -152,6 +159,7 @@ namespace ew {
 			mesh.indices.push_back(sideStart + i + 1);
 			mesh.indices.push_back(poleStart + i);
 		}
+		generateTangents(&mesh);
 		return mesh;
 	}
 	void createCylinderRing(MeshData* meshData, float radius, int subdivisions, float y, bool sideFacing) {
@@ -175,9 +183,12 @@ namespace ew {
 			meshData->vertices.push_back(v);
 		}
 	}
-	MeshData createCylinder(float radius, float height, int subdivisions)
+	MeshData createCylinder(float radius, float height, int subdivisions, std::pmr::memory_resource* resource)
 	{
-		MeshData mesh;
+		MeshData mesh(resource);
+		//2 center vertices + 4 rings, 4 triangles per column
+		mesh.vertices.reserve(2 + (subdivisions + 1) * 4);
+		mesh.indices.reserve((subdivisions + 1) * 12);
 
 		//VERTICES
 		{
@@ -235,6 +246,7 @@ namespace ew {
 				mesh.indices.push_back(sideStart + i + 1);
 			}
 		}
+		generateTangents(&mesh);
 		return mesh;
 	}
 }
\ No newline at end of file
@@ -6,8 +6,8 @@
 #include "mesh.h"
 
 namespace ew {
-	MeshData createCube(float size);
-	MeshData createPlane(float width, float height, int subdivisions);
-	MeshData createSphere(float radius, int subdivisions);
-	MeshData createCylinder(float radius, float height, int subdivisions);
+	MeshData createCube(float size, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	MeshData createPlane(float width, float height, int subdivisions, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	MeshData createSphere(float radius, int subdivisions, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	MeshData createCylinder(float radius, float height, int subdivisions, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 }
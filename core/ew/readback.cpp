@@ -0,0 +1,162 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include "readback.h"
+#include "external/glad.h"
+#include <stdio.h>
+
+namespace ew {
+	ReadbackQueue::ReadbackQueue(int maxInFlight)
+	{
+		m_slots.resize(maxInFlight > 0 ? maxInFlight : 1);
+	}
+
+	ReadbackQueue::~ReadbackQueue()
+	{
+		//Pending copies are dropped without calling back, since whatever the callbacks point at may be gone
+		for (Slot& slot : m_slots)
+		{
+			if (slot.fence != nullptr) {
+				glDeleteSync((GLsync)slot.fence);
+			}
+			if (slot.pbo != 0) {
+				glDeleteBuffers(1, &slot.pbo);
+			}
+		}
+	}
+
+	size_t ReadbackQueue::getPixelSize(int format, int type)
+	{
+		if (type == GL_UNSIGNED_INT_24_8) {
+			return 4;
+		}
+		size_t components = 0;
+		switch (format) {
+		case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX:
+			components = 1; break;
+		case GL_RG: case GL_RG_INTEGER:
+			components = 2; break;
+		case GL_RGB: case GL_BGR: case GL_RGB_INTEGER:
+			components = 3; break;
+		case GL_RGBA: case GL_BGRA: case GL_RGBA_INTEGER:
+			components = 4; break;
+		}
+		switch (type) {
+		case GL_UNSIGNED_BYTE: case GL_BYTE:
+			return components;
+		case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+			return components * 2;
+		case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT:
+			return components * 4;
+		}
+		return 0;
+	}
+
+	ReadbackQueue::Slot* ReadbackQueue::beginCopy(int width, int height, int format, int type, Callback* callback)
+	{
+		if (m_numInFlight == (int)m_slots.size()) {
+			return nullptr;
+		}
+		size_t pixelSize = getPixelSize(format, type);
+		if (pixelSize == 0 || width <= 0 || height <= 0) {
+			printf("Unsupported readback of %dx%d pixels, format 0x%X type 0x%X\n", width, height, format, type);
+			return nullptr;
+		}
+		Slot& slot = m_slots[(m_head + m_numInFlight) % m_slots.size()];
+		slot.size = pixelSize * width * height;
+		slot.width = width;
+		slot.height = height;
+		slot.callback = std::move(*callback);
+		if (slot.pbo == 0) {
+			glCreateBuffers(1, &slot.pbo);
+		}
+		//Buffers only grow, so a queue reading the same size every frame never reallocates
+		if (slot.capacity < slot.size) {
+			glNamedBufferData(slot.pbo, slot.size, NULL, GL_STREAM_READ);
+			slot.capacity = slot.size;
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+		//Rows are packed tightly instead of padded to 4 bytes
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		return &slot;
+	}
+
+	void ReadbackQueue::endCopy(Slot* slot)
+	{
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_numInFlight++;
+	}
+
+	bool ReadbackQueue::readPixels(int x, int y, int width, int height, int format, int type, Callback callback)
+	{
+		Slot* slot = beginCopy(width, height, format, type, &callback);
+		if (slot == nullptr) {
+			return false;
+		}
+		glReadPixels(x, y, width, height, format, type, NULL);
+		endCopy(slot);
+		return true;
+	}
+
+	bool ReadbackQueue::readTexture(unsigned int texture, int level, int width, int height, int format, int type, Callback callback)
+	{
+		Slot* slot = beginCopy(width, height, format, type, &callback);
+		if (slot == nullptr) {
+			return false;
+		}
+		glGetTextureImage(texture, level, format, type, (GLsizei)slot->size, NULL);
+		endCopy(slot);
+		return true;
+	}
+
+	void ReadbackQueue::deliverOldest()
+	{
+		Slot& slot = m_slots[m_head];
+		glDeleteSync((GLsync)slot.fence);
+		slot.fence = nullptr;
+		//Moved out so whatever the callback captured is released once it has run
+		Callback callback = std::move(slot.callback);
+		slot.callback = nullptr;
+		const void* mapped = glMapNamedBufferRange(slot.pbo, 0, slot.size, GL_MAP_READ_BIT);
+		if (mapped != NULL) {
+			ReadbackResult result;
+			result.data = mapped;
+			result.size = slot.size;
+			result.width = slot.width;
+			result.height = slot.height;
+			if (callback) {
+				callback(result);
+			}
+			glUnmapNamedBuffer(slot.pbo);
+		}
+		else {
+			printf("Failed to map readback buffer\n");
+		}
+		//Freed only after unmapping, so a copy queued from the callback can't land in a mapped buffer
+		m_head = (m_head + 1) % m_slots.size();
+		m_numInFlight--;
+	}
+
+	void ReadbackQueue::poll()
+	{
+		//Fences signal in submission order, so stop at the first one that hasn't
+		while (m_numInFlight > 0) {
+			GLenum status = glClientWaitSync((GLsync)m_slots[m_head].fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+				break;
+			}
+			deliverOldest();
+		}
+	}
+
+	void ReadbackQueue::flush()
+	{
+		while (m_numInFlight > 0) {
+			glClientWaitSync((GLsync)m_slots[m_head].fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+			deliverOldest();
+		}
+	}
+}
@@ -0,0 +1,62 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include <functional>
+#include <stddef.h>
+#include <vector>
+
+namespace ew {
+	struct ReadbackResult {
+		const void* data = nullptr; //Tightly packed rows, bottom row first
+		size_t size = 0;
+		int width = 0;
+		int height = 0;
+	};
+
+	/// <summary>
+	/// Copies pixels into pixel buffer objects without waiting on the GPU. A fence marks when each copy is done,
+	/// and poll() hands finished copies to their callbacks in the order they were requested, usually a frame or two later.
+	/// Callbacks run on the GL thread while the buffer is mapped: copy what is needed, and do slow work like encoding elsewhere.
+	/// </summary>
+	class ReadbackQueue {
+	public:
+		typedef std::function<void(const ReadbackResult& result)> Callback;
+
+		ReadbackQueue(int maxInFlight = 3);
+		~ReadbackQueue();
+		ReadbackQueue(const ReadbackQueue&) = delete;
+		ReadbackQueue& operator=(const ReadbackQueue&) = delete;
+		//Copies a rectangle of the bound read framebuffer. Returns false without copying if maxInFlight copies are pending.
+		bool readPixels(int x, int y, int width, int height, int format, int type, Callback callback);
+		//Copies a whole mip level of a texture. width and height must be the level's size.
+		bool readTexture(unsigned int texture, int level, int width, int height, int format, int type, Callback callback);
+		//Delivers every copy the GPU has finished. Call once a frame. A slot is only freed once its callback returns.
+		void poll();
+		//Waits for every pending copy and delivers it. Stalls, so only for shutdown and tools.
+		void flush();
+		inline int getNumInFlight()const { return m_numInFlight; }
+		inline int getMaxInFlight()const { return (int)m_slots.size(); }
+		//Bytes per pixel of a format and type pair, 0 if unsupported
+		static size_t getPixelSize(int format, int type);
+	private:
+		struct Slot {
+			unsigned int pbo = 0;
+			size_t capacity = 0;
+			void* fence = nullptr;
+			size_t size = 0;
+			int width = 0;
+			int height = 0;
+			Callback callback;
+		};
+		//Next free slot with its buffer grown to fit size bytes and bound for packing, or null if all are in flight
+		Slot* beginCopy(int width, int height, int format, int type, Callback* callback);
+		void endCopy(Slot* slot);
+		//Maps the oldest copy, calls its callback and frees the slot
+		void deliverOldest();
+		std::vector<Slot> m_slots; //Ring, oldest in flight at m_head
+		int m_head = 0;
+		int m_numInFlight = 0;
+	};
+}
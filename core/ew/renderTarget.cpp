@@ -0,0 +1,206 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include "renderTarget.h"
+#include "external/glad.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace ew {
+	RenderTargetPool::~RenderTargetPool()
+	{
+		for (const Entry& entry : m_entries) {
+			glDeleteTextures(1, &entry.texture);
+		}
+	}
+
+	unsigned int RenderTargetPool::acquire(int width, int height, int internalFormat)
+	{
+		for (Entry& entry : m_entries) {
+			if (!entry.inUse && entry.width == width && entry.height == height && entry.internalFormat == internalFormat) {
+				entry.inUse = true;
+				return entry.texture;
+			}
+		}
+		unsigned int texture;
+		glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+		glTextureStorage2D(texture, 1, internalFormat, width, height);
+		glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		m_entries.push_back({ texture, width, height, internalFormat, true });
+		m_numCreated++;
+		return texture;
+	}
+
+	void RenderTargetPool::release(unsigned int texture)
+	{
+		for (Entry& entry : m_entries) {
+			if (entry.texture == texture) {
+				entry.inUse = false;
+				return;
+			}
+		}
+	}
+
+	void RenderTargetPool::trim()
+	{
+		for (const Entry& entry : m_entries) {
+			if (!entry.inUse) {
+				glDeleteTextures(1, &entry.texture);
+			}
+		}
+		m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), [](const Entry& e) { return !e.inUse; }), m_entries.end());
+	}
+
+	RenderTarget::RenderTarget(RenderTargetPool* pool)
+		: RenderTarget(pool, GL_RGBA8, GL_DEPTH_COMPONENT32F)
+	{
+	}
+
+	RenderTarget::RenderTarget(RenderTargetPool* pool, int colorFormat, int depthFormat)
+		: m_pool(pool), m_colorFormat(colorFormat), m_depthFormat(depthFormat)
+	{
+		glCreateFramebuffers(1, &m_fbo);
+	}
+
+	RenderTarget::~RenderTarget()
+	{
+		releaseAttachments();
+		glDeleteFramebuffers(1, &m_fbo);
+	}
+
+	void RenderTarget::releaseAttachments()
+	{
+		unsigned int textures[2] = { m_color, m_depth };
+		for (unsigned int texture : textures) {
+			if (texture == 0) {
+				continue;
+			}
+			if (m_pool) {
+				m_pool->release(texture);
+			}
+			else {
+				glDeleteTextures(1, &texture);
+			}
+		}
+		m_color = m_depth = 0;
+	}
+
+	/// <summary>
+	/// Reallocates the color and depth attachments at a new size.
+	/// With a pool, going back to a size used before doesn't allocate anything.
+	/// </summary>
+	void RenderTarget::resize(int width, int height)
+	{
+		width = std::max(width, 1);
+		height = std::max(height, 1);
+		if (width == m_width && height == m_height) {
+			return;
+		}
+		releaseAttachments();
+		m_width = width;
+		m_height = height;
+		if (m_pool) {
+			m_color = m_pool->acquire(width, height, m_colorFormat);
+			m_depth = m_pool->acquire(width, height, m_depthFormat);
+		}
+		else {
+			glCreateTextures(GL_TEXTURE_2D, 1, &m_color);
+			glTextureStorage2D(m_color, 1, m_colorFormat, width, height);
+			glTextureParameteri(m_color, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTextureParameteri(m_color, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glCreateTextures(GL_TEXTURE_2D, 1, &m_depth);
+			glTextureStorage2D(m_depth, 1, m_depthFormat, width, height);
+		}
+		glNamedFramebufferTexture(m_fbo, GL_COLOR_ATTACHMENT0, m_color, 0);
+		glNamedFramebufferTexture(m_fbo, GL_DEPTH_ATTACHMENT, m_depth, 0);
+		GLenum status = glCheckNamedFramebufferStatus(m_fbo, GL_FRAMEBUFFER);
+		if (status != GL_FRAMEBUFFER_COMPLETE) {
+			printf("Render target %dx%d incomplete: 0x%x\n", width, height, status);
+		}
+	}
+
+	void RenderTarget::bind() const
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+		glViewport(0, 0, m_width, m_height);
+	}
+
+	/// <summary>
+	/// Upscales the color attachment to the default framebuffer.
+	/// Leaves the default framebuffer bound with a full screen viewport.
+	/// </summary>
+	void RenderTarget::blitToScreen(int screenWidth, int screenHeight) const
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, screenWidth, screenHeight);
+		glBlitNamedFramebuffer(m_fbo, 0, 0, 0, m_width, m_height, 0, 0, screenWidth, screenHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	}
+
+	bool RenderTarget::readColor(ReadbackQueue* queue, ReadbackQueue::Callback callback) const
+	{
+		return queue->readTexture(m_color, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, std::move(callback));
+	}
+
+	void RenderTarget::readColor(std::vector<unsigned char>* rgba) const
+	{
+		ReadbackQueue queue(1);
+		rgba->clear();
+		readColor(&queue, [rgba](const ReadbackResult& result) {
+			const unsigned char* pixels = (const unsigned char*)result.data;
+			rgba->assign(pixels, pixels + result.size);
+		});
+		queue.flush();
+	}
+
+	/// <summary>
+	/// Steers render scale towards the frame time target.
+	/// Pixel cost scales with area, so the ideal scale moves with the square root of the time ratio.
+	/// Scale moves at most one step per call and only grows once there is headroom, so it settles instead of oscillating.
+	/// </summary>
+	float DynamicResolution::update(float frameTimeMs)
+	{
+		if (frameTimeMs <= 0.0f) {
+			return m_scale;
+		}
+		m_smoothedMs = m_smoothedMs <= 0.0f ? frameTimeMs : m_smoothedMs * 0.9f + frameTimeMs * 0.1f;
+		bool overBudget = m_smoothedMs > targetFrameTimeMs;
+		bool underBudget = m_smoothedMs < targetFrameTimeMs * (1.0f - headroom);
+		if (!overBudget && !underBudget) {
+			return m_scale;
+		}
+		float ideal = m_scale * sqrtf(targetFrameTimeMs / m_smoothedMs);
+		float step = std::max(scaleStep, 0.001f);
+		float newScale = roundf(ideal / step) * step;
+		newScale = std::clamp(newScale, m_scale - step, m_scale + step);
+		newScale = std::clamp(newScale, minScale, maxScale);
+		if (newScale != m_scale) {
+			//Predict the new cost so stale samples at the old scale don't push it further
+			m_smoothedMs *= (newScale * newScale) / (m_scale * m_scale);
+			m_scale = newScale;
+		}
+		return m_scale;
+	}
+
+	ImageDiff diffImages(const unsigned char* a, const unsigned char* b, int width, int height, int tolerance)
+	{
+		ImageDiff diff;
+		size_t numPixels = (size_t)width * height;
+		for (size_t i = 0; i < numPixels; i++) {
+			int pixelMax = 0;
+			for (int c = 0; c < 4; c++) {
+				pixelMax = std::max(pixelMax, abs((int)a[i * 4 + c] - (int)b[i * 4 + c]));
+			}
+			diff.maxDifference = std::max(diff.maxDifference, pixelMax);
+			if (pixelMax > tolerance) {
+				diff.numDifferentPixels++;
+			}
+		}
+		return diff;
+	}
+}
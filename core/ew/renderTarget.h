@@ -0,0 +1,109 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include "readback.h"
+#include <cstddef>
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// Keeps released attachment textures around so render targets that change size
+	/// can pick up a matching texture instead of allocating a new one.
+	/// </summary>
+	class RenderTargetPool {
+	public:
+		RenderTargetPool() = default;
+		~RenderTargetPool();
+		RenderTargetPool(const RenderTargetPool&) = delete;
+		RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+		//Returns a texture with this size and internal format, reusing a released one if possible
+		unsigned int acquire(int width, int height, int internalFormat);
+		//Hands a texture from acquire() back to the pool
+		void release(unsigned int texture);
+		//Deletes textures that aren't in use
+		void trim();
+		inline size_t getNumTextures()const { return m_entries.size(); }
+		inline size_t getNumCreated()const { return m_numCreated; }
+	private:
+		struct Entry {
+			unsigned int texture;
+			int width;
+			int height;
+			int internalFormat;
+			bool inUse;
+		};
+		std::vector<Entry> m_entries;
+		size_t m_numCreated = 0;
+	};
+
+	/// <summary>
+	/// Offscreen framebuffer with a color and a depth texture.
+	/// Attachments come from a RenderTargetPool when one is given, otherwise they are owned directly.
+	/// </summary>
+	class RenderTarget {
+	public:
+		//Uses GL_RGBA8 color and GL_DEPTH_COMPONENT32F depth
+		RenderTarget(RenderTargetPool* pool = nullptr);
+		RenderTarget(RenderTargetPool* pool, int colorFormat, int depthFormat);
+		~RenderTarget();
+		RenderTarget(const RenderTarget&) = delete;
+		RenderTarget& operator=(const RenderTarget&) = delete;
+		//Reallocates attachments if the size changed
+		void resize(int width, int height);
+		//Binds for drawing and reading, and sets the viewport to cover the target
+		void bind()const;
+		//Stretches the color attachment over the default framebuffer with linear filtering
+		void blitToScreen(int screenWidth, int screenHeight)const;
+		//Queues an RGBA8 copy of the color attachment, bottom row first. The callback runs from a later queue->poll().
+		//Returns false if the queue is full.
+		bool readColor(ReadbackQueue* queue, ReadbackQueue::Callback callback)const;
+		//Same copy, but flushed straight away. Stalls, so for tests and tools, not per frame use.
+		void readColor(std::vector<unsigned char>* rgba)const;
+		inline int getWidth()const { return m_width; }
+		inline int getHeight()const { return m_height; }
+		inline unsigned int getFramebuffer()const { return m_fbo; }
+		inline unsigned int getColorTexture()const { return m_color; }
+		inline unsigned int getDepthTexture()const { return m_depth; }
+	private:
+		void releaseAttachments();
+		RenderTargetPool* m_pool;
+		int m_colorFormat;
+		int m_depthFormat;
+		int m_width = 0;
+		int m_height = 0;
+		unsigned int m_fbo = 0;
+		unsigned int m_color = 0;
+		unsigned int m_depth = 0;
+	};
+
+	/// <summary>
+	/// Picks a render scale that keeps GPU frame time near a target.
+	/// Scale is quantized so a pooled render target only ever sees a handful of sizes.
+	/// </summary>
+	class DynamicResolution {
+	public:
+		//Feeds the latest GPU frame time and returns the scale to render the next frame at
+		float update(float frameTimeMs);
+		inline float getScale()const { return m_scale; }
+		inline float getSmoothedFrameTimeMs()const { return m_smoothedMs; }
+
+		float targetFrameTimeMs = 1000.0f / 60.0f;
+		float minScale = 0.5f;
+		float maxScale = 1.0f;
+		float scaleStep = 0.05f; //Scale is rounded to multiples of this
+		float headroom = 0.1f; //Fraction of the target that counts as close enough to leave the scale alone
+	private:
+		float m_scale = 1.0f;
+		float m_smoothedMs = 0.0f;
+	};
+
+	struct ImageDiff {
+		int maxDifference = 0; //Largest difference of any channel, 0-255
+		int numDifferentPixels = 0; //Pixels with any channel off by more than the tolerance
+	};
+
+	//Compares two RGBA8 images of the same size
+	ImageDiff diffImages(const unsigned char* a, const unsigned char* b, int width, int height, int tolerance = 0);
+}
@@ -3,8 +3,8 @@
 */
 
 #include "shader.h"
-#include <fstream>
-#include <sstream>
+#include "file.h"
+#include <stdio.h>
 #include "external/glad.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -16,27 +16,27 @@ namespace ew {
 	/// <param name="filePath"></param>
 	/// <returns></returns>
 	std::string loadShaderSourceFromFile(const std::string& filePath) {
-		std::ifstream fstream(filePath);
-		if (!fstream.is_open()) {
+		ew::MappedFile file(filePath);
+		if (!file.isOpen()) {
 			printf("Failed to load file %s", filePath.c_str());
 			return {};
 		}
-		std::stringstream buffer;
-		buffer << fstream.rdbuf();
-		return buffer.str();
+		return std::string(file.view());
 	}
 
 	/// <summary>
 	/// Creates and compiles a shader object of a given type
 	/// </summary>
 	/// <param name="shaderType">Expects GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, etc.</param>
-	/// <param name="sourceCode">GLSL source code for the shader stage</param>
+	/// <param name="sourceCode">GLSL source code for the shader stage. Does not need to be null terminated.</param>
 	/// <returns></returns>
-	static unsigned int createShader(GLenum shaderType, const char* sourceCode) {
+	static unsigned int createShader(GLenum shaderType, std::string_view sourceCode) {
 		//Create a new vertex shader object
 		unsigned int shader = glCreateShader(shaderType);
-		//Supply the shader object with source code
-		glShaderSource(shader, 1, &sourceCode, NULL);
+		//Supply the shader object with source code. Passing the length lets GL read straight from a mapped file.
+		const char* source = sourceCode.data();
+		GLint length = (GLint)sourceCode.size();
+		glShaderSource(shader, 1, &source, &length);
 		//Compile the shader object
 		glCompileShader(shader);
 		int success;
@@ -51,19 +51,14 @@ namespace ew {
 	}
 
 	/// <summary>
-	/// Creates a shader program with a vertex and fragment shader
+	/// Links compiled stages into a program, then deletes the stages
 	/// </summary>
-	/// <param name="vertexShaderSource">GLSL source code for the vertex shader</param>
-	/// <param name="fragmentShaderSource">GLSL source code for the fragment shader</param>
-	/// <returns></returns>
-	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource) {
-		unsigned int vertexShader = createShader(GL_VERTEX_SHADER, vertexShaderSource);
-		unsigned int fragmentShader = createShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
-
+	static unsigned int linkShaderProgram(const unsigned int* shaders, int numShaders) {
 		unsigned int shaderProgram = glCreateProgram();
 		//Attach each stage
-		glAttachShader(shaderProgram, vertexShader);
-		glAttachShader(shaderProgram, fragmentShader);
+		for (int i = 0; i < numShaders; i++) {
+			glAttachShader(shaderProgram, shaders[i]);
+		}
 		//Link all the stages together
 		glLinkProgram(shaderProgram);
 		int success;
@@ -74,10 +69,45 @@ namespace ew {
 			printf("Failed to link shader program: %s", infoLog);
 		}
 		//The linked program now contains our compiled code, so we can delete these intermediate objects
-		glDeleteShader(vertexShader);
-		glDeleteShader(fragmentShader);
+		for (int i = 0; i < numShaders; i++) {
+			glDeleteShader(shaders[i]);
+		}
 		return shaderProgram;
 	}
+
+	/// <summary>
+	/// Creates a shader program with a vertex and fragment shader
+	/// </summary>
+	/// <param name="vertexShaderSource">GLSL source code for the vertex shader</param>
+	/// <param name="fragmentShaderSource">GLSL source code for the fragment shader</param>
+	/// <returns></returns>
+	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource) {
+		return createShaderProgram(std::string_view(vertexShaderSource), std::string_view(fragmentShaderSource));
+	}
+
+	/// <summary>
+	/// Creates a shader program with a vertex and fragment shader
+	/// </summary>
+	/// <param name="vertexShaderSource">GLSL source code for the vertex shader</param>
+	/// <param name="fragmentShaderSource">GLSL source code for the fragment shader</param>
+	/// <returns></returns>
+	unsigned int createShaderProgram(std::string_view vertexShaderSource, std::string_view fragmentShaderSource) {
+		unsigned int shaders[2] = {
+			createShader(GL_VERTEX_SHADER, vertexShaderSource),
+			createShader(GL_FRAGMENT_SHADER, fragmentShaderSource)
+		};
+		return linkShaderProgram(shaders, 2);
+	}
+
+	/// <summary>
+	/// Creates a shader program with a single compute stage
+	/// </summary>
+	/// <param name="computeShaderSource">GLSL source code for the compute shader</param>
+	/// <returns></returns>
+	unsigned int createComputeShaderProgram(std::string_view computeShaderSource) {
+		unsigned int computeShader = createShader(GL_COMPUTE_SHADER, computeShaderSource);
+		return linkShaderProgram(&computeShader, 1);
+	}
 	/// <summary>
 	/// Creates a shader instance with vertex + fragment stages
 	/// </summary>
@@ -85,49 +115,89 @@ namespace ew {
 	/// <param name="fragmentShader">File path to fragment shader</param>
 	Shader::Shader(const std::string& vertexShader, const std::string& fragmentShader)
 	{
-		std::string vertexShaderSource = ew::loadShaderSourceFromFile(vertexShader.c_str());
-		std::string fragmentShaderSource = ew::loadShaderSourceFromFile(fragmentShader.c_str());
-		m_id = ew::createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str());
+		//Source is handed to GL straight from the mapped files, without copying
+		ew::MappedFile vertexFile(vertexShader);
+		ew::MappedFile fragmentFile(fragmentShader);
+		if (!vertexFile.isOpen()) {
+			printf("Failed to load file %s", vertexShader.c_str());
+		}
+		if (!fragmentFile.isOpen()) {
+			printf("Failed to load file %s", fragmentShader.c_str());
+		}
+		m_id = ew::createShaderProgram(vertexFile.view(), fragmentFile.view());
+	}
+	/// <summary>
+	/// Creates a shader instance with vertex + fragment stages stored in an asset archive
+	/// </summary>
+	/// <param name="archive">Archive containing both stages</param>
+	/// <param name="vertexShader">Archive entry name of vertex shader</param>
+	/// <param name="fragmentShader">Archive entry name of fragment shader</param>
+	Shader::Shader(const AssetArchive& archive, const std::string& vertexShader, const std::string& fragmentShader)
+	{
+		std::string_view vertexShaderSource, fragmentShaderSource;
+		if (!archive.find(vertexShader, &vertexShaderSource)) {
+			printf("Failed to find %s in archive", vertexShader.c_str());
+		}
+		if (!archive.find(fragmentShader, &fragmentShaderSource)) {
+			printf("Failed to find %s in archive", fragmentShader.c_str());
+		}
+		m_id = ew::createShaderProgram(vertexShaderSource, fragmentShaderSource);
+	}
+	/// <summary>
+	/// Creates a shader instance with a single compute stage
+	/// </summary>
+	/// <param name="computeShader">File path to compute shader</param>
+	Shader::Shader(const std::string& computeShader)
+	{
+		ew::MappedFile computeFile(computeShader);
+		if (!computeFile.isOpen()) {
+			printf("Failed to load file %s", computeShader.c_str());
+		}
+		m_id = ew::createComputeShaderProgram(computeFile.view());
 	}
 	void Shader::use()const
 	{
 		glUseProgram(m_id);
 	}
-	void Shader::setInt(const std::string& name, int v) const
+	void Shader::dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ) const
+	{
+		glDispatchCompute(groupsX, groupsY, groupsZ);
+	}
+	void Shader::setInt(const char* name, int v) const
 	{
-		glUniform1i(glGetUniformLocation(m_id, name.c_str()), v);
+		glUniform1i(glGetUniformLocation(m_id, name), v);
 	}
-	void Shader::setFloat(const std::string& name, float v) const
+	void Shader::setFloat(const char* name, float v) const
 	{
-		glUniform1f(glGetUniformLocation(m_id, name.c_str()), v);
+		glUniform1f(glGetUniformLocation(m_id, name), v);
 	}
-	void Shader::setVec2(const std::string& name, float x, float y) const
+	void Shader::setVec2(const char* name, float x, float y) const
 	{
-		glUniform2f(glGetUniformLocation(m_id, name.c_str()), x, y);
+		glUniform2f(glGetUniformLocation(m_id, name), x, y);
 	}
-	void Shader::setVec2(const std::string& name, const glm::vec2& v) const
+	void Shader::setVec2(const char* name, const glm::vec2& v) const
 	{
 		setVec2(name, v.x, v.y);
 	}
-	void Shader::setVec3(const std::string& name, float x, float y, float z) const
+	void Shader::setVec3(const char* name, float x, float y, float z) const
 	{
-		glUniform3f(glGetUniformLocation(m_id, name.c_str()), x, y, z);
+		glUniform3f(glGetUniformLocation(m_id, name), x, y, z);
 	}
-	void Shader::setVec3(const std::string& name, const glm::vec3& v) const
+	void Shader::setVec3(const char* name, const glm::vec3& v) const
 	{
 		setVec3(name, v.x, v.y, v.z);
 	}
-	void Shader::setVec4(const std::string& name, float x, float y, float z, float w) const
+	void Shader::setVec4(const char* name, float x, float y, float z, float w) const
 	{
-		glUniform4f(glGetUniformLocation(m_id, name.c_str()), x, y, z, w);
+		glUniform4f(glGetUniformLocation(m_id, name), x, y, z, w);
 	}
-	void Shader::setVec4(const std::string& name, const glm::vec4& v) const
+	void Shader::setVec4(const char* name, const glm::vec4& v) const
 	{
 		setVec4(name, v.x, v.y, v.z, v.w);
 	}
-	void Shader::setMat4(const std::string& name, const glm::mat4& m) const
+	void Shader::setMat4(const char* name, const glm::mat4& m) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, glm::value_ptr(m));
+		glUniformMatrix4fv(glGetUniformLocation(m_id, name), 1, GL_FALSE, glm::value_ptr(m));
 	}
 }
 
@@ -4,24 +4,44 @@
 
 #pragma once
 #include <string>
+#include <string_view>
 #include <glm/glm.hpp>
 
 namespace ew {
 	std::string loadShaderSourceFromFile(const std::string& filePath);
 	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource);
+	unsigned int createShaderProgram(std::string_view vertexShaderSource, std::string_view fragmentShaderSource);
+	unsigned int createComputeShaderProgram(std::string_view computeShaderSource);
+	class AssetArchive;
 	class Shader {
 	public:
 		Shader(const std::string& vertexShader, const std::string& fragmentShader);
+		Shader(const AssetArchive& archive, const std::string& vertexShader, const std::string& fragmentShader);
+		//Compute shader
+		explicit Shader(const std::string& computeShader);
 		void use()const;
-		void setInt(const std::string& name, int v) const;
-		void setFloat(const std::string& name, float v) const;
-		void setVec2(const std::string& name, float x, float y) const;
-		void setVec2(const std::string& name, const glm::vec2& v) const;
-		void setVec3(const std::string& name, float x, float y, float z) const;
-		void setVec3(const std::string& name, const glm::vec3& v) const;
-		void setVec4(const std::string& name, float x, float y, float z, float w) const;
-		void setVec4(const std::string& name, const glm::vec4& v) const;
-		void setMat4(const std::string& name, const glm::mat4& m) const;
+		//Runs this compute shader over a grid of work groups. Call use() first.
+		void dispatch(unsigned int groupsX, unsigned int groupsY = 1, unsigned int groupsZ = 1)const;
+		//Names are C strings so passing a literal doesn't build a std::string on every call
+		void setInt(const char* name, int v) const;
+		void setFloat(const char* name, float v) const;
+		void setVec2(const char* name, float x, float y) const;
+		void setVec2(const char* name, const glm::vec2& v) const;
+		void setVec3(const char* name, float x, float y, float z) const;
+		void setVec3(const char* name, const glm::vec3& v) const;
+		void setVec4(const char* name, float x, float y, float z, float w) const;
+		void setVec4(const char* name, const glm::vec4& v) const;
+		void setMat4(const char* name, const glm::mat4& m) const;
+		//std::string overloads for names built at runtime, e.g. "_Lights[" + std::to_string(i) + "]"
+		inline void setInt(const std::string& name, int v) const { setInt(name.c_str(), v); }
+		inline void setFloat(const std::string& name, float v) const { setFloat(name.c_str(), v); }
+		inline void setVec2(const std::string& name, float x, float y) const { setVec2(name.c_str(), x, y); }
+		inline void setVec2(const std::string& name, const glm::vec2& v) const { setVec2(name.c_str(), v); }
+		inline void setVec3(const std::string& name, float x, float y, float z) const { setVec3(name.c_str(), x, y, z); }
+		inline void setVec3(const std::string& name, const glm::vec3& v) const { setVec3(name.c_str(), v); }
+		inline void setVec4(const std::string& name, float x, float y, float z, float w) const { setVec4(name.c_str(), x, y, z, w); }
+		inline void setVec4(const std::string& name, const glm::vec4& v) const { setVec4(name.c_str(), v); }
+		inline void setMat4(const std::string& name, const glm::mat4& m) const { setMat4(name.c_str(), m); }
 	private:
 		unsigned int m_id; //Shader program handle
 	};
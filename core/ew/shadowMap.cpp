@@ -0,0 +1,197 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include "shadowMap.h"
+#include "external/glad.h"
+#include <algorithm>
+#include <math.h>
+
+namespace ew {
+	/// <summary>
+	/// Creates the depth texture array and framebuffer
+	/// </summary>
+	/// <param name="resolution">Width and height of each cascade</param>
+	/// <param name="numCascades">1 to MAX_CASCADES</param>
+	CascadedShadowMap::CascadedShadowMap(int resolution, int numCascades)
+		: m_resolution(resolution), m_numCascades(glm::clamp(numCascades, 1, MAX_CASCADES))
+	{
+		glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &m_texture);
+		glTextureStorage3D(m_texture, 1, GL_DEPTH_COMPONENT32F, m_resolution, m_resolution, m_numCascades);
+		//Hardware depth comparison gives 2x2 PCF for free with linear filtering
+		glTextureParameteri(m_texture, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTextureParameteri(m_texture, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		glTextureParameteri(m_texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(m_texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(m_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTextureParameteri(m_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		//Outside the map counts as lit
+		float borderColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		glTextureParameterfv(m_texture, GL_TEXTURE_BORDER_COLOR, borderColor);
+
+		glCreateFramebuffers(1, &m_fbo);
+		glNamedFramebufferDrawBuffer(m_fbo, GL_NONE);
+		glNamedFramebufferReadBuffer(m_fbo, GL_NONE);
+
+		glCreateQueries(GL_TIMESTAMP, m_numCascades, m_beginQueries);
+		glCreateQueries(GL_TIMESTAMP, m_numCascades, m_endQueries);
+		for (int i = 0; i < MAX_CASCADES; i++)
+		{
+			m_fitted[i] = glm::mat4(1.0f);
+		}
+	}
+
+	CascadedShadowMap::~CascadedShadowMap()
+	{
+		glDeleteQueries(m_numCascades, m_beginQueries);
+		glDeleteQueries(m_numCascades, m_endQueries);
+		glDeleteFramebuffers(1, &m_fbo);
+		glDeleteTextures(1, &m_texture);
+	}
+
+	void CascadedShadowMap::invalidate()
+	{
+		m_invalidated = true;
+	}
+
+	/// <summary>
+	/// Computes split distances and light matrices, then flags cascades that must be re-rendered
+	/// </summary>
+	/// <param name="camera">Camera the cascades cover</param>
+	/// <param name="lightDirection">Direction the light travels</param>
+	/// <param name="movedCasters">World space bounds of casters that moved since last frame</param>
+	/// <param name="numMovedCasters">Number of bounds in movedCasters</param>
+	void CascadedShadowMap::update(const Camera& camera, const glm::vec3& lightDirection, const AABB* movedCasters, size_t numMovedCasters)
+	{
+		//Collect timings from earlier frames without waiting on the GPU
+		for (int i = 0; i < m_numCascades; i++)
+		{
+			if (!m_queryPending[i]) {
+				continue;
+			}
+			GLint available = 0;
+			glGetQueryObjectiv(m_endQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available) {
+				GLuint64 beginNs = 0, endNs = 0;
+				glGetQueryObjectui64v(m_beginQueries[i], GL_QUERY_RESULT, &beginNs);
+				glGetQueryObjectui64v(m_endQueries[i], GL_QUERY_RESULT, &endNs);
+				m_cascades[i].gpuTimeMs = (endNs - beginNs) / 1000000.0f;
+				m_queryPending[i] = false;
+			}
+		}
+
+		//Practical split scheme: blend of logarithmic (even texel density) and uniform (even coverage) splits
+		float nearPlane = camera.nearPlane;
+		float farPlane = std::min(camera.farPlane, maxDistance);
+		for (int i = 0; i < m_numCascades; i++)
+		{
+			float t = (float)(i + 1) / m_numCascades;
+			float logSplit = nearPlane * powf(farPlane / nearPlane, t);
+			float uniformSplit = nearPlane + (farPlane - nearPlane) * t;
+			m_cascades[i].splitNear = i == 0 ? nearPlane : m_cascades[i - 1].splitFar;
+			m_cascades[i].splitFar = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+		}
+
+		glm::vec3 lightDir = glm::normalize(lightDirection);
+		glm::vec3 up = glm::vec3(0, 1, 0);
+		//If light is aligned with up vector, choose a new one
+		if (glm::abs(glm::dot(lightDir, up)) >= 1.0f - glm::epsilon<float>()) {
+			up = glm::vec3(0, 0, 1);
+		}
+		//Fixed at the origin, so only the projection moves with the camera and snapping stays exact
+		glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDir, up);
+
+		for (int i = 0; i < m_numCascades; i++)
+		{
+			ShadowCascade& cascade = m_cascades[i];
+			fitCascade(i, camera, lightView, &m_fitted[i]);
+			cascade.framesSinceRender++;
+			//Casters are tested against what the map holds now. If the fit moved, the cascade re-renders anyway.
+			if (!cascade.stale) {
+				Frustum lightFrustum(cascade.lightViewProjection);
+				for (size_t j = 0; j < numMovedCasters && !cascade.stale; j++)
+				{
+					cascade.stale = lightFrustum.intersectsAABB(movedCasters[j]);
+				}
+			}
+			bool dirty = m_invalidated || cascade.stale || m_fitted[i] != cascade.lightViewProjection;
+			int interval = i < 2 ? 1 : std::max(farCascadeInterval, 1);
+			cascade.needsRender = dirty && (m_invalidated || cascade.framesSinceRender >= interval);
+			if (cascade.needsRender) {
+				cascade.lightViewProjection = m_fitted[i];
+				cascade.framesSinceRender = 0;
+				cascade.stale = false;
+			}
+		}
+		m_invalidated = false;
+	}
+
+	/// <summary>
+	/// Fits an orthographic light projection around a bounding sphere of one frustum slice.
+	/// A sphere's size doesn't change as the camera turns, and its center is snapped to whole texels,
+	/// so the matrix only changes in texel sized steps.
+	/// </summary>
+	void CascadedShadowMap::fitCascade(int cascade, const Camera& camera, const glm::mat4& lightView, glm::mat4* lightViewProjection) const
+	{
+		const ShadowCascade& c = m_cascades[cascade];
+		glm::mat4 invView = glm::inverse(camera.viewMatrix());
+		glm::vec3 corners[8];
+		float distances[2] = { c.splitNear, c.splitFar };
+		for (int i = 0; i < 2; i++)
+		{
+			float halfHeight = camera.orthographic ? camera.orthoHeight * 0.5f : distances[i] * tanf(glm::radians(camera.fov) * 0.5f);
+			float halfWidth = halfHeight * camera.aspectRatio;
+			for (int j = 0; j < 4; j++)
+			{
+				glm::vec4 viewCorner = glm::vec4((j & 1) ? halfWidth : -halfWidth, (j & 2) ? halfHeight : -halfHeight, -distances[i], 1.0f);
+				corners[i * 4 + j] = glm::vec3(invView * viewCorner);
+			}
+		}
+		glm::vec3 center = glm::vec3(0.0f);
+		for (int i = 0; i < 8; i++)
+		{
+			center += corners[i];
+		}
+		center /= 8.0f;
+		float radius = 0.0f;
+		for (int i = 0; i < 8; i++)
+		{
+			radius = std::max(radius, glm::length(corners[i] - center));
+		}
+		//Round up so floating point noise doesn't change the size frame to frame
+		radius = ceilf(radius * 16.0f) / 16.0f;
+
+		glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+		float texelSize = radius * 2.0f / m_resolution;
+		lightCenter.x = floorf(lightCenter.x / texelSize) * texelSize;
+		lightCenter.y = floorf(lightCenter.y / texelSize) * texelSize;
+		glm::mat4 projection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius, lightCenter.y - radius, lightCenter.y + radius,
+			-lightCenter.z - radius - casterDistance, -lightCenter.z + radius);
+		*lightViewProjection = projection * lightView;
+	}
+
+	void CascadedShadowMap::beginCascade(int cascade)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+		glNamedFramebufferTextureLayer(m_fbo, GL_DEPTH_ATTACHMENT, m_texture, 0, cascade);
+		glViewport(0, 0, m_resolution, m_resolution);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		//Slope scaled bias against shadow acne
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(2.0f, 4.0f);
+		//A query still waiting on its result can't be reused, so that frame just isn't timed
+		if (!m_queryPending[cascade]) {
+			glQueryCounter(m_beginQueries[cascade], GL_TIMESTAMP);
+		}
+	}
+
+	void CascadedShadowMap::endCascade(int cascade)
+	{
+		if (!m_queryPending[cascade]) {
+			glQueryCounter(m_endQueries[cascade], GL_TIMESTAMP);
+			m_queryPending[cascade] = true;
+		}
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+}
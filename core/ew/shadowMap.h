@@ -0,0 +1,68 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include "bounds.h"
+#include "camera.h"
+#include <glm/glm.hpp>
+
+namespace ew {
+	struct ShadowCascade {
+		float splitNear = 0.0f; //View space distance where this cascade starts
+		float splitFar = 0.0f; //View space distance where this cascade ends
+		glm::mat4 lightViewProjection = glm::mat4(1.0f); //Matrix the shadow map was last rendered with. Use this for sampling.
+		bool needsRender = false; //Set by update()
+		bool stale = false; //Casters moved inside this cascade since it was rendered, but it hasn't been due for a refresh yet
+		int framesSinceRender = 0;
+		float gpuTimeMs = 0.0f; //Last measured cost of rendering this cascade
+	};
+
+	/// <summary>
+	/// Cascaded shadow maps for a directional light, stored as layers of one depth texture array.
+	/// Cascades are fitted to slices of the camera frustum and snapped to whole texels so they don't shimmer.
+	/// A cascade is only re-rendered when its matrix changes or a caster moves inside it, and far cascades refresh less often.
+	/// </summary>
+	class CascadedShadowMap {
+	public:
+		static const int MAX_CASCADES = 4;
+
+		CascadedShadowMap(int resolution = 2048, int numCascades = 4);
+		~CascadedShadowMap();
+		CascadedShadowMap(const CascadedShadowMap&) = delete;
+		CascadedShadowMap& operator=(const CascadedShadowMap&) = delete;
+
+		//Fits cascades to the camera and decides which ones need rendering this frame.
+		//movedCasters are world space bounds of casters that changed since last frame, covering both where they were and where they are.
+		//Only cascades whose light frustum touches one of them re-render.
+		void update(const Camera& camera, const glm::vec3& lightDirection, const AABB* movedCasters = nullptr, size_t numMovedCasters = 0);
+		//Binds a cascade's layer for depth rendering and starts timing it
+		void beginCascade(int cascade);
+		void endCascade(int cascade);
+		//Forces every cascade to re-render next update
+		void invalidate();
+
+		inline int getNumCascades()const { return m_numCascades; }
+		inline int getResolution()const { return m_resolution; }
+		inline const ShadowCascade& getCascade(int i)const { return m_cascades[i]; }
+		inline unsigned int getTexture()const { return m_texture; }
+
+		float splitLambda = 0.75f; //Practical split scheme blend. 0 = uniform, 1 = logarithmic
+		float maxDistance = 50.0f; //Shadows end here, or at the camera far plane if closer
+		float casterDistance = 50.0f; //How far towards the light casters outside the view are still captured
+		int farCascadeInterval = 4; //Cascades past the first two refresh at most once per this many frames
+	private:
+		void fitCascade(int cascade, const Camera& camera, const glm::mat4& lightView, glm::mat4* lightViewProjection)const;
+		int m_resolution;
+		int m_numCascades;
+		unsigned int m_texture = 0;
+		unsigned int m_fbo = 0;
+		//Begin and end timestamps per cascade
+		unsigned int m_beginQueries[MAX_CASCADES] = {};
+		unsigned int m_endQueries[MAX_CASCADES] = {};
+		bool m_queryPending[MAX_CASCADES] = {};
+		bool m_invalidated = true;
+		ShadowCascade m_cascades[MAX_CASCADES];
+		glm::mat4 m_fitted[MAX_CASCADES]; //Current best fit, which cached cascades may lag behind
+	};
+}
@@ -3,6 +3,9 @@
 */
 
 #include "texture.h"
+#include "file.h"
+#include "metrics.h"
+#include <stdio.h>
 #include "external/glad.h"
 #include "external/stb_image.h"
 
@@ -23,13 +26,31 @@ namespace ew {
 		return loadTexture(filePath, GL_REPEAT, GL_LINEAR, GL_LINEAR_MIPMAP_LINEAR, true);
 	}
 	unsigned int loadTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool mipmap) {
+		//Decode straight out of the mapped file instead of going through stdio
+		ew::MappedFile file(filePath);
+		if (!file.isOpen()) {
+			printf("Failed to load image %s", filePath);
+			return 0;
+		}
+		unsigned int texture = loadTextureFromMemory(file.data(), file.size(), wrapMode, magFilter, minFilter, mipmap);
+		if (texture == 0) {
+			printf("Failed to load image %s", filePath);
+		}
+		return texture;
+	}
+	unsigned int loadTextureFromMemory(const void* data, size_t size) {
+		return loadTextureFromMemory(data, size, GL_REPEAT, GL_LINEAR, GL_LINEAR_MIPMAP_LINEAR, true);
+	}
+	unsigned int loadTextureFromMemory(const void* encodedData, size_t size, int wrapMode, int magFilter, int minFilter, bool mipmap) {
+		static Histogram* loadTime = getMetrics().getHistogram("ew_texture_load_microseconds", "Texture decode and upload time");
+		static Gauge* textureBytes = getMetrics().getGauge("ew_texture_bytes", "Estimated GPU memory used by loaded textures");
+		static Counter* texturesLoaded = getMetrics().getCounter("ew_textures_loaded_total", "Textures loaded");
+		ScopedTimer timer(loadTime);
 		stbi_set_flip_vertically_on_load(true);
 
 		int width, height, numComponents;
-		unsigned char* data = stbi_load(filePath, &width, &height, &numComponents, 0);
+		unsigned char* data = stbi_load_from_memory((const stbi_uc*)encodedData, (int)size, &width, &height, &numComponents, 0);
 		if (data == NULL) {
-			printf("Failed to load image %s", filePath);
-			stbi_image_free(data);
 			return 0;
 		}
 		unsigned int texture;
@@ -52,6 +73,10 @@ namespace ew {
 
 		glBindTexture(GL_TEXTURE_2D, 0);
 		stbi_image_free(data);
+		//8 bits per channel, plus a third more for the mip chain
+		int64_t bytes = (int64_t)width * height * numComponents;
+		textureBytes->add(mipmap ? bytes * 4 / 3 : bytes);
+		texturesLoaded->add();
 		return texture;
 	}
 }
@@ -3,8 +3,12 @@
 */
 
 #pragma once
+#include <stddef.h>
 
 namespace ew {
 	unsigned int loadTexture(const char* filePath);
 	unsigned int loadTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool mipmap);
+	//Decodes an encoded image (png, jpg, etc.) that is already in memory, such as an AssetArchive entry
+	unsigned int loadTextureFromMemory(const void* data, size_t size);
+	unsigned int loadTextureFromMemory(const void* data, size_t size, int wrapMode, int magFilter, int minFilter, bool mipmap);
 }
@@ -0,0 +1,79 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include "vertexLayout.h"
+#include "external/glad.h"
+#include <vector>
+
+namespace ew {
+	static GLenum getGLType(AttributeType type) {
+		switch (type) {
+		case AttributeType::HALF_FLOAT: return GL_HALF_FLOAT;
+		case AttributeType::INT8: return GL_BYTE;
+		case AttributeType::UINT8: return GL_UNSIGNED_BYTE;
+		case AttributeType::INT16: return GL_SHORT;
+		case AttributeType::UINT16: return GL_UNSIGNED_SHORT;
+		case AttributeType::INT32: return GL_INT;
+		case AttributeType::UINT32: return GL_UNSIGNED_INT;
+		case AttributeType::INT_2_10_10_10: return GL_INT_2_10_10_10_REV;
+		default: return GL_FLOAT;
+		}
+	}
+
+	static bool sameAttributes(const std::vector<VertexAttribute>& a, const VertexLayout& b) {
+		if (a.size() != b.numAttributes) {
+			return false;
+		}
+		for (unsigned int i = 0; i < b.numAttributes; i++)
+		{
+			const VertexAttribute& x = a[i];
+			const VertexAttribute& y = b.attributes[i];
+			if (x.location != y.location || x.numComponents != y.numComponents || x.type != y.type || x.mode != y.mode || x.offset != y.offset) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	struct SharedVertexArray {
+		std::vector<VertexAttribute> attributes; //Copied, so layouts built at runtime can go away
+		unsigned int vao;
+	};
+
+	//Only touched from the GL thread
+	static std::vector<SharedVertexArray> sharedVertexArrays;
+
+	unsigned int getSharedVertexArray(const VertexLayout& layout)
+	{
+		for (const SharedVertexArray& shared : sharedVertexArrays)
+		{
+			if (sameAttributes(shared.attributes, layout)) {
+				return shared.vao;
+			}
+		}
+		SharedVertexArray shared;
+		shared.attributes.assign(layout.attributes, layout.attributes + layout.numAttributes);
+		glCreateVertexArrays(1, &shared.vao);
+		for (const VertexAttribute& attribute : shared.attributes)
+		{
+			GLenum type = getGLType(attribute.type);
+			if (attribute.mode == AttributeMode::INTEGER) {
+				glVertexArrayAttribIFormat(shared.vao, attribute.location, attribute.numComponents, type, attribute.offset);
+			}
+			else {
+				GLboolean normalized = attribute.mode == AttributeMode::NORMALIZED ? GL_TRUE : GL_FALSE;
+				glVertexArrayAttribFormat(shared.vao, attribute.location, attribute.numComponents, type, normalized, attribute.offset);
+			}
+			glVertexArrayAttribBinding(shared.vao, attribute.location, 0);
+			glEnableVertexArrayAttrib(shared.vao, attribute.location);
+		}
+		sharedVertexArrays.push_back(shared);
+		return shared.vao;
+	}
+
+	size_t getNumSharedVertexArrays()
+	{
+		return sharedVertexArrays.size();
+	}
+}
@@ -0,0 +1,165 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <iterator>
+#include <stddef.h>
+#include <type_traits>
+
+namespace ew {
+	enum class AttributeType {
+		FLOAT = 0,
+		HALF_FLOAT = 1,
+		INT8 = 2,
+		UINT8 = 3,
+		INT16 = 4,
+		UINT16 = 5,
+		INT32 = 6,
+		UINT32 = 7,
+		INT_2_10_10_10 = 8 //4 components packed into 32 bits
+	};
+
+	//What the vertex shader sees
+	enum class AttributeMode {
+		FLOAT = 0, //Converted to float as is
+		NORMALIZED = 1, //Integers mapped to [0,1], or [-1,1] if signed
+		INTEGER = 2 //Read as int or uint, with glVertexArrayAttribIFormat
+	};
+
+	struct VertexAttribute {
+		unsigned int location;
+		unsigned int numComponents;
+		AttributeType type;
+		AttributeMode mode;
+		unsigned int offset; //Bytes from the start of the vertex
+	};
+
+	/// <summary>
+	/// How a C++ member type maps onto a vertex attribute. Members without a specialization don't compile.
+	/// Small integer vectors default to normalized, since they are usually compressed colors, normals or UVs.
+	/// Use makeAttribute with an explicit type and mode for anything else, like integer joint indices.
+	/// </summary>
+	template<typename T> struct AttributeTraits;
+
+	template<unsigned int N, AttributeType Type, AttributeMode Mode>
+	struct AttributeTraitsBase {
+		static constexpr unsigned int numComponents = N;
+		static constexpr AttributeType type = Type;
+		static constexpr AttributeMode mode = Mode;
+	};
+
+	template<> struct AttributeTraits<float> : AttributeTraitsBase<1, AttributeType::FLOAT, AttributeMode::FLOAT> {};
+	template<> struct AttributeTraits<glm::vec2> : AttributeTraitsBase<2, AttributeType::FLOAT, AttributeMode::FLOAT> {};
+	template<> struct AttributeTraits<glm::vec3> : AttributeTraitsBase<3, AttributeType::FLOAT, AttributeMode::FLOAT> {};
+	template<> struct AttributeTraits<glm::vec4> : AttributeTraitsBase<4, AttributeType::FLOAT, AttributeMode::FLOAT> {};
+	template<> struct AttributeTraits<glm::u8vec4> : AttributeTraitsBase<4, AttributeType::UINT8, AttributeMode::NORMALIZED> {};
+	template<> struct AttributeTraits<glm::i8vec4> : AttributeTraitsBase<4, AttributeType::INT8, AttributeMode::NORMALIZED> {};
+	template<> struct AttributeTraits<glm::u16vec2> : AttributeTraitsBase<2, AttributeType::UINT16, AttributeMode::NORMALIZED> {};
+	template<> struct AttributeTraits<glm::i16vec2> : AttributeTraitsBase<2, AttributeType::INT16, AttributeMode::NORMALIZED> {};
+	template<> struct AttributeTraits<glm::i16vec4> : AttributeTraitsBase<4, AttributeType::INT16, AttributeMode::NORMALIZED> {};
+	template<> struct AttributeTraits<glm::u16vec4> : AttributeTraitsBase<4, AttributeType::UINT16, AttributeMode::NORMALIZED> {};
+	template<> struct AttributeTraits<int> : AttributeTraitsBase<1, AttributeType::INT32, AttributeMode::INTEGER> {};
+	template<> struct AttributeTraits<unsigned int> : AttributeTraitsBase<1, AttributeType::UINT32, AttributeMode::INTEGER> {};
+	template<> struct AttributeTraits<glm::ivec4> : AttributeTraitsBase<4, AttributeType::INT32, AttributeMode::INTEGER> {};
+	template<> struct AttributeTraits<glm::uvec4> : AttributeTraitsBase<4, AttributeType::UINT32, AttributeMode::INTEGER> {};
+
+	constexpr unsigned int getAttributeTypeSize(AttributeType type) {
+		switch (type) {
+		case AttributeType::INT8: case AttributeType::UINT8:
+			return 1;
+		case AttributeType::HALF_FLOAT: case AttributeType::INT16: case AttributeType::UINT16:
+			return 2;
+		default:
+			return 4;
+		}
+	}
+
+	//Bytes the attribute takes up in the vertex
+	constexpr unsigned int getAttributeSize(const VertexAttribute& attribute) {
+		return attribute.type == AttributeType::INT_2_10_10_10 ? 4 : attribute.numComponents * getAttributeTypeSize(attribute.type);
+	}
+
+	template<typename T>
+	constexpr VertexAttribute makeAttribute(unsigned int location, size_t offset) {
+		return { location, AttributeTraits<T>::numComponents, AttributeTraits<T>::type, AttributeTraits<T>::mode, (unsigned int)offset };
+	}
+
+	constexpr VertexAttribute makeAttribute(unsigned int location, size_t offset, unsigned int numComponents, AttributeType type, AttributeMode mode) {
+		return { location, numComponents, type, mode, (unsigned int)offset };
+	}
+
+	//Attribute for a struct member, with its format picked from the member's type
+#define EW_VERTEX_ATTRIBUTE(location, Struct, member) ew::makeAttribute<decltype(Struct::member)>(location, offsetof(Struct, member))
+
+	/// <summary>
+	/// Describes a vertex struct to the GPU. Specialize for each vertex type with a constexpr attributes array:
+	///     template<> struct VertexFormat<MyVertex> {
+	///         static constexpr VertexAttribute attributes[] = { EW_VERTEX_ATTRIBUTE(0, MyVertex, pos), ... };
+	///     };
+	/// getVertexLayout checks the array at compile time, so a mismatched layout is a build error instead of garbage on screen.
+	/// </summary>
+	template<typename V> struct VertexFormat;
+
+	struct VertexLayout {
+		const VertexAttribute* attributes = nullptr;
+		unsigned int numAttributes = 0;
+		unsigned int stride = 0;
+	};
+
+	//GL guarantees at least 16 attribute locations
+	static const unsigned int MAX_VERTEX_ATTRIBUTES = 16;
+
+	/// <summary>
+	/// True if every attribute fits inside the vertex, is aligned to its component size,
+	/// has a format GL accepts, and no two attributes share a location or overlap each other's bytes.
+	/// </summary>
+	constexpr bool isValidVertexLayout(const VertexAttribute* attributes, size_t numAttributes, size_t stride) {
+		for (size_t i = 0; i < numAttributes; i++)
+		{
+			const VertexAttribute& a = attributes[i];
+			if (a.location >= MAX_VERTEX_ATTRIBUTES || a.numComponents < 1 || a.numComponents > 4) {
+				return false;
+			}
+			if (a.offset + getAttributeSize(a) > stride || a.offset % getAttributeTypeSize(a.type) != 0) {
+				return false;
+			}
+			if (a.mode == AttributeMode::INTEGER && (a.type == AttributeType::FLOAT || a.type == AttributeType::HALF_FLOAT)) {
+				return false;
+			}
+			if (a.type == AttributeType::INT_2_10_10_10 && (a.numComponents != 4 || a.mode == AttributeMode::INTEGER)) {
+				return false;
+			}
+			for (size_t j = 0; j < i; j++)
+			{
+				const VertexAttribute& b = attributes[j];
+				if (b.location == a.location) {
+					return false;
+				}
+				if (a.offset < b.offset + getAttributeSize(b) && b.offset < a.offset + getAttributeSize(a)) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	template<typename V>
+	constexpr VertexLayout getVertexLayout() {
+		static_assert(std::is_standard_layout<V>::value, "Vertex types need a standard layout for offsetof");
+		static_assert(isValidVertexLayout(VertexFormat<V>::attributes, std::size(VertexFormat<V>::attributes), sizeof(V)),
+			"Vertex attributes overlap each other or the end of the vertex, are misaligned, have an invalid format, or share a location");
+		return { VertexFormat<V>::attributes, (unsigned int)std::size(VertexFormat<V>::attributes), (unsigned int)sizeof(V) };
+	}
+
+	/// <summary>
+	/// Vertex array with the layout's attribute formats set, reading every attribute from buffer binding 0.
+	/// Layouts with the same attributes share one vertex array, so meshes switch buffers instead of vertex arrays.
+	/// Stride is set along with the vertex buffer, so it doesn't split layouts. Owned by the cache, lives as long as the GL context.
+	/// </summary>
+	unsigned int getSharedVertexArray(const VertexLayout& layout);
+	//Distinct layouts seen so far
+	size_t getNumSharedVertexArrays();
+}
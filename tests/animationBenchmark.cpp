@@ -0,0 +1,96 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/animation.h>
+#include <ew/jobSystem.h>
+#include <ew/memory.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "testAnimation.h"
+#include "testing.h"
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//Crowd of 1000 characters with a humanoid sized skeleton, every one blending two clips, timed single threaded and on the job system
+int main() {
+	const size_t NUM_CHARACTERS = 1000;
+	const size_t NUM_JOINTS = 64;
+	const int NUM_FRAMES = 30;
+	const float DELTA_TIME = 1.0f / 60.0f;
+	ew::Skeleton skeleton = makeChainSkeleton(NUM_JOINTS);
+	std::vector<ew::AnimationClip> clips = { makeSwayClip(NUM_JOINTS, 1.2f, 0.0f), makeSwayClip(NUM_JOINTS, 0.8f, 2.0f) };
+	ew::FrameArena frameArena(256 * 1024);
+	std::vector<glm::mat4> skinningMatrices(NUM_CHARACTERS * NUM_JOINTS);
+	std::vector<glm::mat4> reference(NUM_JOINTS);
+
+	auto makeStates = [&]() {
+		std::vector<ew::AnimationState> states(NUM_CHARACTERS);
+		for (size_t i = 0; i < NUM_CHARACTERS; i++)
+		{
+			states[i].clipA = 0;
+			states[i].timeA = 0.013f * i;
+			states[i].clipB = 1;
+			states[i].timeB = 0.007f * i;
+			states[i].blend = (float)(i % 10) / 9.0f;
+		}
+		return states;
+	};
+	//Times every frame after the first, which sizes the key cursors
+	auto run = [&](ew::JobSystem* jobSystem) {
+		std::vector<ew::AnimationState> states = makeStates();
+		double elapsed = 0.0;
+		for (int frame = 0; frame <= NUM_FRAMES; frame++)
+		{
+			frameArena.reset();
+			auto start = std::chrono::steady_clock::now();
+			ew::evaluateAnimations(skeleton, clips, states.data(), NUM_CHARACTERS, skinningMatrices.data(), jobSystem, &frameArena);
+			if (frame > 0) {
+				elapsed += seconds(start);
+			}
+			for (ew::AnimationState& state : states)
+			{
+				state.timeA += DELTA_TIME;
+				state.timeB += DELTA_TIME;
+			}
+		}
+		//Spot check the last frame against the reference
+		for (ew::AnimationState& state : states)
+		{
+			state.timeA -= DELTA_TIME;
+			state.timeB -= DELTA_TIME;
+		}
+		for (size_t i = 0; i < NUM_CHARACTERS; i += 97)
+		{
+			ew::evaluateAnimationReference(skeleton, clips, states[i], reference.data());
+			EW_CHECK(maxMatrixDifference(&skinningMatrices[i * NUM_JOINTS], reference.data(), NUM_JOINTS) < 1e-3f);
+		}
+		return elapsed / NUM_FRAMES;
+	};
+
+	//The reference path for scale: how long one frame of the crowd takes evaluated naively
+	std::vector<ew::AnimationState> states = makeStates();
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < NUM_CHARACTERS; i++)
+	{
+		ew::evaluateAnimationReference(skeleton, clips, states[i], &skinningMatrices[i * NUM_JOINTS]);
+	}
+	double referenceTime = seconds(start);
+	double baseline = run(nullptr);
+	printf("%zu characters, %zu joints, 2 clip blend\n", NUM_CHARACTERS, NUM_JOINTS);
+	printf("threads  ms/frame  us/character  speedup\n");
+	printf("%7s  %8.2f  %12.2f  %7.2f\n", "ref", referenceTime * 1000.0, referenceTime * 1e6 / NUM_CHARACTERS, baseline / referenceTime);
+	printf("%7d  %8.2f  %12.2f  %7.2f\n", 1, baseline * 1000.0, baseline * 1e6 / NUM_CHARACTERS, 1.0);
+	unsigned int numThreads = std::thread::hardware_concurrency();
+	if (numThreads < 2) {
+		numThreads = 2;
+	}
+	ew::JobSystem jobSystem(numThreads - 1);
+	double parallel = run(&jobSystem);
+	printf("%7u  %8.2f  %12.2f  %7.2f\n", numThreads, parallel * 1000.0, parallel * 1e6 / NUM_CHARACTERS, baseline / parallel);
+	EW_CHECK(frameArena.getNumOverflowAllocations() == 0);
+	return finishTest();
+}
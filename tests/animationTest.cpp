@@ -0,0 +1,165 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/external/glad.h>
+#include <ew/animation.h>
+#include <ew/jobSystem.h>
+#include <ew/memory.h>
+#include <ew/shader.h>
+#include <algorithm>
+#include <vector>
+#include "glTestContext.h"
+#include "testAnimation.h"
+#include "testing.h"
+
+static const float TOLERANCE = 1e-3f;
+
+//The fast path against the reference, for one instance, several instances on the job system, and blends
+static void testMatchesReference() {
+	const size_t NUM_JOINTS = 12;
+	const size_t NUM_STATES = 40;
+	ew::Skeleton skeleton = makeChainSkeleton(NUM_JOINTS);
+	std::vector<ew::AnimationClip> clips = { makeSwayClip(NUM_JOINTS, 2.0f, 0.0f), makeSwayClip(NUM_JOINTS, 1.3f, 1.0f) };
+	ew::JobSystem jobSystem(2);
+	ew::FrameArena frameArena(64 * 1024);
+	std::vector<ew::AnimationState> states(NUM_STATES);
+	std::vector<glm::mat4> fast(NUM_STATES * NUM_JOINTS);
+	std::vector<glm::mat4> reference(NUM_JOINTS);
+
+	//Small steps forward hit the cursor, the large jumps and the step back force a search
+	const float times[] = { 0.0f, 0.01f, 0.02f, 0.35f, 0.36f, 1.9f, 2.5f, 0.1f, -0.3f, 4.05f };
+	for (float time : times)
+	{
+		for (size_t i = 0; i < NUM_STATES; i++)
+		{
+			ew::AnimationState& state = states[i];
+			state.clipA = (int)(i % 2);
+			state.timeA = time + 0.05f * i;
+			state.clipB = i % 3 == 0 ? -1 : (int)((i + 1) % 2);
+			state.timeB = time * 0.7f;
+			state.blend = (float)(i % 4) / 3.0f;
+			state.loop = i % 5 != 0;
+		}
+		frameArena.reset();
+		ew::evaluateAnimations(skeleton, clips, states.data(), NUM_STATES, fast.data(), &jobSystem, &frameArena);
+		for (size_t i = 0; i < NUM_STATES; i++)
+		{
+			ew::evaluateAnimationReference(skeleton, clips, states[i], reference.data());
+			EW_CHECK(maxMatrixDifference(&fast[i * NUM_JOINTS], reference.data(), NUM_JOINTS) < TOLERANCE);
+		}
+
+		//Same answers without a job system
+		std::vector<glm::mat4> serial(NUM_STATES * NUM_JOINTS);
+		ew::evaluateAnimations(skeleton, clips, states.data(), NUM_STATES, serial.data());
+		EW_CHECK(maxMatrixDifference(serial.data(), fast.data(), serial.size()) < 1e-5f);
+	}
+	EW_CHECK(states[1].cursorsA.size() == NUM_JOINTS);
+	EW_CHECK(states[1].cursorsB.size() == NUM_JOINTS);
+	EW_CHECK(frameArena.getNumOverflowAllocations() == 0);
+}
+
+//Garbage cursors only cost a search, they never change the result
+static void testStaleCursors() {
+	const size_t NUM_JOINTS = 6;
+	ew::Skeleton skeleton = makeChainSkeleton(NUM_JOINTS);
+	ew::AnimationClip clip = makeSwayClip(NUM_JOINTS, 1.0f, 0.5f);
+	ew::Pose withCursors, withoutCursors;
+	std::vector<ew::KeyCursor> cursors(NUM_JOINTS);
+	for (ew::KeyCursor& cursor : cursors)
+	{
+		cursor.translation = 1000;
+		cursor.rotation = 3;
+		cursor.scale = 7;
+	}
+	for (int step = 0; step < 50; step++)
+	{
+		float time = step * 0.037f;
+		ew::samplePose(skeleton, clip, time, true, &withCursors, cursors.data());
+		ew::samplePose(skeleton, clip, time, true, &withoutCursors);
+		for (size_t i = 0; i < NUM_JOINTS; i++)
+		{
+			EW_CHECK(glm::length(withCursors.translations[i] - withoutCursors.translations[i]) < 1e-6f);
+			EW_CHECK(fabsf(glm::dot(withCursors.rotations[i], withoutCursors.rotations[i])) > 1.0f - 1e-6f);
+			EW_CHECK(glm::length(withCursors.scales[i] - withoutCursors.scales[i]) < 1e-6f);
+		}
+	}
+}
+
+//Runs skinning.comp over a bent chain and compares every vertex with skinVerticesReference
+static void testGpuSkinning() {
+	const size_t NUM_JOINTS = 8;
+	const size_t NUM_VERTICES = 1000; //Not a multiple of the work group size
+	ew::Skeleton skeleton = makeChainSkeleton(NUM_JOINTS);
+	std::vector<ew::AnimationClip> clips = { makeSwayClip(NUM_JOINTS, 1.0f, 0.0f) };
+	ew::AnimationState state;
+	state.timeA = 0.4f;
+	std::vector<glm::mat4> skinningMatrices(NUM_JOINTS);
+	ew::evaluateAnimations(skeleton, clips, &state, 1, skinningMatrices.data());
+
+	//Vertices spread up the chain, each weighted between the two nearest joints
+	std::vector<ew::Vertex> bindVertices(NUM_VERTICES);
+	ew::SkinWeights skin;
+	for (size_t i = 0; i < NUM_VERTICES; i++)
+	{
+		float height = (NUM_JOINTS - 1) * (float)i / NUM_VERTICES;
+		float angle = i * 0.37f;
+		ew::Vertex& v = bindVertices[i];
+		v.pos = glm::vec3(0.2f * cosf(angle), height, 0.2f * sinf(angle));
+		v.normal = glm::vec3(cosf(angle), 0.0f, sinf(angle));
+		v.uv = glm::vec2(angle, height);
+		v.tangent = glm::vec4(-sinf(angle), 0.0f, cosf(angle), i % 2 == 0 ? 1.0f : -1.0f);
+		unsigned int joint = (unsigned int)height;
+		float t = height - joint;
+		skin.joints.push_back(glm::uvec4(joint, std::min(joint + 1, (unsigned int)NUM_JOINTS - 1), 0, 0));
+		skin.weights.push_back(glm::vec4(1.0f - t, t, 0.0f, 0.0f));
+	}
+	std::vector<ew::Vertex> expected(NUM_VERTICES);
+	ew::skinVerticesReference(bindVertices.data(), skin, skinningMatrices.data(), NUM_VERTICES, expected.data());
+
+	unsigned int buffers[5];
+	glCreateBuffers(5, buffers);
+	glNamedBufferData(buffers[0], sizeof(ew::Vertex) * NUM_VERTICES, bindVertices.data(), GL_STATIC_DRAW);
+	glNamedBufferData(buffers[1], sizeof(ew::Vertex) * NUM_VERTICES, bindVertices.data(), GL_DYNAMIC_DRAW);
+	glNamedBufferData(buffers[2], sizeof(glm::uvec4) * NUM_VERTICES, skin.joints.data(), GL_STATIC_DRAW);
+	glNamedBufferData(buffers[3], sizeof(glm::vec4) * NUM_VERTICES, skin.weights.data(), GL_STATIC_DRAW);
+	glNamedBufferData(buffers[4], sizeof(glm::mat4) * NUM_JOINTS, skinningMatrices.data(), GL_STATIC_DRAW);
+	ew::Shader skinningShader(EW_TEST_ASSETS_DIR "shaders/skinning.comp");
+	skinningShader.use();
+	skinningShader.setInt("_VertexStride", sizeof(ew::Vertex) / sizeof(float));
+	skinningShader.setInt("_NumVertices", (int)NUM_VERTICES);
+	for (unsigned int i = 0; i < 5; i++)
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, buffers[i]);
+	}
+	skinningShader.dispatch((NUM_VERTICES + 63) / 64);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	std::vector<ew::Vertex> skinned(NUM_VERTICES);
+	glGetNamedBufferSubData(buffers[1], 0, sizeof(ew::Vertex) * NUM_VERTICES, skinned.data());
+	glDeleteBuffers(5, buffers);
+
+	float maxPosition = 0.0f, maxNormal = 0.0f, maxTangent = 0.0f;
+	bool untouchedMatch = true;
+	for (size_t i = 0; i < NUM_VERTICES; i++)
+	{
+		maxPosition = fmaxf(maxPosition, glm::length(skinned[i].pos - expected[i].pos));
+		maxNormal = fmaxf(maxNormal, glm::length(skinned[i].normal - expected[i].normal));
+		maxTangent = fmaxf(maxTangent, glm::length(glm::vec3(skinned[i].tangent) - glm::vec3(expected[i].tangent)));
+		untouchedMatch = untouchedMatch && skinned[i].uv == expected[i].uv && skinned[i].tangent.w == expected[i].tangent.w;
+	}
+	printf("GPU skinning max difference: position %g, normal %g, tangent %g\n", maxPosition, maxNormal, maxTangent);
+	EW_CHECK(maxPosition < TOLERANCE);
+	EW_CHECK(maxNormal < TOLERANCE);
+	EW_CHECK(maxTangent < TOLERANCE);
+	EW_CHECK(untouchedMatch);
+}
+
+int main() {
+	testMatchesReference();
+	testStaleCursors();
+	TestContext context;
+	if (context.isValid()) {
+		testGpuSkinning();
+	}
+	return finishTest();
+}
@@ -0,0 +1,94 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/file.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "testing.h"
+
+static bool writeFile(const std::string& path, const std::string& contents) {
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == NULL) {
+		return false;
+	}
+	bool ok = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+	fclose(file);
+	return ok;
+}
+
+static std::string readFile(const std::string& path) {
+	ew::MappedFile file(path);
+	return file.isOpen() ? std::string(file.view()) : std::string();
+}
+
+int main() {
+	//Includes an empty file and one that isn't a multiple of the data alignment
+	std::vector<std::string> paths = { "archiveTest_b.txt", "archiveTest_a.txt", "archiveTest_empty.txt" };
+	std::vector<std::string> contents = { std::string(1000, 'b') + "end", "first file", "" };
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		EW_CHECK(writeFile(paths[i], contents[i]));
+	}
+	EW_CHECK(ew::packAssetArchive("archiveTest.ewpk", paths));
+
+	ew::AssetArchive archive;
+	EW_CHECK(archive.open("archiveTest.ewpk"));
+	EW_CHECK(archive.getNumEntries() == 3);
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		std::string_view data;
+		EW_CHECK(archive.find(paths[i], &data));
+		EW_CHECK(data == contents[i]);
+	}
+	std::string_view missing;
+	EW_CHECK(!archive.find("archiveTest_missing.txt", &missing));
+	EW_CHECK(!archive.contains("archiveTest"));
+
+	//Malformed archives are rejected instead of handing out views past the end of the file.
+	//Layout: 16 byte header, then 24 byte entries of { dataOffset, dataSize, nameOffset, nameLength }.
+	std::string packed = readFile("archiveTest.ewpk");
+	EW_CHECK(packed.size() > 16 + 24 * 3);
+	const size_t HEADER_SIZE = 16;
+	{
+		//dataOffset + dataSize wraps around to a small number
+		std::string corrupt = packed;
+		uint64_t offset = UINT64_MAX - 7, size = 16;
+		memcpy(&corrupt[HEADER_SIZE], &offset, 8);
+		memcpy(&corrupt[HEADER_SIZE + 8], &size, 8);
+		EW_CHECK(writeFile("archiveTest_corrupt.ewpk", corrupt));
+		ew::AssetArchive corruptArchive;
+		EW_CHECK(!corruptArchive.open("archiveTest_corrupt.ewpk"));
+		EW_CHECK(corruptArchive.getNumEntries() == 0);
+	}
+	{
+		//Data runs one byte past the end
+		std::string corrupt = packed;
+		uint64_t offset, size;
+		memcpy(&offset, &corrupt[HEADER_SIZE], 8);
+		size = packed.size() - offset + 1;
+		memcpy(&corrupt[HEADER_SIZE + 8], &size, 8);
+		EW_CHECK(writeFile("archiveTest_corrupt.ewpk", corrupt));
+		ew::AssetArchive corruptArchive;
+		EW_CHECK(!corruptArchive.open("archiveTest_corrupt.ewpk"));
+	}
+	{
+		//Entry count so large the entry table can't fit
+		std::string corrupt = packed;
+		uint32_t numEntries = 0xFFFFFFFFu;
+		memcpy(&corrupt[8], &numEntries, 4);
+		EW_CHECK(writeFile("archiveTest_corrupt.ewpk", corrupt));
+		ew::AssetArchive corruptArchive;
+		EW_CHECK(!corruptArchive.open("archiveTest_corrupt.ewpk"));
+	}
+	{
+		std::string truncated = packed.substr(0, packed.size() - 2);
+		EW_CHECK(writeFile("archiveTest_corrupt.ewpk", truncated));
+		ew::AssetArchive corruptArchive;
+		EW_CHECK(!corruptArchive.open("archiveTest_corrupt.ewpk"));
+	}
+	return finishTest();
+}
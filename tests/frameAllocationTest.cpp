@@ -0,0 +1,188 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/external/glad.h>
+#include <ew/animation.h>
+#include <ew/jobSystem.h>
+#include <ew/memory.h>
+#include <ew/meshlet.h>
+#include <ew/metrics.h>
+#include <ew/occlusion.h>
+#include <ew/procGen.h>
+#include <ew/shader.h>
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+#include <vector>
+#include "testAnimation.h"
+#include "testing.h"
+
+//Every heap allocation in the process goes through these, not just pmr containers
+static std::atomic<size_t> numAllocations{ 0 };
+
+void* operator new(size_t size) {
+	numAllocations.fetch_add(1, std::memory_order_relaxed);
+	void* p = malloc(size > 0 ? size : 1);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+//Shaders only need uniform calls to go somewhere, so GL is faked instead of needing a context
+static GLuint fakeCreate() { return 1; }
+static GLuint fakeCreateShader(GLenum) { return 1; }
+static void fakeShaderSource(GLuint, GLsizei, const GLchar* const*, const GLint*) {}
+static void fakeObject(GLuint) {}
+static void fakeAttach(GLuint, GLuint) {}
+static void fakeGetiv(GLuint, GLenum, GLint* params) { *params = GL_TRUE; }
+static GLint fakeGetUniformLocation(GLuint, const GLchar*) { return 0; }
+static void fakeUniform1i(GLint, GLint) {}
+static void fakeUniform1f(GLint, GLfloat) {}
+static void fakeUniform3f(GLint, GLfloat, GLfloat, GLfloat) {}
+static void fakeUniformMatrix4fv(GLint, GLsizei, GLboolean, const GLfloat*) {}
+
+static void fakeGL() {
+	glad_glCreateShader = fakeCreateShader;
+	glad_glShaderSource = fakeShaderSource;
+	glad_glCompileShader = fakeObject;
+	glad_glGetShaderiv = fakeGetiv;
+	glad_glCreateProgram = fakeCreate;
+	glad_glAttachShader = fakeAttach;
+	glad_glLinkProgram = fakeObject;
+	glad_glGetProgramiv = fakeGetiv;
+	glad_glDeleteShader = fakeObject;
+	glad_glUseProgram = fakeObject;
+	glad_glGetUniformLocation = fakeGetUniformLocation;
+	glad_glUniform1i = fakeUniform1i;
+	glad_glUniform1f = fakeUniform1f;
+	glad_glUniform3f = fakeUniform3f;
+	glad_glUniformMatrix4fv = fakeUniformMatrix4fv;
+}
+
+struct SceneObject {
+	glm::mat4 modelMatrix;
+	ew::AABB bounds;
+};
+
+int main() {
+	fakeGL();
+	ew::CountingResource heapCounter;
+	ew::ScopedDefaultResource defaultResource(&heapCounter);
+	ew::FrameArena frameArena(64 * 1024);
+	ew::Pool<SceneObject> objectPool;
+	ew::JobSystem jobSystem(3);
+	ew::Shader shader(EW_TEST_ASSETS_DIR "shaders/depthOnly.vert", EW_TEST_ASSETS_DIR "shaders/depthOnly.frag");
+	ew::Histogram* frameTime = ew::getMetrics().getHistogram("test_frame_time_microseconds");
+	ew::Counter* frames = ew::getMetrics().getCounter("test_frames_total");
+
+	//CPU side of a frame, the same work the app does before and around its GL calls
+	ew::MeshData sphere = ew::createSphere(1.0f, 32);
+	ew::MeshletData meshlets = ew::buildMeshlets(sphere);
+	ew::AABB sphereBounds = { glm::vec3(-1.0f), glm::vec3(1.0f) };
+	ew::Camera camera;
+	glm::mat4 viewProjection = camera.projectionMatrix() * camera.viewMatrix();
+	ew::DepthRasterizer rasterizer(128, 64);
+	ew::HiZPyramid hiZ;
+	ew::MeshletDrawRanges culledRanges;
+	std::vector<float> values(10000);
+	std::vector<SceneObject*> objects;
+	objects.reserve(16);
+	ew::Skeleton skeleton = makeChainSkeleton(16);
+	std::vector<ew::AnimationClip> clips = { makeSwayClip(16, 1.0f, 0.0f), makeSwayClip(16, 0.5f, 1.0f) };
+	std::vector<ew::AnimationState> animations(32);
+	for (size_t i = 0; i < animations.size(); i++)
+	{
+		animations[i].clipB = 1;
+		animations[i].blend = 0.5f;
+	}
+	std::vector<glm::mat4> skinningMatrices(animations.size() * skeleton.getNumJoints());
+	size_t numVisible = 0;
+
+	auto runFrame = [&](int frame) {
+		frameArena.reset();
+		//Objects come and go through the pool
+		for (int i = 0; i < 16; i++)
+		{
+			objects.push_back(objectPool.create(SceneObject{ glm::translate(glm::mat4(1.0f), glm::vec3(i - 8.0f, 0.0f, -4.0f)), sphereBounds }));
+		}
+		std::pmr::vector<const SceneObject*> renderQueue(&frameArena);
+		renderQueue.reserve(objects.size());
+		for (const SceneObject* object : objects)
+		{
+			renderQueue.push_back(object);
+		}
+		rasterizer.clear();
+		rasterizer.drawMesh(sphere, viewProjection);
+		hiZ.build(rasterizer.getDepth(), rasterizer.getWidth(), rasterizer.getHeight(), viewProjection);
+		std::pmr::vector<const SceneObject*> visibleQueue(&frameArena);
+		visibleQueue.reserve(renderQueue.size());
+		for (const SceneObject* object : renderQueue)
+		{
+			if (!hiZ.isOccluded(object->bounds, object->modelMatrix)) {
+				visibleQueue.push_back(object);
+			}
+		}
+		numVisible = visibleQueue.size();
+		//Transient debug geometry, tangent generation scratch included, lives in the arena
+		ew::MeshData debugSphere = ew::createSphere(0.25f, 8, &frameArena);
+		ew::MeshData debugCube = ew::createCube(0.25f, &frameArena);
+		rasterizer.drawMesh(debugSphere, viewProjection);
+		rasterizer.drawMesh(debugCube, viewProjection);
+		jobSystem.parallelFor(values.size(), 256, [&values, frame](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+			{
+				values[i] = (float)(i * frame);
+			}
+		});
+		for (ew::AnimationState& animation : animations)
+		{
+			animation.timeA = frame * 0.016f;
+			animation.timeB = frame * 0.016f;
+		}
+		ew::evaluateAnimations(skeleton, clips, animations.data(), animations.size(), skinningMatrices.data(), &jobSystem, &frameArena);
+		shader.use();
+		shader.setMat4("_ViewProjection", viewProjection);
+		for (const SceneObject* object : visibleQueue)
+		{
+			shader.setMat4("_Model", object->modelMatrix);
+			ew::cullMeshlets(meshlets, object->modelMatrix, camera, &culledRanges);
+		}
+		shader.setFloat("_Material.Shininess", 128.0f);
+		shader.setVec3("_LightDirection", glm::vec3(0.0f, -1.0f, 0.0f));
+		for (SceneObject* object : objects)
+		{
+			objectPool.destroy(object);
+		}
+		objects.clear();
+		frameTime->record(16000);
+		frames->add();
+	};
+
+	//First frames grow the arena, pool, queues, pyramid and key cursors
+	for (int frame = 0; frame < 4; frame++)
+	{
+		runFrame(frame);
+	}
+	size_t allocationsBefore = numAllocations.load();
+	size_t pmrAllocationsBefore = heapCounter.getNumAllocations();
+	const int NUM_FRAMES = 100;
+	for (int frame = 0; frame < NUM_FRAMES; frame++)
+	{
+		runFrame(frame);
+	}
+	size_t allocations = numAllocations.load() - allocationsBefore;
+	size_t pmrAllocations = heapCounter.getNumAllocations() - pmrAllocationsBefore;
+	printf("%zu heap allocations (%zu through pmr) over %d steady state frames, %zu of 16 objects visible\n",
+		allocations, pmrAllocations, NUM_FRAMES, numVisible);
+	EW_CHECK(allocations == 0);
+	EW_CHECK(pmrAllocations == 0);
+	EW_CHECK(frameArena.getNumOverflowAllocations() == 0);
+	return finishTest();
+}
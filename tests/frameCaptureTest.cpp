@@ -0,0 +1,184 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/frameCapture.h>
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "testing.h"
+
+static bool writeFile(const std::string& path, const std::vector<unsigned char>& contents) {
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == NULL) {
+		return false;
+	}
+	bool ok = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+	fclose(file);
+	return ok;
+}
+
+static std::vector<unsigned char> readFile(const std::string& path) {
+	std::vector<unsigned char> contents;
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == NULL) {
+		return contents;
+	}
+	unsigned char buffer[4096];
+	size_t numRead;
+	while ((numRead = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		contents.insert(contents.end(), buffer, buffer + numRead);
+	}
+	fclose(file);
+	return contents;
+}
+
+/// <summary>
+/// A flythrough as the live loop would capture it: uneven frame times, the mouse released now and then,
+/// and a mix of held keys. Each frame stores the controller state after its input was applied.
+/// </summary>
+static std::vector<ew::CapturedFrame> captureFlythrough(size_t numFrames) {
+	ew::CameraController controller;
+	ew::Camera camera;
+	camera.position = glm::vec3(0.0f, 0.0f, 5.0f);
+	camera.target = glm::vec3(0.0f);
+	std::vector<ew::CapturedFrame> frames;
+	for (size_t i = 0; i < numFrames; i++)
+	{
+		ew::CapturedFrame frame;
+		frame.deltaTime = 1.0f / 60.0f + 0.004f * (float)(i % 7);
+		frame.input.active = i % 50 < 45;
+		frame.input.mouseDeltaX = (float)(i % 11) - 5.0f;
+		frame.input.mouseDeltaY = (float)(i % 5) - 2.0f;
+		frame.input.keys = (unsigned int)((i / 10) % 128);
+		controller.update(frame.input, &camera, frame.deltaTime);
+		frame.yaw = controller.yaw;
+		frame.pitch = controller.pitch;
+		frame.position = camera.position;
+		frame.target = camera.target;
+		frames.push_back(frame);
+	}
+	return frames;
+}
+
+static bool sameFrame(const ew::CapturedFrame& a, const ew::CapturedFrame& b) {
+	return a.deltaTime == b.deltaTime && a.input.active == b.input.active && a.input.mouseDeltaX == b.input.mouseDeltaX
+		&& a.input.mouseDeltaY == b.input.mouseDeltaY && a.input.keys == b.input.keys && a.yaw == b.yaw && a.pitch == b.pitch
+		&& a.position == b.position && a.target == b.target;
+}
+
+//Every field of every frame comes back exactly as written
+static void testRoundTrip(const std::vector<ew::CapturedFrame>& frames) {
+	ew::CaptureWriter writer;
+	EW_CHECK(writer.open("frameCaptureTest.ewcp"));
+	for (const ew::CapturedFrame& frame : frames)
+	{
+		writer.write(frame);
+	}
+	EW_CHECK(writer.getNumFrames() == frames.size());
+	writer.close();
+	EW_CHECK(!writer.isOpen());
+
+	std::vector<ew::CapturedFrame> loaded;
+	EW_CHECK(ew::loadCapture("frameCaptureTest.ewcp", &loaded));
+	EW_CHECK(loaded.size() == frames.size());
+	size_t numMismatches = 0;
+	for (size_t i = 0; i < std::min(loaded.size(), frames.size()); i++)
+	{
+		numMismatches += !sameFrame(loaded[i], frames[i]);
+	}
+	EW_CHECK(numMismatches == 0);
+
+	ew::CaptureWriter emptyWriter;
+	EW_CHECK(emptyWriter.open("frameCaptureTest_empty.ewcp"));
+	emptyWriter.close();
+	EW_CHECK(ew::loadCapture("frameCaptureTest_empty.ewcp", &loaded));
+	EW_CHECK(loaded.empty());
+}
+
+//Header: magic, version, numFrames, recordSize (4 bytes each), then one record per frame
+static void testInvalidLogs() {
+	const size_t HEADER_SIZE = 16;
+	std::vector<unsigned char> valid = readFile("frameCaptureTest.ewcp");
+	EW_CHECK(valid.size() > HEADER_SIZE);
+	std::vector<ew::CapturedFrame> loaded;
+	auto loads = [&](const std::vector<unsigned char>& contents) {
+		EW_CHECK(writeFile("frameCaptureTest_corrupt.ewcp", contents));
+		return ew::loadCapture("frameCaptureTest_corrupt.ewcp", &loaded);
+	};
+	EW_CHECK(loads(valid));
+
+	EW_CHECK(!loads(std::vector<unsigned char>(valid.begin(), valid.end() - 1)));
+	EW_CHECK(!loads(std::vector<unsigned char>(valid.begin(), valid.begin() + HEADER_SIZE - 1)));
+	EW_CHECK(loaded.empty());
+	EW_CHECK(!ew::loadCapture("frameCaptureTest_missing.ewcp", &loaded));
+	{
+		std::vector<unsigned char> corrupt = valid;
+		corrupt[0] = 'X';
+		EW_CHECK(!loads(corrupt));
+	}
+	{
+		std::vector<unsigned char> corrupt = valid;
+		uint32_t version = 99;
+		memcpy(&corrupt[4], &version, sizeof(version));
+		EW_CHECK(!loads(corrupt));
+	}
+	{
+		//More frames than the file holds
+		std::vector<unsigned char> corrupt = valid;
+		uint32_t numFrames = 0xFFFFFFFFu;
+		memcpy(&corrupt[8], &numFrames, sizeof(numFrames));
+		EW_CHECK(!loads(corrupt));
+	}
+	{
+		//A record layout this build doesn't know
+		std::vector<unsigned char> corrupt = valid;
+		uint32_t recordSize = 52;
+		memcpy(&corrupt[12], &recordSize, sizeof(recordSize));
+		EW_CHECK(!loads(corrupt));
+	}
+}
+
+//Replaying the recorded input from the same starting camera reproduces every captured state, and a jump is snapped to
+static void testReplay(const std::vector<ew::CapturedFrame>& frames) {
+	std::vector<ew::CapturedFrame> loaded;
+	EW_CHECK(ew::loadCapture("frameCaptureTest.ewcp", &loaded));
+	ew::CameraController controller;
+	ew::Camera camera;
+	camera.position = glm::vec3(0.0f, 0.0f, 5.0f);
+	camera.target = glm::vec3(0.0f);
+	size_t numDrifted = 0;
+	for (const ew::CapturedFrame& frame : loaded)
+	{
+		numDrifted += !ew::replayCapturedFrame(frame, &controller, &camera);
+	}
+	EW_CHECK(numDrifted == 0);
+	EW_CHECK(camera.position == frames.back().position);
+
+	//As if the camera was reset from the UI partway through the capture
+	loaded[10].position += glm::vec3(1.0f, 0.0f, 0.0f);
+	controller = ew::CameraController();
+	camera.position = glm::vec3(0.0f, 0.0f, 5.0f);
+	camera.target = glm::vec3(0.0f);
+	numDrifted = 0;
+	for (size_t i = 0; i < 12; i++)
+	{
+		numDrifted += !ew::replayCapturedFrame(loaded[i], &controller, &camera);
+		if (i == 10) {
+			EW_CHECK(camera.position == loaded[10].position);
+		}
+	}
+	//Frame 11 starts from the jumped position, so it disagrees too, then replay is back on the log
+	EW_CHECK(numDrifted == 2);
+}
+
+int main() {
+	std::vector<ew::CapturedFrame> frames = captureFlythrough(300);
+	testRoundTrip(frames);
+	testInvalidLogs();
+	testReplay(frames);
+	return finishTest();
+}
@@ -0,0 +1,48 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include <ew/external/glad.h>
+#include <GLFW/glfw3.h>
+#include <stdio.h>
+
+/// <summary>
+/// Hidden window with a GL 4.5 context, for tests that run on the GPU.
+/// isValid() is false if there is no display or driver, in which case the test should return TEST_SKIPPED.
+/// </summary>
+class TestContext {
+public:
+	TestContext() {
+		if (!glfwInit()) {
+			printf("No display, skipping GPU test\n");
+			return;
+		}
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		m_window = glfwCreateWindow(64, 64, "test", NULL, NULL);
+		if (m_window == NULL) {
+			printf("No GL 4.5 context, skipping GPU test\n");
+			return;
+		}
+		glfwMakeContextCurrent(m_window);
+		if (!gladLoadGL(glfwGetProcAddress)) {
+			printf("Failed to load GL, skipping GPU test\n");
+			glfwDestroyWindow(m_window);
+			m_window = nullptr;
+		}
+	}
+	~TestContext() {
+		if (m_window != nullptr) {
+			glfwDestroyWindow(m_window);
+		}
+		glfwTerminate();
+	}
+	TestContext(const TestContext&) = delete;
+	TestContext& operator=(const TestContext&) = delete;
+	inline bool isValid()const { return m_window != nullptr; }
+private:
+	GLFWwindow* m_window = nullptr;
+};
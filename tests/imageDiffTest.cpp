@@ -0,0 +1,142 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/external/glad.h>
+#include <ew/external/stb_image.h>
+#include <ew/imageWrite.h>
+#include <ew/readback.h>
+#include <ew/renderTarget.h>
+#include <string.h>
+#include <vector>
+#include "glTestContext.h"
+#include "testing.h"
+
+static std::vector<unsigned char> makeGradient(int width, int height) {
+	std::vector<unsigned char> rgba((size_t)width * height * 4);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			unsigned char* p = &rgba[((size_t)y * width + x) * 4];
+			p[0] = (unsigned char)(x * 255 / (width - 1));
+			p[1] = (unsigned char)(y * 255 / (height - 1));
+			p[2] = (unsigned char)((x * 7 + y * 13) & 0xFF);
+			p[3] = 255;
+		}
+	}
+	return rgba;
+}
+
+//Every pixel one color, except a rectangle of another
+static std::vector<unsigned char> makeRect(int width, int height, const unsigned char outside[4], const unsigned char inside[4], int x0, int y0, int x1, int y1) {
+	std::vector<unsigned char> rgba((size_t)width * height * 4);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			const unsigned char* color = x >= x0 && x < x1 && y >= y0 && y < y1 ? inside : outside;
+			for (int c = 0; c < 4; c++)
+			{
+				rgba[((size_t)y * width + x) * 4 + c] = color[c];
+			}
+		}
+	}
+	return rgba;
+}
+
+static void testDiff() {
+	const int W = 16, H = 8;
+	std::vector<unsigned char> a = makeGradient(W, H);
+	std::vector<unsigned char> b = a;
+	ew::ImageDiff same = ew::diffImages(a.data(), b.data(), W, H);
+	EW_CHECK(same.maxDifference == 0);
+	EW_CHECK(same.numDifferentPixels == 0);
+
+	b[(3 * W + 5) * 4 + 1] += 3;
+	b[(6 * W + 2) * 4 + 3] -= 40;
+	ew::ImageDiff strict = ew::diffImages(a.data(), b.data(), W, H);
+	EW_CHECK(strict.maxDifference == 40);
+	EW_CHECK(strict.numDifferentPixels == 2);
+	ew::ImageDiff tolerant = ew::diffImages(a.data(), b.data(), W, H, 3);
+	EW_CHECK(tolerant.maxDifference == 40);
+	EW_CHECK(tolerant.numDifferentPixels == 1);
+}
+
+//Encodes with our writer, decodes with stb_image, and expects the exact pixels back
+static void testPngRoundTrip() {
+	const int W = 37, H = 23; //Odd sizes, so rows aren't a multiple of anything convenient
+	std::vector<unsigned char> rgba = makeGradient(W, H);
+	stbi_set_flip_vertically_on_load(false);
+	for (int flip = 0; flip < 2; flip++)
+	{
+		std::vector<unsigned char> png;
+		EW_CHECK(ew::encodePng(rgba.data(), W, H, 4, flip == 1, &png));
+		int width = 0, height = 0, channels = 0;
+		unsigned char* decoded = stbi_load_from_memory(png.data(), (int)png.size(), &width, &height, &channels, 4);
+		EW_CHECK(decoded != nullptr);
+		if (decoded == nullptr) {
+			continue;
+		}
+		EW_CHECK(width == W && height == H);
+		std::vector<unsigned char> expected = rgba;
+		if (flip == 1) {
+			for (int y = 0; y < H; y++)
+			{
+				memcpy(&expected[(size_t)y * W * 4], &rgba[(size_t)(H - 1 - y) * W * 4], (size_t)W * 4);
+			}
+		}
+		ew::ImageDiff diff = ew::diffImages(expected.data(), decoded, W, H);
+		EW_CHECK(diff.numDifferentPixels == 0);
+		stbi_image_free(decoded);
+	}
+}
+
+//Clears a render target to two colors, then reads it back both ways and diffs against the expected image
+static void testRenderTargetReadback() {
+	const int W = 32, H = 16;
+	ew::RenderTarget target;
+	target.resize(W, H);
+	target.bind();
+	glClearColor(1.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(4, 2, 8, 6);
+	glClearColor(0.0f, 1.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glDisable(GL_SCISSOR_TEST);
+	const unsigned char red[4] = { 255, 0, 0, 255 };
+	const unsigned char green[4] = { 0, 255, 0, 255 };
+	std::vector<unsigned char> expected = makeRect(W, H, red, green, 4, 2, 12, 8);
+
+	std::vector<unsigned char> blocking;
+	target.readColor(&blocking);
+	EW_CHECK(blocking.size() == expected.size());
+	if (blocking.size() == expected.size()) {
+		EW_CHECK(ew::diffImages(expected.data(), blocking.data(), W, H).numDifferentPixels == 0);
+	}
+
+	ew::ReadbackQueue queue(2);
+	std::vector<unsigned char> async;
+	EW_CHECK(target.readColor(&queue, [&async](const ew::ReadbackResult& result) {
+		async.assign((const unsigned char*)result.data, (const unsigned char*)result.data + result.size);
+	}));
+	glFinish();
+	queue.poll();
+	EW_CHECK(queue.getNumInFlight() == 0);
+	EW_CHECK(async.size() == expected.size());
+	if (async.size() == expected.size()) {
+		EW_CHECK(ew::diffImages(expected.data(), async.data(), W, H).numDifferentPixels == 0);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+int main() {
+	testDiff();
+	testPngRoundTrip();
+	TestContext context;
+	if (context.isValid()) {
+		testRenderTargetReadback();
+	}
+	return finishTest();
+}
@@ -0,0 +1,80 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/jobSystem.h>
+#include <chrono>
+#include <math.h>
+#include <thread>
+#include <vector>
+#include "testing.h"
+
+//Enough math per element that the benchmark measures scaling, not memory bandwidth
+static float work(size_t i) {
+	float x = (float)i * 0.001f;
+	float sum = 0.0f;
+	for (int k = 0; k < 32; k++)
+	{
+		sum += sinf(x + k) * cosf(x - k);
+	}
+	return sum;
+}
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+	const size_t COUNT = 1 << 20;
+	const size_t GRAIN = 4096;
+	const int REPEATS = 5;
+	std::vector<float> expected(COUNT);
+	std::vector<float> results(COUNT);
+	auto body = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			results[i] = work(i);
+		}
+	};
+
+	//Single threaded baseline, without a job system
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < REPEATS; r++)
+	{
+		body(0, COUNT);
+	}
+	double baseline = seconds(start) / REPEATS;
+	expected = results;
+	printf("threads  parallelFor ms  speedup  empty jobs/ms\n");
+	printf("%7d  %14.2f  %7.2f  %13s\n", 1, baseline * 1000.0, 1.0, "-");
+
+	unsigned int maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads < 2) {
+		maxThreads = 2;
+	}
+	for (unsigned int numThreads = 2; numThreads <= maxThreads; numThreads++)
+	{
+		ew::JobSystem jobSystem(numThreads - 1);
+		std::fill(results.begin(), results.end(), 0.0f);
+		start = std::chrono::steady_clock::now();
+		for (int r = 0; r < REPEATS; r++)
+		{
+			jobSystem.parallelFor(COUNT, GRAIN, body);
+		}
+		double elapsed = seconds(start) / REPEATS;
+		EW_CHECK(results == expected);
+
+		//Queueing overhead: many jobs that do nothing
+		const int NUM_EMPTY_JOBS = 100000;
+		ew::JobCounter counter;
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < NUM_EMPTY_JOBS; i++)
+		{
+			jobSystem.run([]() {}, &counter);
+		}
+		jobSystem.wait(&counter);
+		double emptyElapsed = seconds(start);
+		printf("%7u  %14.2f  %7.2f  %13.0f\n", numThreads, elapsed * 1000.0, baseline / elapsed, NUM_EMPTY_JOBS / (emptyElapsed * 1000.0));
+	}
+	return finishTest();
+}
@@ -0,0 +1,82 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/jobSystem.h>
+#include <chrono>
+#include <ctime>
+#include <thread>
+#include <vector>
+#include "testing.h"
+
+int main() {
+	ew::JobSystem jobSystem(3);
+
+	//Every index is visited exactly once, including from nested parallelFor calls
+	std::vector<std::atomic<int>> visits(10000);
+	jobSystem.parallelFor(100, 7, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			jobSystem.parallelFor(100, 13, [&, i](size_t innerBegin, size_t innerEnd) {
+				for (size_t j = innerBegin; j < innerEnd; j++)
+				{
+					visits[i * 100 + j].fetch_add(1);
+				}
+			});
+		}
+	});
+	bool visitedOnce = true;
+	for (std::atomic<int>& count : visits)
+	{
+		visitedOnce &= count.load() == 1;
+	}
+	EW_CHECK(visitedOnce);
+
+	//Successors start only once all of their dependencies are done
+	ew::JobGraph graph;
+	std::atomic<int> numFirst{ 0 };
+	std::atomic<int> seenBySecond{ -1 };
+	std::vector<ew::JobGraph::Node> first;
+	for (int i = 0; i < 8; i++)
+	{
+		first.push_back(graph.add([&]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			numFirst.fetch_add(1);
+		}));
+	}
+	ew::JobGraph::Node second = graph.add([&]() { seenBySecond = numFirst.load(); });
+	for (ew::JobGraph::Node node : first)
+	{
+		graph.addDependency(node, second);
+	}
+	graph.execute(&jobSystem);
+	EW_CHECK(seenBySecond.load() == 8);
+	//Without a job system, nodes run in the order they were added
+	numFirst = 0;
+	seenBySecond = -1;
+	graph.execute(nullptr);
+	EW_CHECK(seenBySecond.load() == 8);
+
+	//A thread waiting on a job running elsewhere sleeps instead of spinning
+	ew::JobCounter counter;
+	std::atomic<bool> started{ false };
+	jobSystem.run([&]() {
+		started = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	}, &counter);
+	while (!started.load()) {
+		std::this_thread::yield();
+	}
+	std::clock_t cpuStart = std::clock();
+	auto wallStart = std::chrono::steady_clock::now();
+	jobSystem.wait(&counter);
+	double cpuSeconds = (double)(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+	double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+	EW_CHECK(counter.isDone());
+	printf("Waited %.0f ms using %.1f ms of CPU\n", wallSeconds * 1000.0, cpuSeconds * 1000.0);
+#ifndef _WIN32
+	//clock() is process CPU time everywhere but Windows, where it's wall time
+	EW_CHECK(cpuSeconds < wallSeconds * 0.25);
+#endif
+	return finishTest();
+}
@@ -0,0 +1,83 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/jobSystem.h>
+#include <ew/meshCodec.h>
+#include <ew/procGen.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "testAssimp.h"
+#include "testing.h"
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct BenchmarkMesh {
+	std::string name;
+	ew::MeshData mesh;
+};
+
+//Compression ratio, then decode throughput in GB/s of decoded vertex and index data, single threaded and on the job system
+int main() {
+	const int REPEATS = 5;
+	std::vector<BenchmarkMesh> meshes;
+	BenchmarkMesh suzanne = { "Suzanne" };
+	const unsigned int IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace;
+	EW_CHECK(importFirstMesh(EW_TEST_ASSETS_DIR "Suzanne.obj", IMPORT_FLAGS, &suzanne.mesh));
+	if (!suzanne.mesh.vertices.empty()) {
+		meshes.push_back(suzanne);
+	}
+	const int SUBDIVISIONS[] = { 64, 256, 1024 };
+	for (int subdivisions : SUBDIVISIONS)
+	{
+		meshes.push_back({ "createSphere(" + std::to_string(subdivisions) + ")", ew::createSphere(1.0f, subdivisions) });
+	}
+
+	unsigned int maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads < 2) {
+		maxThreads = 2;
+	}
+	printf("%-20s %9s %9s %6s %8s", "mesh", "vertices", "triangles", "ratio", "encode");
+	for (unsigned int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+	{
+		printf(" %7u thr", numThreads);
+	}
+	printf("\n");
+
+	for (const BenchmarkMesh& benchmark : meshes)
+	{
+		const ew::MeshData& mesh = benchmark.mesh;
+		ew::MeshCodecStats stats;
+		auto start = std::chrono::steady_clock::now();
+		std::vector<unsigned char> compressed = ew::compressMesh(mesh, &stats);
+		double encodeTime = seconds(start);
+		printf("%-20s %9zu %9zu %6.2f %6.1fms", benchmark.name.c_str(), mesh.vertices.size(), mesh.indices.size() / 3, stats.ratio(), encodeTime * 1000.0);
+
+		//Decode into memory that's already allocated and touched, like mapped GPU buffers, so only decoding is timed
+		std::vector<ew::Vertex> vertices(mesh.vertices.size());
+		std::vector<unsigned int> indices(mesh.indices.size());
+		auto printDecodeRate = [&](ew::JobSystem* jobSystem) {
+			double best = 1e9;
+			for (int r = 0; r < REPEATS; r++)
+			{
+				auto decodeStart = std::chrono::steady_clock::now();
+				EW_CHECK(ew::decompressMesh(compressed.data(), compressed.size(), vertices.data(), indices.data(), jobSystem));
+				best = std::min(best, seconds(decodeStart));
+			}
+			printf(" %6.2fGB/s", stats.rawBytes / best / 1e9);
+		};
+		printDecodeRate(nullptr);
+		for (unsigned int numThreads = 2; numThreads <= maxThreads; numThreads *= 2)
+		{
+			ew::JobSystem jobSystem(numThreads - 1);
+			printDecodeRate(&jobSystem);
+		}
+		printf("\n");
+	}
+	return finishTest();
+}
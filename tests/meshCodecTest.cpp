@@ -0,0 +1,265 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/jobSystem.h>
+#include <ew/meshCodec.h>
+#include <ew/procGen.h>
+#include <algorithm>
+#include <random>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "glTestContext.h"
+#include "testing.h"
+
+//Header layout: magic, version, numVertices, numIndices, numVertexBlocks, numIndexBlocks (4 bytes each), then float bounds.
+//The block offset table follows, then the payload.
+static const size_t VERSION_OFFSET = 4;
+static const size_t NUM_VERTICES_OFFSET = 8;
+static const size_t HEADER_SIZE = 64;
+static const size_t BLOCK_SIZE = 4096;
+
+/// <summary>
+/// Triangle strip with a different normal, uv and tangent sign at every vertex, so no channel compresses to nothing.
+/// n vertices make n - 2 triangles, which lets the vertex and triangle counts land either side of a block boundary.
+/// </summary>
+static ew::MeshData makeStrip(size_t numVertices) {
+	ew::MeshData mesh;
+	for (size_t i = 0; i < numVertices; i++)
+	{
+		float t = (float)i;
+		ew::Vertex v;
+		v.pos = glm::vec3(t * 0.01f, (float)(i % 2), sinf(t * 0.3f) * 0.5f);
+		v.normal = glm::normalize(glm::vec3(sinf(t * 0.7f), cosf(t * 0.7f), 0.5f * sinf(t * 0.11f)));
+		v.uv = glm::vec2(t / numVertices, (float)(i % 2));
+		glm::vec3 tangent = glm::normalize(glm::cross(v.normal, glm::vec3(0.0f, 0.0f, 1.0f)));
+		v.tangent = glm::vec4(tangent, i % 3 == 0 ? -1.0f : 1.0f);
+		mesh.vertices.push_back(v);
+	}
+	for (size_t i = 0; i + 2 < numVertices; i++)
+	{
+		//Flip every other triangle so the strip keeps one winding
+		unsigned int a = (unsigned int)i, b = (unsigned int)i + 1, c = (unsigned int)i + 2;
+		if (i % 2 == 1) {
+			std::swap(a, b);
+		}
+		mesh.indices.push_back(a);
+		mesh.indices.push_back(b);
+		mesh.indices.push_back(c);
+	}
+	return mesh;
+}
+
+static glm::vec3 getExtent(const ew::MeshData& mesh) {
+	ew::AABB bounds;
+	for (const ew::Vertex& v : mesh.vertices)
+	{
+		bounds.expand(v.pos);
+	}
+	return bounds.max - bounds.min;
+}
+
+/// <summary>
+/// Compares a decoded mesh with the original. Each attribute must be within its quantization step,
+/// and each triangle must be the same triangle with the same winding, though it may start at a different corner.
+/// </summary>
+static void checkDecoded(const ew::MeshData& original, const ew::MeshData& decoded) {
+	EW_CHECK(decoded.vertices.size() == original.vertices.size());
+	EW_CHECK(decoded.indices.size() == original.indices.size());
+	if (decoded.vertices.size() != original.vertices.size() || decoded.indices.size() != original.indices.size()) {
+		return;
+	}
+	//A step of 16 bit quantization. Rounding is to the nearest step, but float math can tip a value on the midpoint either way.
+	glm::vec3 positionTolerance = getExtent(original) / 65535.0f + glm::vec3(1e-6f);
+	const float DIRECTION_TOLERANCE = 2e-4f;
+	const float UV_TOLERANCE = 1.0f / 65535.0f;
+	size_t numBadPositions = 0, numBadNormals = 0, numBadUvs = 0, numBadTangents = 0;
+	for (size_t i = 0; i < original.vertices.size(); i++)
+	{
+		const ew::Vertex& a = original.vertices[i];
+		const ew::Vertex& b = decoded.vertices[i];
+		glm::vec3 positionError = glm::abs(a.pos - b.pos);
+		numBadPositions += positionError.x > positionTolerance.x || positionError.y > positionTolerance.y || positionError.z > positionTolerance.z;
+		numBadNormals += glm::length(a.normal - b.normal) > DIRECTION_TOLERANCE;
+		numBadUvs += fabsf(a.uv.x - b.uv.x) > UV_TOLERANCE || fabsf(a.uv.y - b.uv.y) > UV_TOLERANCE;
+		numBadTangents += glm::length(glm::vec3(a.tangent) - glm::vec3(b.tangent)) > DIRECTION_TOLERANCE || a.tangent.w != b.tangent.w;
+	}
+	EW_CHECK(numBadPositions == 0);
+	EW_CHECK(numBadNormals == 0);
+	EW_CHECK(numBadUvs == 0);
+	EW_CHECK(numBadTangents == 0);
+
+	size_t numBadTriangles = 0;
+	for (size_t t = 0; t < original.indices.size() / 3; t++)
+	{
+		const unsigned int* expected = &original.indices[t * 3];
+		const unsigned int* actual = &decoded.indices[t * 3];
+		bool match = false;
+		for (int r = 0; r < 3; r++)
+		{
+			match |= actual[0] == expected[r] && actual[1] == expected[(r + 1) % 3] && actual[2] == expected[(r + 2) % 3];
+		}
+		numBadTriangles += !match;
+	}
+	EW_CHECK(numBadTriangles == 0);
+}
+
+//Compresses, decodes serially and on the job system, and checks both against the original and each other
+static void testRoundTrip(const ew::MeshData& mesh, ew::JobSystem* jobSystem) {
+	ew::MeshCodecStats stats;
+	std::vector<unsigned char> compressed = ew::compressMesh(mesh, &stats);
+	EW_CHECK(stats.compressedBytes == compressed.size());
+	ew::CompressedMeshInfo info;
+	EW_CHECK(ew::getCompressedMeshInfo(compressed.data(), compressed.size(), &info));
+	EW_CHECK(info.numVertices == mesh.vertices.size());
+	EW_CHECK(info.numIndices == mesh.indices.size());
+
+	ew::MeshData serial, parallel;
+	EW_CHECK(ew::decompressMesh(compressed.data(), compressed.size(), &serial));
+	EW_CHECK(ew::decompressMesh(compressed.data(), compressed.size(), &parallel, jobSystem));
+	checkDecoded(mesh, serial);
+	//Blocks decode independently, so the thread count can't change a single bit
+	EW_CHECK(serial.vertices.size() == parallel.vertices.size() && serial.indices.size() == parallel.indices.size());
+	if (serial.vertices.size() == parallel.vertices.size() && serial.indices.size() == parallel.indices.size()) {
+		EW_CHECK(memcmp(serial.vertices.data(), parallel.vertices.data(), sizeof(ew::Vertex) * serial.vertices.size()) == 0);
+		EW_CHECK(memcmp(serial.indices.data(), parallel.indices.data(), sizeof(unsigned int) * serial.indices.size()) == 0);
+	}
+}
+
+//Vertex counts and triangle counts on, just under and just over a block
+static void testBlockBoundaries(ew::JobSystem* jobSystem) {
+	const size_t sizes[] = { BLOCK_SIZE, BLOCK_SIZE + 1, BLOCK_SIZE + 2, BLOCK_SIZE + 3, BLOCK_SIZE * 2 + 3 };
+	for (size_t numVertices : sizes)
+	{
+		testRoundTrip(makeStrip(numVertices), jobSystem);
+	}
+}
+
+//Shuffling vertex order defeats the vertex FIFO, so most indices are coded explicitly
+static void testShuffledIndices(ew::JobSystem* jobSystem) {
+	ew::MeshData sphere = ew::createSphere(1.0f, 64);
+	std::vector<unsigned int> permutation(sphere.vertices.size());
+	for (size_t i = 0; i < permutation.size(); i++)
+	{
+		permutation[i] = (unsigned int)i;
+	}
+	std::mt19937 random(7);
+	std::shuffle(permutation.begin(), permutation.end(), random);
+	ew::MeshData shuffled = sphere;
+	for (size_t i = 0; i < permutation.size(); i++)
+	{
+		shuffled.vertices[permutation[i]] = sphere.vertices[i];
+	}
+	for (unsigned int& index : shuffled.indices)
+	{
+		index = permutation[index];
+	}
+	testRoundTrip(sphere, jobSystem);
+	testRoundTrip(shuffled, jobSystem);
+}
+
+static bool decodes(const std::vector<unsigned char>& data, ew::JobSystem* jobSystem) {
+	ew::MeshData mesh;
+	return ew::decompressMesh(data.data(), data.size(), &mesh, jobSystem);
+}
+
+//Bad input is rejected, and random damage never produces an index past the vertex buffer
+static void testInvalidInput(ew::JobSystem* jobSystem) {
+	ew::MeshData source = makeStrip(BLOCK_SIZE * 2 + 3);
+	std::vector<unsigned char> compressed = ew::compressMesh(source);
+	EW_CHECK(decodes(compressed, jobSystem));
+
+	//Every block's end offset is checked against the data, so any truncation fails
+	size_t numTruncationFailures = 0, numTruncations = 0;
+	for (size_t size = 0; size < compressed.size(); size += 1 + size / 8)
+	{
+		std::vector<unsigned char> truncated(compressed.begin(), compressed.begin() + size);
+		numTruncationFailures += !decodes(truncated, jobSystem);
+		numTruncations++;
+	}
+	EW_CHECK(numTruncationFailures == numTruncations);
+	ew::CompressedMeshInfo info;
+	EW_CHECK(!ew::getCompressedMeshInfo(compressed.data(), HEADER_SIZE - 1, &info));
+
+	{
+		std::vector<unsigned char> corrupt = compressed;
+		corrupt[0] = 'X';
+		EW_CHECK(!decodes(corrupt, jobSystem));
+	}
+	{
+		std::vector<unsigned char> corrupt = compressed;
+		uint32_t version = 99;
+		memcpy(&corrupt[VERSION_OFFSET], &version, sizeof(version));
+		EW_CHECK(!decodes(corrupt, jobSystem));
+	}
+	{
+		//Vertex count no longer matches the block count
+		std::vector<unsigned char> corrupt = compressed;
+		uint32_t numVertices = 0xFFFFFFFFu;
+		memcpy(&corrupt[NUM_VERTICES_OFFSET], &numVertices, sizeof(numVertices));
+		EW_CHECK(!ew::getCompressedMeshInfo(corrupt.data(), corrupt.size(), &info));
+	}
+	{
+		//First vertex block claims to end past the data
+		std::vector<unsigned char> corrupt = compressed;
+		uint32_t end = (uint32_t)compressed.size();
+		memcpy(&corrupt[HEADER_SIZE + sizeof(uint32_t)], &end, sizeof(end));
+		EW_CHECK(!decodes(corrupt, jobSystem));
+	}
+	{
+		//Continuation bits on every byte make an unterminated varint
+		std::vector<unsigned char> corrupt = compressed;
+		std::fill(corrupt.end() - 64, corrupt.end(), 0xff);
+		EW_CHECK(!decodes(corrupt, jobSystem));
+	}
+
+	std::mt19937 random(11);
+	std::uniform_int_distribution<size_t> position(HEADER_SIZE, compressed.size() - 1);
+	size_t numOutOfRange = 0;
+	for (int i = 0; i < 200; i++)
+	{
+		std::vector<unsigned char> corrupt = compressed;
+		for (int j = 0; j < 4; j++)
+		{
+			corrupt[position(random)] ^= (unsigned char)(1 + random() % 255);
+		}
+		ew::MeshData mesh;
+		if (ew::decompressMesh(corrupt.data(), corrupt.size(), &mesh, jobSystem)) {
+			for (unsigned int index : mesh.indices)
+			{
+				numOutOfRange += index >= mesh.vertices.size();
+			}
+		}
+	}
+	EW_CHECK(numOutOfRange == 0);
+}
+
+//Mesh::loadCompressed decodes into mapped buffers, and must fail cleanly on the same bad input
+static void testLoadCompressed() {
+	ew::MeshData source = makeStrip(BLOCK_SIZE + 3);
+	std::vector<unsigned char> compressed = ew::compressMesh(source);
+	ew::Mesh mesh;
+	EW_CHECK(mesh.loadCompressed(compressed.data(), compressed.size()));
+	EW_CHECK(mesh.getNumVertices() == (int)source.vertices.size());
+	EW_CHECK(mesh.getNumIndices() == (int)source.indices.size());
+
+	std::vector<unsigned char> truncated(compressed.begin(), compressed.end() - 1);
+	ew::Mesh truncatedMesh;
+	EW_CHECK(!truncatedMesh.loadCompressed(truncated.data(), truncated.size()));
+	EW_CHECK(truncatedMesh.getNumIndices() == 0);
+	ew::Mesh headerOnly;
+	EW_CHECK(!headerOnly.loadCompressed(compressed.data(), HEADER_SIZE - 1));
+}
+
+int main() {
+	ew::JobSystem jobSystem(3);
+	testBlockBoundaries(&jobSystem);
+	testShuffledIndices(&jobSystem);
+	testInvalidInput(&jobSystem);
+	TestContext context;
+	if (context.isValid()) {
+		testLoadCompressed();
+	}
+	return finishTest();
+}
@@ -0,0 +1,112 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/jobSystem.h>
+#include <ew/meshProcessing.h>
+#include <ew/procGen.h>
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include "testAssimp.h"
+#include "testing.h"
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//The mesh as OBJ text, so Assimp can import exactly the same triangles from memory
+static std::string toObj(const ew::MeshData& mesh) {
+	std::string obj;
+	obj.reserve(mesh.vertices.size() * 64 + mesh.indices.size() * 12);
+	char line[128];
+	for (const ew::Vertex& v : mesh.vertices)
+	{
+		snprintf(line, sizeof(line), "v %.9g %.9g %.9g\nvt %.9g %.9g\n", v.pos.x, v.pos.y, v.pos.z, v.uv.x, v.uv.y);
+		obj += line;
+	}
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		//OBJ indices start at 1
+		unsigned int a = mesh.indices[i] + 1, b = mesh.indices[i + 1] + 1, c = mesh.indices[i + 2] + 1;
+		snprintf(line, sizeof(line), "f %u/%u %u/%u %u/%u\n", a, a, b, b, c, c);
+		obj += line;
+	}
+	return obj;
+}
+
+/// <summary>
+/// Time Assimp's single threaded GenSmoothNormals and CalcTangentSpace steps take on the mesh, the alternative to
+/// generating them ourselves. Importing isn't timed, only the post-processing applied afterwards. Returns a negative
+/// time if Assimp couldn't import the mesh.
+/// </summary>
+static double timeAssimpPostProcess(const ew::MeshData& mesh) {
+	std::string obj = toObj(mesh);
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFileFromMemory(obj.data(), obj.size(), aiProcess_DropNormals | aiProcess_JoinIdenticalVertices, "obj");
+	if (scene == nullptr) {
+		printf("Failed to import the benchmark mesh into Assimp: %s\n", importer.GetErrorString());
+		return -1.0;
+	}
+	auto start = std::chrono::steady_clock::now();
+	scene = importer.ApplyPostProcessing(aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
+	double elapsed = seconds(start);
+	if (scene == nullptr || scene->mNumMeshes == 0 || !scene->mMeshes[0]->HasTangentsAndBitangents()) {
+		printf("Assimp post-processing failed: %s\n", importer.GetErrorString());
+		return -1.0;
+	}
+	return elapsed;
+}
+
+//Normal and tangent generation on a mesh the size of a dense scanned asset, single threaded, on the job system and in Assimp
+int main() {
+	const int SUBDIVISIONS = 1024;
+	const int REPEATS = 3;
+	const ew::MeshData source = ew::createSphere(1.0f, SUBDIVISIONS);
+	printf("%zu vertices, %zu triangles\n", source.vertices.size(), source.indices.size() / 3);
+
+	//Best of a few runs, each on a fresh copy since tangent generation can append vertices
+	auto run = [&](ew::JobSystem* jobSystem, double* normalTime, double* tangentTime) {
+		*normalTime = *tangentTime = 1e9;
+		for (int r = 0; r < REPEATS; r++)
+		{
+			ew::MeshData mesh = source;
+			auto start = std::chrono::steady_clock::now();
+			ew::generateNormals(&mesh, jobSystem);
+			*normalTime = std::min(*normalTime, seconds(start));
+			start = std::chrono::steady_clock::now();
+			ew::generateTangents(&mesh, jobSystem);
+			*tangentTime = std::min(*tangentTime, seconds(start));
+			EW_CHECK(mesh.vertices.size() == source.vertices.size());
+		}
+	};
+
+	double baselineNormals, baselineTangents;
+	run(nullptr, &baselineNormals, &baselineTangents);
+	printf("threads  normals ms  tangents ms  speedup\n");
+	printf("%7d  %10.2f  %11.2f  %7.2f\n", 1, baselineNormals * 1000.0, baselineTangents * 1000.0, 1.0);
+	unsigned int maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads < 2) {
+		maxThreads = 2;
+	}
+	double bestTotal = baselineNormals + baselineTangents;
+	for (unsigned int numThreads = 2; numThreads <= maxThreads; numThreads *= 2)
+	{
+		ew::JobSystem jobSystem(numThreads - 1);
+		double normals, tangents;
+		run(&jobSystem, &normals, &tangents);
+		printf("%7u  %10.2f  %11.2f  %7.2f\n", numThreads, normals * 1000.0, tangents * 1000.0,
+			(baselineNormals + baselineTangents) / (normals + tangents));
+		bestTotal = std::min(bestTotal, normals + tangents);
+	}
+
+	double assimpTime = timeAssimpPostProcess(source);
+	EW_CHECK(assimpTime >= 0.0);
+	if (assimpTime >= 0.0) {
+		printf("Assimp GenSmoothNormals + CalcTangentSpace: %.2f ms, %.2fx our single threaded time, %.2fx our best\n",
+			assimpTime * 1000.0, assimpTime / (baselineNormals + baselineTangents), assimpTime / bestTotal);
+	}
+	return finishTest();
+}
@@ -0,0 +1,196 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/jobSystem.h>
+#include <ew/meshProcessing.h>
+#include <ew/procGen.h>
+#include <algorithm>
+#include <math.h>
+#include <vector>
+#include "testAssimp.h"
+#include "testing.h"
+
+static float angleBetween(const glm::vec3& a, const glm::vec3& b) {
+	return acosf(glm::clamp(glm::dot(glm::normalize(a), glm::normalize(b)), -1.0f, 1.0f)) * 57.2957795f;
+}
+
+//Every face of the cube has its own 4 vertices. Welding gives the copies at a corner one normal, pointing out diagonally.
+static void testWeldedNormals() {
+	ew::MeshData cube = ew::createCube(2.0f);
+	EW_CHECK(cube.vertices.size() == 24);
+	ew::generateNormals(&cube);
+	for (const ew::Vertex& v : cube.vertices)
+	{
+		glm::vec3 diagonal = glm::normalize(v.pos);
+		EW_CHECK(angleBetween(v.normal, diagonal) < 0.01f);
+	}
+}
+
+/// <summary>
+/// Two quads side by side sharing an edge, the right one with its U axis mirrored, like the two halves of a symmetric character.
+/// The shared vertices get split, and each side keeps its own tangent and handedness.
+/// </summary>
+static void testMirroredTangents() {
+	ew::MeshData mesh;
+	const glm::vec3 positions[6] = { {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}, {2, 0, 0}, {2, 1, 0} };
+	const glm::vec2 uvs[6] = { {0, 0}, {1, 0}, {1, 1}, {0, 1}, {0, 0}, {0, 1} };
+	for (int i = 0; i < 6; i++)
+	{
+		ew::Vertex v;
+		v.pos = positions[i];
+		v.normal = glm::vec3(0.0f, 0.0f, 1.0f);
+		v.uv = uvs[i];
+		v.tangent = glm::vec4(0.0f);
+		mesh.vertices.push_back(v);
+	}
+	const unsigned int indices[12] = { 0, 1, 2, 2, 3, 0, 1, 4, 5, 5, 2, 1 };
+	mesh.indices.assign(indices, indices + 12);
+	std::vector<unsigned int> splitSources;
+	ew::generateTangents(&mesh, nullptr, &splitSources);
+
+	EW_CHECK(splitSources.size() == 2);
+	EW_CHECK(mesh.vertices.size() == 8);
+	if (mesh.vertices.size() != 8 || splitSources.size() != 2) {
+		return;
+	}
+	EW_CHECK(splitSources[0] == 1 && splitSources[1] == 2);
+	for (size_t i = 0; i < splitSources.size(); i++)
+	{
+		EW_CHECK(mesh.vertices[6 + i].pos == mesh.vertices[splitSources[i]].pos);
+		EW_CHECK(mesh.vertices[6 + i].uv == mesh.vertices[splitSources[i]].uv);
+	}
+	//Left quad is untouched, the right quad now uses the copies
+	for (int i = 0; i < 6; i++)
+	{
+		EW_CHECK(mesh.indices[i] == indices[i]);
+	}
+	const unsigned int remapped[6] = { 6, 4, 5, 5, 7, 6 };
+	for (int i = 0; i < 6; i++)
+	{
+		EW_CHECK(mesh.indices[6 + i] == remapped[i]);
+	}
+	const int left[4] = { 0, 1, 2, 3 };
+	for (int v : left)
+	{
+		EW_CHECK(angleBetween(glm::vec3(mesh.vertices[v].tangent), glm::vec3(1, 0, 0)) < 0.01f);
+		EW_CHECK(mesh.vertices[v].tangent.w == 1.0f);
+	}
+	const int right[4] = { 4, 5, 6, 7 };
+	for (int v : right)
+	{
+		EW_CHECK(angleBetween(glm::vec3(mesh.vertices[v].tangent), glm::vec3(-1, 0, 0)) < 0.01f);
+		EW_CHECK(mesh.vertices[v].tangent.w == -1.0f);
+	}
+}
+
+//Procedural meshes have no mirrored UVs, so nothing splits, and the job system only changes the order sums are added in
+static void testJobSystemMatchesSerial() {
+	ew::JobSystem jobSystem(3);
+	ew::MeshData serial = ew::createSphere(1.0f, 256);
+	ew::MeshData parallel = serial;
+	std::vector<unsigned int> serialSplits, parallelSplits;
+	ew::generateNormals(&serial);
+	ew::generateTangents(&serial, nullptr, &serialSplits);
+	ew::generateNormals(&parallel, &jobSystem);
+	ew::generateTangents(&parallel, &jobSystem, &parallelSplits);
+	EW_CHECK(serialSplits.empty());
+	EW_CHECK(parallelSplits.empty());
+	EW_CHECK(serial.vertices.size() == parallel.vertices.size());
+	float maxDifference = 0.0f;
+	for (size_t i = 0; i < std::min(serial.vertices.size(), parallel.vertices.size()); i++)
+	{
+		maxDifference = std::max(maxDifference, glm::length(serial.vertices[i].normal - parallel.vertices[i].normal));
+		maxDifference = std::max(maxDifference, glm::length(serial.vertices[i].tangent - parallel.vertices[i].tangent));
+	}
+	EW_CHECK(maxDifference < 1e-4f);
+}
+
+/// <summary>
+/// Suzanne's normals and tangents against what Assimp generates for the same triangles. Assimp weights faces equally
+/// and smooths tangents across UV seams within 45 degrees, where we weight by angle and keep seams, so results
+/// differ a little vertex to vertex. Both imports keep face order, so triangle corners are compared one to one.
+/// </summary>
+static void testMatchesAssimp() {
+	const char* path = EW_TEST_ASSETS_DIR "Suzanne.obj";
+	const unsigned int IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_DropNormals | aiProcess_JoinIdenticalVertices;
+	Assimp::Importer ours, theirs;
+	const aiScene* ourScene = ours.ReadFile(path, IMPORT_FLAGS);
+	const aiScene* theirScene = theirs.ReadFile(path, IMPORT_FLAGS | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
+	EW_CHECK(ourScene != nullptr && theirScene != nullptr);
+	if (ourScene == nullptr || theirScene == nullptr) {
+		printf("Failed to import %s: %s %s\n", path, ours.GetErrorString(), theirs.GetErrorString());
+		return;
+	}
+	EW_CHECK(ourScene->mNumMeshes == 1 && theirScene->mNumMeshes == 1);
+	const aiMesh* theirMesh = theirScene->mMeshes[0];
+	EW_CHECK(theirMesh->HasNormals() && theirMesh->HasTangentsAndBitangents());
+	ew::MeshData mesh = convertAiMesh(ourScene->mMeshes[0]);
+	ew::generateNormals(&mesh);
+	ew::generateTangents(&mesh);
+	EW_CHECK(mesh.indices.size() == (size_t)theirMesh->mNumFaces * 3);
+	if (mesh.indices.size() != (size_t)theirMesh->mNumFaces * 3) {
+		return;
+	}
+
+	size_t numCorners = mesh.indices.size();
+	size_t numPositionMismatches = 0, numSignMismatches = 0;
+	std::vector<float> normalAngles, tangentAngles;
+	for (size_t corner = 0; corner < numCorners; corner++)
+	{
+		const ew::Vertex& v = mesh.vertices[mesh.indices[corner]];
+		unsigned int theirIndex = theirMesh->mFaces[corner / 3].mIndices[corner % 3];
+		const aiVector3D& p = theirMesh->mVertices[theirIndex];
+		const aiVector3D& n = theirMesh->mNormals[theirIndex];
+		const aiVector3D& t = theirMesh->mTangents[theirIndex];
+		const aiVector3D& b = theirMesh->mBitangents[theirIndex];
+		if (v.pos != glm::vec3(p.x, p.y, p.z)) {
+			numPositionMismatches++;
+			continue;
+		}
+		glm::vec3 theirNormal(n.x, n.y, n.z), theirTangent(t.x, t.y, t.z), theirBitangent(b.x, b.y, b.z);
+		normalAngles.push_back(angleBetween(v.normal, theirNormal));
+		//Assimp leaves tangents it couldn't compute as NaN or zero. Those corners have no reference to compare to.
+		if (!(glm::dot(theirTangent, theirTangent) > 0.5f) || !(glm::dot(theirBitangent, theirBitangent) > 0.5f)) {
+			continue;
+		}
+		tangentAngles.push_back(angleBetween(glm::vec3(v.tangent), theirTangent));
+		float theirSign = glm::dot(glm::cross(theirNormal, theirTangent), theirBitangent) < 0.0f ? -1.0f : 1.0f;
+		if (theirSign != v.tangent.w) {
+			numSignMismatches++;
+		}
+	}
+	EW_CHECK(numPositionMismatches == 0);
+	EW_CHECK(normalAngles.size() > 0 && tangentAngles.size() > numCorners / 2);
+	if (normalAngles.empty() || tangentAngles.empty()) {
+		return;
+	}
+	std::sort(normalAngles.begin(), normalAngles.end());
+	std::sort(tangentAngles.begin(), tangentAngles.end());
+	auto mean = [](const std::vector<float>& values) {
+		double sum = 0.0;
+		for (float v : values)
+		{
+			sum += v;
+		}
+		return (float)(sum / values.size());
+	};
+	float normalP95 = normalAngles[normalAngles.size() * 95 / 100];
+	float tangentP95 = tangentAngles[tangentAngles.size() * 95 / 100];
+	printf("Normals vs Assimp: mean %.2f, 95th percentile %.2f degrees over %zu corners\n", mean(normalAngles), normalP95, normalAngles.size());
+	printf("Tangents vs Assimp: mean %.2f, 95th percentile %.2f degrees, %zu of %zu signs differ\n",
+		mean(tangentAngles), tangentP95, numSignMismatches, tangentAngles.size());
+	EW_CHECK(mean(normalAngles) < 5.0f);
+	EW_CHECK(normalP95 < 15.0f);
+	EW_CHECK(mean(tangentAngles) < 10.0f);
+	EW_CHECK(tangentP95 < 30.0f);
+	EW_CHECK(numSignMismatches <= tangentAngles.size() / 100);
+}
+
+int main() {
+	testWeldedNormals();
+	testMirroredTangents();
+	testJobSystemMatchesSerial();
+	testMatchesAssimp();
+	return finishTest();
+}
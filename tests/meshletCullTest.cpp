@@ -0,0 +1,158 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/camera.h>
+#include <ew/meshlet.h>
+#include <ew/procGen.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include "testing.h"
+
+//Per meshlet, whether cullMeshlets kept it, read back from which index ranges it drew
+static std::vector<bool> getSurvivors(const ew::MeshletData& meshlets, const ew::MeshletDrawRanges& ranges) {
+	std::vector<bool> survivors(meshlets.meshlets.size(), false);
+	for (size_t m = 0; m < meshlets.meshlets.size(); m++)
+	{
+		size_t first = (size_t)meshlets.meshlets[m].triangleOffset * 3;
+		size_t last = first + meshlets.meshlets[m].numTriangles * 3;
+		for (size_t r = 0; r < ranges.getNumRanges(); r++)
+		{
+			size_t begin = (size_t)ranges.offsets[r] / sizeof(unsigned int);
+			if (first >= begin && last <= begin + ranges.counts[r]) {
+				survivors[m] = true;
+			}
+		}
+	}
+	return survivors;
+}
+
+//Ranges are in order, never touch (touching ones should have merged), and add up to the triangles drawn
+static void checkRanges(const ew::MeshletDrawRanges& ranges, const ew::MeshletCullStats& stats) {
+	EW_CHECK(ranges.counts.size() == ranges.offsets.size());
+	size_t numIndices = 0;
+	for (size_t r = 0; r < ranges.getNumRanges(); r++)
+	{
+		EW_CHECK(ranges.counts[r] > 0 && ranges.counts[r] % 3 == 0);
+		if (r > 0) {
+			size_t previousEnd = (size_t)ranges.offsets[r - 1] / sizeof(unsigned int) + ranges.counts[r - 1];
+			EW_CHECK((size_t)ranges.offsets[r] / sizeof(unsigned int) > previousEnd);
+		}
+		numIndices += ranges.counts[r];
+	}
+	EW_CHECK(numIndices == (size_t)stats.numTrianglesDrawn * 3);
+}
+
+/// <summary>
+/// True if any triangle of the meshlet faces a viewer at eye, or for an orthographic camera, looking along forward.
+/// A backface culled meshlet must have none.
+/// </summary>
+static bool hasFrontFacingTriangle(const ew::MeshData& mesh, const ew::MeshletData& meshlets, const ew::Meshlet& meshlet,
+	const glm::mat4& modelMatrix, const ew::Camera& camera) {
+	glm::vec3 forward = glm::normalize(camera.target - camera.position);
+	const unsigned int* vertices = meshlets.vertices.data() + meshlet.vertexOffset;
+	const unsigned char* triangles = meshlets.triangles.data() + (size_t)meshlet.triangleOffset * 3;
+	for (unsigned int t = 0; t < meshlet.numTriangles; t++)
+	{
+		glm::vec3 p[3];
+		for (int c = 0; c < 3; c++)
+		{
+			p[c] = glm::vec3(modelMatrix * glm::vec4(mesh.vertices[vertices[triangles[t * 3 + c]]].pos, 1.0f));
+		}
+		glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+		glm::vec3 view = camera.orthographic ? forward : p[0] - camera.position;
+		if (glm::dot(normal, view) < 0.0f) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//A sphere seen from outside: the far side is rejected by its normal cones, nothing facing the camera is
+static void testNormalCones(bool orthographic) {
+	ew::MeshData sphere = ew::createSphere(1.0f, 64);
+	ew::MeshletData meshlets = ew::buildMeshlets(sphere);
+	std::vector<unsigned int> meshletIndices = ew::buildMeshletIndices(meshlets);
+	EW_CHECK(meshletIndices.size() == sphere.indices.size());
+	ew::Camera camera;
+	camera.position = glm::vec3(0.0f, 0.0f, 5.0f);
+	camera.target = glm::vec3(0.0f);
+	camera.orthographic = orthographic;
+	glm::mat4 modelMatrix = glm::rotate(glm::mat4(1.0f), 0.3f, glm::vec3(0.0f, 1.0f, 0.0f));
+
+	ew::MeshletDrawRanges ranges;
+	ew::MeshletCullStats stats;
+	ew::cullMeshlets(meshlets, modelMatrix, camera, &ranges, &stats);
+	checkRanges(ranges, stats);
+	EW_CHECK(stats.numMeshlets == meshlets.meshlets.size());
+	EW_CHECK(stats.numFrustumCulled == 0);
+	//Roughly the back half of the sphere goes
+	EW_CHECK(stats.numBackfaceCulled > stats.numMeshlets / 4);
+	EW_CHECK(stats.numBackfaceCulled < stats.numMeshlets * 3 / 4);
+	std::vector<bool> survivors = getSurvivors(meshlets, ranges);
+	for (size_t m = 0; m < meshlets.meshlets.size(); m++)
+	{
+		if (!survivors[m]) {
+			EW_CHECK(!hasFrontFacingTriangle(sphere, meshlets, meshlets.meshlets[m], modelMatrix, camera));
+		}
+	}
+
+	//Non-uniform scale bends the cones, so backface culling turns off rather than guess
+	glm::mat4 stretched = glm::scale(modelMatrix, glm::vec3(1.0f, 2.0f, 1.0f));
+	ew::cullMeshlets(meshlets, stretched, camera, &ranges, &stats);
+	EW_CHECK(stats.numBackfaceCulled == 0);
+	EW_CHECK(stats.numTrianglesDrawn == stats.numTriangles);
+	EW_CHECK(ranges.getNumRanges() == 1);
+}
+
+//Moving the mesh out of view rejects every meshlet. Halfway out rejects only the meshlets past the edge.
+static void testFrustum() {
+	ew::MeshData plane = ew::createPlane(2.0f, 2.0f, 64);
+	ew::MeshletData meshlets = ew::buildMeshlets(plane);
+	ew::Camera camera;
+	camera.position = glm::vec3(0.0f, 5.0f, 0.01f);
+	camera.target = glm::vec3(0.0f);
+	camera.aspectRatio = 1.0f;
+	camera.fov = 30.0f;
+	ew::MeshletDrawRanges ranges;
+	ew::MeshletCullStats stats;
+
+	ew::cullMeshlets(meshlets, glm::mat4(1.0f), camera, &ranges, &stats);
+	checkRanges(ranges, stats);
+	EW_CHECK(stats.numFrustumCulled == 0);
+	EW_CHECK(stats.numTrianglesDrawn == stats.numTriangles);
+
+	ew::cullMeshlets(meshlets, glm::translate(glm::mat4(1.0f), glm::vec3(100.0f, 0.0f, 0.0f)), camera, &ranges, &stats);
+	checkRanges(ranges, stats);
+	EW_CHECK(stats.numFrustumCulled == stats.numMeshlets);
+	EW_CHECK(ranges.getNumRanges() == 0);
+
+	//From 5 up with a 30 degree field of view, the camera sees about 1.34 either side of the origin, so the plane hangs off the edge
+	const float SHIFT = 1.5f;
+	glm::mat4 shifted = glm::translate(glm::mat4(1.0f), glm::vec3(SHIFT, 0.0f, 0.0f));
+	ew::cullMeshlets(meshlets, shifted, camera, &ranges, &stats);
+	checkRanges(ranges, stats);
+	EW_CHECK(stats.numFrustumCulled > 0);
+	EW_CHECK(stats.numFrustumCulled < stats.numMeshlets);
+	std::vector<bool> survivors = getSurvivors(meshlets, ranges);
+	glm::mat4 viewProjection = camera.projectionMatrix() * camera.viewMatrix() * shifted;
+	for (size_t m = 0; m < meshlets.meshlets.size(); m++)
+	{
+		const ew::Meshlet& meshlet = meshlets.meshlets[m];
+		glm::vec4 clip = viewProjection * glm::vec4(meshlet.center, 1.0f);
+		//A meshlet whose center is on screen can never be culled, and one far off to the side always is
+		if (fabsf(clip.x) < clip.w && fabsf(clip.y) < clip.w) {
+			EW_CHECK(survivors[m]);
+		}
+		if (meshlet.center.x + SHIFT - meshlet.radius > 1.6f) {
+			EW_CHECK(!survivors[m]);
+		}
+	}
+}
+
+int main() {
+	testNormalCones(false);
+	testNormalCones(true);
+	testFrustum();
+	return finishTest();
+}
@@ -0,0 +1,124 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/metrics.h>
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "testing.h"
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//Every thread records into the same histogram and counter, the worst case for the shared atomics
+static void benchmarkContendedRecord(unsigned int maxThreads) {
+	const uint64_t RECORDS_PER_THREAD = 2000000;
+	printf("%-8s %12s %12s\n", "threads", "ns/record", "Mrecords/s");
+	for (unsigned int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+	{
+		ew::Histogram histogram;
+		ew::Counter counter;
+		std::vector<std::thread> threads;
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned int t = 0; t < numThreads; t++)
+		{
+			threads.emplace_back([&histogram, &counter, t]() {
+				//Spread over a few buckets, like real frame times
+				for (uint64_t i = 0; i < RECORDS_PER_THREAD; i++)
+				{
+					histogram.record(1000 + ((i * 7919 + t) & 1023));
+					counter.add();
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+		double elapsed = seconds(start);
+		uint64_t numRecords = RECORDS_PER_THREAD * numThreads;
+		EW_CHECK(histogram.snapshot().count == numRecords);
+		EW_CHECK(counter.get() == numRecords);
+		printf("%-8u %12.2f %12.1f\n", numThreads, elapsed * 1e9 / RECORDS_PER_THREAD, numRecords / elapsed / 1e6);
+	}
+}
+
+//Stands in for a frame's CPU work: a few passes over some transforms
+static float simulateFrame(std::vector<float>* values, int frame) {
+	float sum = 0.0f;
+	for (int pass = 0; pass < 4; pass++)
+	{
+		for (size_t i = 0; i < values->size(); i++)
+		{
+			float& v = (*values)[i];
+			v = v * 0.999f + sinf((float)(i + frame + pass)) * 0.001f;
+			sum += v;
+		}
+	}
+	return sum;
+}
+
+/// <summary>
+/// The same frame loop with and without the engine's usual instrumentation: a timer around the frame and each pass,
+/// a frame counter, and a gauge. Reports the best of a few runs of each.
+/// </summary>
+static void benchmarkFrameLoop() {
+	const int NUM_FRAMES = 500;
+	const int REPEATS = 5;
+	ew::MetricsRegistry registry;
+	ew::Histogram* frameTime = registry.getHistogram("frame_time_microseconds");
+	ew::Histogram* passTime = registry.getHistogram("pass_time_microseconds");
+	ew::Counter* frames = registry.getCounter("frames_total");
+	ew::Gauge* liveValues = registry.getGauge("live_values");
+	std::vector<float> values(4096, 1.0f);
+	volatile float sink = 0.0f;
+
+	double best[2] = { 1e9, 1e9 };
+	for (int r = 0; r < REPEATS; r++)
+	{
+		for (int instrumented = 0; instrumented < 2; instrumented++)
+		{
+			//Both loops do exactly the same arithmetic
+			std::fill(values.begin(), values.end(), 1.0f);
+			auto start = std::chrono::steady_clock::now();
+			for (int frame = 0; frame < NUM_FRAMES; frame++)
+			{
+				if (instrumented) {
+					ew::ScopedTimer timer(frameTime);
+					for (int pass = 0; pass < 3; pass++)
+					{
+						ew::ScopedTimer passTimer(passTime);
+						sink = sink + simulateFrame(&values, frame + pass);
+					}
+					frames->add();
+					liveValues->set((int64_t)values.size());
+				}
+				else {
+					for (int pass = 0; pass < 3; pass++)
+					{
+						sink = sink + simulateFrame(&values, frame + pass);
+					}
+				}
+			}
+			best[instrumented] = std::min(best[instrumented], seconds(start));
+		}
+	}
+	EW_CHECK(frames->get() == (uint64_t)NUM_FRAMES * REPEATS);
+	EW_CHECK(passTime->snapshot().count == (uint64_t)NUM_FRAMES * REPEATS * 3);
+	double plainUs = best[0] * 1e6 / NUM_FRAMES;
+	double instrumentedUs = best[1] * 1e6 / NUM_FRAMES;
+	printf("frame loop: %.2fus/frame plain, %.2fus/frame instrumented, %+.2f%% overhead\n",
+		plainUs, instrumentedUs, (instrumentedUs / plainUs - 1.0) * 100.0);
+}
+
+int main() {
+	unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 2u);
+	benchmarkContendedRecord(maxThreads);
+	benchmarkFrameLoop();
+	return finishTest();
+}
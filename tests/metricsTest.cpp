@@ -0,0 +1,500 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/metrics.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include "testing.h"
+
+//Lowest value in a bucket
+static uint64_t getBucketLowerBound(int index) {
+	return index == 0 ? 0 : ew::Histogram::getBucketUpperBound(index - 1) + 1;
+}
+
+//Buckets tile every value with no gaps or overlaps, and powers of two always start a new bucket
+static void testBuckets() {
+	const int NUM_BUCKETS = ew::Histogram::NUM_BUCKETS;
+	size_t numUncovered = 0;
+	for (int i = 0; i < NUM_BUCKETS; i++)
+	{
+		uint64_t lower = getBucketLowerBound(i);
+		uint64_t upper = ew::Histogram::getBucketUpperBound(i);
+		numUncovered += lower > upper || ew::Histogram::getBucketIndex(lower) != i || ew::Histogram::getBucketIndex(upper) != i;
+	}
+	EW_CHECK(numUncovered == 0);
+	EW_CHECK(ew::Histogram::getBucketUpperBound(NUM_BUCKETS - 1) == UINT64_MAX);
+
+	for (int bit = 0; bit < 64; bit++)
+	{
+		uint64_t power = (uint64_t)1 << bit;
+		const uint64_t VALUES[] = { power - 1, power, power + 1 };
+		for (uint64_t value : VALUES)
+		{
+			int index = ew::Histogram::getBucketIndex(value);
+			EW_CHECK(index >= 0 && index < NUM_BUCKETS);
+			EW_CHECK(value <= ew::Histogram::getBucketUpperBound(index));
+			EW_CHECK(value >= getBucketLowerBound(index));
+			//Small values are exact, larger ones are within 1/16 until everything shares the last bucket
+			if (value < (uint64_t)ew::Histogram::SUB_BUCKETS) {
+				EW_CHECK(index == (int)value);
+			}
+			else if (value < ((uint64_t)1 << ew::Histogram::MAX_BITS)) {
+				uint64_t lower = getBucketLowerBound(index);
+				EW_CHECK(ew::Histogram::getBucketUpperBound(index) - lower + 1 <= std::max<uint64_t>(lower / ew::Histogram::SUB_BUCKETS, 1));
+			}
+			else {
+				EW_CHECK(index == NUM_BUCKETS - 1);
+			}
+		}
+		if (bit >= ew::Histogram::SUB_BUCKET_BITS && bit < ew::Histogram::MAX_BITS) {
+			int index = ew::Histogram::getBucketIndex(power);
+			EW_CHECK(getBucketLowerBound(index) == power);
+			EW_CHECK(index == (bit - ew::Histogram::SUB_BUCKET_BITS + 1) * ew::Histogram::SUB_BUCKETS);
+		}
+	}
+	EW_CHECK(ew::Histogram::getBucketIndex(UINT64_MAX) == NUM_BUCKETS - 1);
+}
+
+static ew::HistogramSnapshot recordAll(const std::vector<uint64_t>& values) {
+	ew::Histogram histogram;
+	for (uint64_t value : values)
+	{
+		histogram.record(value);
+	}
+	return histogram.snapshot();
+}
+
+//True if value is at least expected and at most 1/16 above it, the most a bucket's upper bound can overshoot
+static bool withinBucket(uint64_t value, uint64_t expected) {
+	return value >= expected && value <= expected + expected / ew::Histogram::SUB_BUCKETS;
+}
+
+static void testPercentiles() {
+	EW_CHECK(recordAll({}).percentile(0.5) == 0);
+
+	//Small values are exact
+	std::vector<uint64_t> values;
+	for (uint64_t i = 0; i < 16; i++)
+	{
+		values.push_back(i);
+	}
+	ew::HistogramSnapshot exact = recordAll(values);
+	EW_CHECK(exact.count == 16);
+	EW_CHECK(exact.sum == 120);
+	EW_CHECK(exact.max == 15);
+	EW_CHECK(exact.percentile(0.0) == 0);
+	EW_CHECK(exact.percentile(0.5) == 7);
+	EW_CHECK(exact.percentile(1.0) == 15);
+
+	//A constant is reported exactly, since percentiles are capped at the max
+	ew::HistogramSnapshot constant = recordAll(std::vector<uint64_t>(100, 1000));
+	EW_CHECK(constant.percentile(0.5) == 1000);
+	EW_CHECK(constant.percentile(0.999) == 1000);
+	EW_CHECK_NEAR(constant.mean(), 1000.0, 0.0);
+
+	values.clear();
+	for (uint64_t i = 1; i <= 100000; i++)
+	{
+		values.push_back(i);
+	}
+	ew::HistogramSnapshot uniform = recordAll(values);
+	EW_CHECK(withinBucket(uniform.percentile(0.5), 50000));
+	EW_CHECK(withinBucket(uniform.percentile(0.9), 90000));
+	EW_CHECK(withinBucket(uniform.percentile(0.99), 99000));
+	EW_CHECK(uniform.percentile(0.999) >= 99900 && uniform.percentile(0.999) <= 100000);
+	EW_CHECK(uniform.percentile(1.0) == 100000);
+
+	//90% fast frames and 10% hitches
+	values.assign(900, 100);
+	values.insert(values.end(), 100, 10000);
+	ew::HistogramSnapshot bimodal = recordAll(values);
+	EW_CHECK(withinBucket(bimodal.percentile(0.5), 100));
+	EW_CHECK(withinBucket(bimodal.percentile(0.9), 100));
+	EW_CHECK(bimodal.percentile(0.95) == 10000);
+	EW_CHECK(bimodal.percentile(0.999) == 10000);
+
+	//Past 2^40 values share a bucket, which still reports the max instead of the bucket's start
+	ew::HistogramSnapshot huge = recordAll({ (uint64_t)1 << 41, (uint64_t)1 << 50 });
+	EW_CHECK(huge.percentile(1.0) == (uint64_t)1 << 50);
+	EW_CHECK(huge.percentile(0.5) >= (uint64_t)1 << 40);
+}
+
+//Recording from several threads at once loses nothing
+static void testConcurrentRecord() {
+	const int NUM_THREADS = 4;
+	const uint64_t NUM_RECORDS = 100000;
+	ew::Histogram histogram;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < NUM_THREADS; t++)
+	{
+		threads.emplace_back([&histogram, t]() {
+			for (uint64_t i = 0; i < NUM_RECORDS; i++)
+			{
+				histogram.record(i + t);
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	ew::HistogramSnapshot snapshot = histogram.snapshot();
+	EW_CHECK(snapshot.count == NUM_THREADS * NUM_RECORDS);
+	EW_CHECK(snapshot.sum == NUM_THREADS * (NUM_RECORDS * (NUM_RECORDS - 1) / 2) + NUM_RECORDS * (NUM_THREADS * (NUM_THREADS - 1) / 2));
+	EW_CHECK(snapshot.max == NUM_RECORDS - 1 + NUM_THREADS - 1);
+}
+
+/// <summary>
+/// Just enough of a JSON parser to tell whether a document is well formed. Collects the keys of the outermost object.
+/// </summary>
+class JsonValidator {
+public:
+	JsonValidator(const std::string& text) : m_text(text) {};
+	bool validate() {
+		skipWhitespace();
+		if (!parseValue(0)) {
+			return false;
+		}
+		skipWhitespace();
+		return m_position == m_text.size();
+	}
+	std::vector<std::string> keys;
+private:
+	char peek()const { return m_position < m_text.size() ? m_text[m_position] : '\0'; }
+	void skipWhitespace() {
+		while (peek() == ' ' || peek() == '\t' || peek() == '\r' || peek() == '\n') {
+			m_position++;
+		}
+	}
+	bool consume(const char* literal) {
+		size_t length = strlen(literal);
+		if (m_text.compare(m_position, length, literal) != 0) {
+			return false;
+		}
+		m_position += length;
+		return true;
+	}
+	bool parseValue(int depth) {
+		char c = peek();
+		if (c == '{') {
+			return parseObject(depth);
+		}
+		if (c == '[') {
+			return parseArray(depth);
+		}
+		if (c == '"') {
+			std::string str;
+			return parseString(&str);
+		}
+		if (c == '-' || (c >= '0' && c <= '9')) {
+			return parseNumber();
+		}
+		return consume("true") || consume("false") || consume("null");
+	}
+	bool parseObject(int depth) {
+		m_position++;
+		skipWhitespace();
+		if (peek() == '}') {
+			m_position++;
+			return true;
+		}
+		while (true)
+		{
+			std::string key;
+			skipWhitespace();
+			if (!parseString(&key)) {
+				return false;
+			}
+			if (depth == 0) {
+				keys.push_back(key);
+			}
+			skipWhitespace();
+			if (!consume(":")) {
+				return false;
+			}
+			skipWhitespace();
+			if (!parseValue(depth + 1)) {
+				return false;
+			}
+			skipWhitespace();
+			if (consume("}")) {
+				return true;
+			}
+			if (!consume(",")) {
+				return false;
+			}
+		}
+	}
+	bool parseArray(int depth) {
+		m_position++;
+		skipWhitespace();
+		if (consume("]")) {
+			return true;
+		}
+		while (true)
+		{
+			skipWhitespace();
+			if (!parseValue(depth + 1)) {
+				return false;
+			}
+			skipWhitespace();
+			if (consume("]")) {
+				return true;
+			}
+			if (!consume(",")) {
+				return false;
+			}
+		}
+	}
+	//Only \uXXXX escapes below 0x80 are decoded, which is all the registry writes
+	bool parseString(std::string* str) {
+		if (!consume("\"")) {
+			return false;
+		}
+		while (true)
+		{
+			if (m_position >= m_text.size()) {
+				return false;
+			}
+			char c = m_text[m_position++];
+			if (c == '"') {
+				return true;
+			}
+			if ((unsigned char)c < 0x20) {
+				return false;
+			}
+			if (c != '\\') {
+				str->push_back(c);
+				continue;
+			}
+			char escape = peek();
+			m_position++;
+			const char* SIMPLE = "\"\\/bfnrt";
+			const char* DECODED = "\"\\/\b\f\n\r\t";
+			if (escape != '\0' && strchr(SIMPLE, escape) != nullptr) {
+				str->push_back(DECODED[strchr(SIMPLE, escape) - SIMPLE]);
+			}
+			else if (escape == 'u' && m_position + 4 <= m_text.size()) {
+				std::string hex = m_text.substr(m_position, 4);
+				char* end;
+				long code = strtol(hex.c_str(), &end, 16);
+				if (end != hex.c_str() + 4 || code >= 0x80) {
+					return false;
+				}
+				str->push_back((char)code);
+				m_position += 4;
+			}
+			else {
+				return false;
+			}
+		}
+	}
+	bool parseNumber() {
+		size_t start = m_position;
+		consume("-");
+		if (consume("0")) {}
+		else if (peek() >= '1' && peek() <= '9') {
+			while (peek() >= '0' && peek() <= '9') { m_position++; }
+		}
+		else {
+			return false;
+		}
+		if (consume(".")) {
+			size_t digits = m_position;
+			while (peek() >= '0' && peek() <= '9') { m_position++; }
+			if (m_position == digits) {
+				return false;
+			}
+		}
+		if (peek() == 'e' || peek() == 'E') {
+			m_position++;
+			if (peek() == '+' || peek() == '-') {
+				m_position++;
+			}
+			size_t digits = m_position;
+			while (peek() >= '0' && peek() <= '9') { m_position++; }
+			if (m_position == digits) {
+				return false;
+			}
+		}
+		return m_position > start;
+	}
+	const std::string& m_text;
+	size_t m_position = 0;
+};
+
+static bool isPrometheusName(const std::string& name) {
+	if (name.empty() || (name[0] >= '0' && name[0] <= '9')) {
+		return false;
+	}
+	for (char c : name)
+	{
+		if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == ':')) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool isPrometheusValue(const std::string& value) {
+	if (value == "+Inf" || value == "-Inf" || value == "NaN") {
+		return true;
+	}
+	char* end;
+	strtod(value.c_str(), &end);
+	return !value.empty() && end == value.c_str() + value.size();
+}
+
+/// <summary>
+/// Checks text against the Prometheus text exposition format: HELP and TYPE comments, then samples of that family only.
+/// Summaries may also have name_sum and name_count samples, and quantile labels. Returns the family names in order.
+/// </summary>
+static bool validatePrometheus(const std::string& text, std::vector<std::string>* families) {
+	if (!text.empty() && text.back() != '\n') {
+		return false;
+	}
+	std::string family, type;
+	size_t lineStart = 0;
+	while (lineStart < text.size())
+	{
+		size_t lineEnd = text.find('\n', lineStart);
+		std::string line = text.substr(lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 1;
+		if (line.compare(0, 7, "# HELP ") == 0) {
+			size_t nameEnd = line.find(' ', 7);
+			if (nameEnd == std::string::npos || !isPrometheusName(line.substr(7, nameEnd - 7))) {
+				return false;
+			}
+			continue;
+		}
+		if (line.compare(0, 7, "# TYPE ") == 0) {
+			size_t nameEnd = line.find(' ', 7);
+			if (nameEnd == std::string::npos) {
+				return false;
+			}
+			family = line.substr(7, nameEnd - 7);
+			type = line.substr(nameEnd + 1);
+			if (!isPrometheusName(family) || (type != "counter" && type != "gauge" && type != "summary")) {
+				return false;
+			}
+			//Each family is declared once
+			if (std::find(families->begin(), families->end(), family) != families->end()) {
+				return false;
+			}
+			families->push_back(family);
+			continue;
+		}
+		if (line.empty() || line[0] == '#') {
+			return false;
+		}
+		size_t nameEnd = line.find_first_of("{ ");
+		if (nameEnd == std::string::npos) {
+			return false;
+		}
+		std::string name = line.substr(0, nameEnd);
+		bool summarySample = type == "summary" && (name == family + "_sum" || name == family + "_count");
+		if (!isPrometheusName(name) || (name != family && !summarySample)) {
+			return false;
+		}
+		size_t valueStart = nameEnd;
+		if (line[nameEnd] == '{') {
+			size_t labelsEnd = line.find('}', nameEnd);
+			if (labelsEnd == std::string::npos || type != "summary" || name != family) {
+				return false;
+			}
+			//Only the quantile label is written
+			std::string labels = line.substr(nameEnd + 1, labelsEnd - nameEnd - 1);
+			if (labels.compare(0, 10, "quantile=\"") != 0 || labels.back() != '"' || !isPrometheusValue(labels.substr(10, labels.size() - 11))) {
+				return false;
+			}
+			valueStart = labelsEnd + 1;
+		}
+		if (line[valueStart] != ' ' || !isPrometheusValue(line.substr(valueStart + 1))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//Registers a few of each type, including names and help text that need escaping
+static void fillRegistry(ew::MetricsRegistry* registry) {
+	registry->getCounter("ew_frames_total", "Frames rendered")->add(42);
+	registry->getGauge("ew_buffer_bytes", "Help with a \\ backslash\nand a second line")->set(-7);
+	ew::Histogram* frameTime = registry->getHistogram("ew_frame_time_microseconds", "CPU time per frame");
+	for (uint64_t i = 1; i <= 1000; i++)
+	{
+		frameTime->record(i * 10);
+	}
+	registry->getHistogram("ew_empty_microseconds");
+	registry->getCounter("quoted \"name\"\n-1", "Needs escaping everywhere")->add();
+	registry->getGauge("9lives");
+}
+
+static void testJson() {
+	ew::MetricsRegistry registry;
+	fillRegistry(&registry);
+	std::string json;
+	registry.writeJson(&json);
+	EW_CHECK(!json.empty() && json.back() == '\n');
+	EW_CHECK(std::count(json.begin(), json.end(), '\n') == 1);
+	JsonValidator validator(json);
+	EW_CHECK(validator.validate());
+	std::vector<std::string> expectedKeys = { "timestamp", "ew_frames_total", "ew_buffer_bytes", "ew_frame_time_microseconds",
+		"ew_empty_microseconds", "quoted \"name\"\n-1", "9lives" };
+	EW_CHECK(validator.keys == expectedKeys);
+	EW_CHECK(json.find("\"ew_frames_total\":42") != std::string::npos);
+	EW_CHECK(json.find("\"ew_buffer_bytes\":-7") != std::string::npos);
+	EW_CHECK(json.find("\"ew_frame_time_microseconds\":{\"count\":1000,\"sum\":5005000,\"max\":10000") != std::string::npos);
+
+	//Exports append to each other as JSON lines
+	std::string second;
+	registry.writeJson(&second);
+	json += second;
+	EW_CHECK(std::count(json.begin(), json.end(), '\n') == 2);
+}
+
+static void testPrometheus() {
+	ew::MetricsRegistry registry;
+	fillRegistry(&registry);
+	std::string text;
+	registry.writePrometheus(&text);
+	std::vector<std::string> families;
+	EW_CHECK(validatePrometheus(text, &families));
+	std::vector<std::string> expectedFamilies = { "ew_frames_total", "ew_buffer_bytes", "ew_frame_time_microseconds",
+		"ew_empty_microseconds", "quoted__name___1", "_lives" };
+	EW_CHECK(families == expectedFamilies);
+	EW_CHECK(text.find("ew_frames_total 42\n") != std::string::npos);
+	EW_CHECK(text.find("# HELP ew_buffer_bytes Help with a \\\\ backslash\\nand a second line\n") != std::string::npos);
+	EW_CHECK(text.find("ew_frame_time_microseconds{quantile=\"0.5\"} ") != std::string::npos);
+	EW_CHECK(text.find("ew_frame_time_microseconds_count 1000\n") != std::string::npos);
+	EW_CHECK(text.find("ew_empty_microseconds_count 0\n") != std::string::npos);
+
+	//The validator itself rejects what it should
+	std::vector<std::string> ignored;
+	EW_CHECK(!validatePrometheus("# TYPE a counter\na 1", &ignored));
+	ignored.clear();
+	EW_CHECK(!validatePrometheus("# TYPE a counter\nb 1\n", &ignored));
+	ignored.clear();
+	EW_CHECK(!validatePrometheus("# TYPE a-b gauge\na-b 1\n", &ignored));
+	ignored.clear();
+	EW_CHECK(!validatePrometheus("# TYPE a gauge\na{quantile=\"0.5\"} 1\n", &ignored));
+	ignored.clear();
+	EW_CHECK(!validatePrometheus("# TYPE a counter\na one\n", &ignored));
+	ignored.clear();
+	EW_CHECK(!validatePrometheus("# HELP a first\nsecond\n# TYPE a counter\na 1\n", &ignored));
+}
+
+int main() {
+	testBuckets();
+	testPercentiles();
+	testConcurrentRecord();
+	testJson();
+	testPrometheus();
+	return finishTest();
+}
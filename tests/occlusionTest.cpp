@@ -0,0 +1,47 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/camera.h>
+#include <ew/occlusion.h>
+#include <ew/procGen.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include "testing.h"
+
+int main() {
+	//Camera at z = 5 looking down -z at a wall of a 2x2x2 cube at the origin
+	ew::Camera camera;
+	camera.position = glm::vec3(0.0f, 0.0f, 5.0f);
+	camera.target = glm::vec3(0.0f);
+	camera.aspectRatio = 2.0f;
+	glm::mat4 viewProjection = camera.projectionMatrix() * camera.viewMatrix();
+
+	ew::DepthRasterizer rasterizer(256, 128);
+	ew::MeshData occluder = ew::createCube(2.0f);
+	rasterizer.drawMesh(occluder, viewProjection);
+	//Front face is at z = 1, 4 units away. Window depth of anything covered is below the far plane.
+	const float* depth = rasterizer.getDepth();
+	EW_CHECK(depth[64 * 256 + 128] < 1.0f);
+	EW_CHECK(depth[0] == 1.0f);
+
+	ew::HiZPyramid hiZ;
+	EW_CHECK(!hiZ.isOccluded(ew::AABB{ glm::vec3(-0.1f), glm::vec3(0.1f) }, glm::mat4(1.0f)));
+	hiZ.build(rasterizer.getDepth(), rasterizer.getWidth(), rasterizer.getHeight(), viewProjection);
+	EW_CHECK(hiZ.isValid());
+	EW_CHECK(hiZ.getNumLevels() == 9); //256x128 down to 1x1
+
+	ew::AABB box = { glm::vec3(-0.25f), glm::vec3(0.25f) };
+	//Directly behind the cube
+	EW_CHECK(hiZ.isOccluded(box, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -3.0f))));
+	//Off to the side, so the cube doesn't cover it
+	EW_CHECK(!hiZ.isOccluded(box, glm::translate(glm::mat4(1.0f), glm::vec3(4.0f, 0.0f, -3.0f))));
+	//In front of the cube
+	EW_CHECK(!hiZ.isOccluded(box, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 2.0f))));
+	//Behind, but peeking out past the cube's edge
+	EW_CHECK(!hiZ.isOccluded(box, glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.0f, -3.0f))));
+	//Crossing the near plane
+	EW_CHECK(!hiZ.isOccluded(box, glm::translate(glm::mat4(1.0f), camera.position)));
+	//The occluder's own bounds are never hidden by its own depth
+	EW_CHECK(!hiZ.isOccluded(ew::AABB{ glm::vec3(-1.0f), glm::vec3(1.0f) }, glm::mat4(1.0f)));
+	return finishTest();
+}
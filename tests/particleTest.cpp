@@ -0,0 +1,127 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/external/glad.h>
+#include <ew/particles.h>
+#include <algorithm>
+#include <vector>
+#include "glTestContext.h"
+#include "testing.h"
+
+static const float TOLERANCE = 1e-4f;
+
+static bool nearlyEqual(const ew::Particle& a, const ew::Particle& b) {
+	for (int c = 0; c < 4; c++)
+	{
+		if (fabsf(a.positionLife[c] - b.positionLife[c]) > TOLERANCE || fabsf(a.velocityLifetime[c] - b.velocityLifetime[c]) > TOLERANCE) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/// <summary>
+/// Particles in expected with no match in actual, where each particle of actual matches at most once.
+/// The GPU writes survivors in whatever order work groups finish, so only the multiset is comparable.
+/// Both are sorted by total lifetime, which is random per particle and never changes, so matches sit close together.
+/// </summary>
+static size_t countUnmatched(std::vector<ew::Particle> expected, std::vector<ew::Particle> actual) {
+	auto byLifetime = [](const ew::Particle& a, const ew::Particle& b) { return a.velocityLifetime.w < b.velocityLifetime.w; };
+	std::sort(expected.begin(), expected.end(), byLifetime);
+	std::sort(actual.begin(), actual.end(), byLifetime);
+	std::vector<bool> used(actual.size(), false);
+	size_t numUnmatched = 0;
+	size_t first = 0;
+	for (const ew::Particle& particle : expected)
+	{
+		//Skip past candidates whose lifetime is already too small to match this or any later particle
+		while (first < actual.size() && actual[first].velocityLifetime.w < particle.velocityLifetime.w - TOLERANCE) {
+			first++;
+		}
+		bool found = false;
+		for (size_t i = first; i < actual.size() && actual[i].velocityLifetime.w <= particle.velocityLifetime.w + TOLERANCE; i++)
+		{
+			if (!used[i] && nearlyEqual(particle, actual[i])) {
+				used[i] = true;
+				found = true;
+				break;
+			}
+		}
+		if (!found) {
+			numUnmatched++;
+		}
+	}
+	return numUnmatched;
+}
+
+static ew::ParticleEmitter makeEmitter() {
+	ew::ParticleEmitter emitter;
+	emitter.position = glm::vec3(1.0f, 2.0f, -3.0f);
+	emitter.minLifetime = 0.1f;
+	emitter.maxLifetime = 1.0f;
+	emitter.rate = 3000.0f;
+	return emitter;
+}
+
+//The reference itself: survivors lose the elapsed time, and the comparison ignores order but not content
+static void testReference() {
+	ew::ParticleEmitter emitter = makeEmitter();
+	ew::ParticleSimulation simulation;
+	std::vector<ew::Particle> particles;
+	ew::emitParticlesReference(emitter, 7, 1000, &particles);
+	EW_CHECK(particles.size() == 1000);
+	std::vector<ew::Particle> survivors;
+	ew::simulateParticlesReference(particles, simulation, 0.5f, &survivors);
+	size_t expectedSurvivors = std::count_if(particles.begin(), particles.end(), [](const ew::Particle& p) { return p.positionLife.w > 0.5f; });
+	EW_CHECK(survivors.size() == expectedSurvivors);
+	EW_CHECK(survivors.size() > 0 && survivors.size() < particles.size());
+
+	std::vector<ew::Particle> shuffled = survivors;
+	std::reverse(shuffled.begin(), shuffled.end());
+	std::rotate(shuffled.begin(), shuffled.begin() + shuffled.size() / 3, shuffled.end());
+	EW_CHECK(countUnmatched(survivors, shuffled) == 0);
+	shuffled[5].positionLife.y += 0.01f;
+	EW_CHECK(countUnmatched(survivors, shuffled) == 1);
+}
+
+/// <summary>
+/// Runs two GPU updates and compares the buffer with the CPU reference after each.
+/// The first only emits. The second simulates those, killing about half, then appends a second batch.
+/// </summary>
+static void testGpuMatchesReference() {
+	const unsigned int CAPACITY = 8192;
+	ew::ParticleEmitter emitter = makeEmitter();
+	ew::ParticleSimulation simulation;
+	ew::ParticleSystem particleSystem(CAPACITY, EW_TEST_ASSETS_DIR "shaders/");
+	std::vector<ew::Particle> expected;
+	std::vector<ew::Particle> actual;
+
+	//Rate times delta time is exact in float, so the system emits exactly this many
+	const float FIRST_STEP = 1.0f;
+	particleSystem.update(FIRST_STEP, emitter, simulation);
+	ew::emitParticlesReference(emitter, 0, (unsigned int)(emitter.rate * FIRST_STEP), &expected);
+	particleSystem.readParticles(&actual);
+	EW_CHECK(actual.size() == expected.size());
+	EW_CHECK(countUnmatched(expected, actual) == 0);
+
+	const float SECOND_STEP = 0.5f;
+	particleSystem.update(SECOND_STEP, emitter, simulation);
+	std::vector<ew::Particle> survivors;
+	ew::simulateParticlesReference(expected, simulation, SECOND_STEP, &survivors);
+	ew::emitParticlesReference(emitter, 1, (unsigned int)(emitter.rate * SECOND_STEP), &survivors);
+	particleSystem.readParticles(&actual);
+	size_t numUnmatched = countUnmatched(survivors, actual);
+	printf("%zu particles after two steps, %zu expected, %zu unmatched\n", actual.size(), survivors.size(), numUnmatched);
+	EW_CHECK(actual.size() == survivors.size());
+	EW_CHECK(numUnmatched == 0);
+}
+
+int main() {
+	testReference();
+	TestContext context;
+	if (context.isValid()) {
+		testGpuMatchesReference();
+	}
+	return finishTest();
+}
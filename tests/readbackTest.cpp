@@ -0,0 +1,170 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/readback.h>
+#include <ew/renderTarget.h>
+#include <stdlib.h>
+#include <vector>
+#include "glTestContext.h"
+#include "testing.h"
+
+static void testPixelSizes() {
+	EW_CHECK(ew::ReadbackQueue::getPixelSize(GL_RGBA, GL_UNSIGNED_BYTE) == 4);
+	EW_CHECK(ew::ReadbackQueue::getPixelSize(GL_RGB, GL_UNSIGNED_BYTE) == 3);
+	EW_CHECK(ew::ReadbackQueue::getPixelSize(GL_RG, GL_HALF_FLOAT) == 4);
+	EW_CHECK(ew::ReadbackQueue::getPixelSize(GL_DEPTH_COMPONENT, GL_FLOAT) == 4);
+	EW_CHECK(ew::ReadbackQueue::getPixelSize(GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8) == 4);
+	EW_CHECK(ew::ReadbackQueue::getPixelSize(GL_RGBA, GL_UNSIGNED_INT_8_8_8_8) == 0);
+}
+
+//Every pixel of a readback is the given color, give or take a unit of rounding
+static bool isSolid(const ew::ReadbackResult& result, const unsigned char* color, int channels) {
+	if (result.size != (size_t)result.width * result.height * channels) {
+		return false;
+	}
+	const unsigned char* data = (const unsigned char*)result.data;
+	for (size_t i = 0; i < result.size; i++)
+	{
+		if (abs((int)data[i] - (int)color[i % channels]) > 1) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void clear(const unsigned char* color) {
+	glClearColor(color[0] / 255.0f, color[1] / 255.0f, color[2] / 255.0f, color[3] / 255.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+}
+
+//A known clear color comes back through both kinds of copy, including rows that aren't a multiple of 4 bytes
+static void testClearColor() {
+	const int W = 32, H = 16;
+	ew::RenderTarget target;
+	target.resize(W, H);
+	target.bind();
+	const unsigned char color[4] = { 64, 128, 191, 255 };
+	clear(color);
+
+	ew::ReadbackQueue queue(3);
+	int numDelivered = 0;
+	EW_CHECK(queue.readPixels(0, 0, W, H, GL_RGBA, GL_UNSIGNED_BYTE, [&](const ew::ReadbackResult& result) {
+		EW_CHECK(result.width == W && result.height == H);
+		EW_CHECK(isSolid(result, color, 4));
+		numDelivered++;
+	}));
+	EW_CHECK(queue.readPixels(3, 2, 5, 3, GL_RGB, GL_UNSIGNED_BYTE, [&](const ew::ReadbackResult& result) {
+		EW_CHECK(result.width == 5 && result.height == 3);
+		EW_CHECK(isSolid(result, color, 3));
+		numDelivered++;
+	}));
+	EW_CHECK(queue.readTexture(target.getColorTexture(), 0, W, H, GL_RGBA, GL_UNSIGNED_BYTE, [&](const ew::ReadbackResult& result) {
+		EW_CHECK(isSolid(result, color, 4));
+		numDelivered++;
+	}));
+	EW_CHECK(queue.getNumInFlight() == 3);
+	queue.flush();
+	EW_CHECK(numDelivered == 3);
+	EW_CHECK(queue.getNumInFlight() == 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/// <summary>
+/// Each request reads a pixel cleared to its own color right before, so a callback that sees another request's
+/// color means the copy didn't happen when it was requested. Requests are spread over full queues, polls that may
+/// or may not find finished copies, and a copy queued from inside a callback.
+/// </summary>
+static void testOrder() {
+	ew::RenderTarget target;
+	target.resize(4, 4);
+	target.bind();
+	ew::ReadbackQueue queue(3);
+	std::vector<int> delivered;
+	int numWrongColors = 0;
+	int numRequested = 0;
+	auto request = [&]() {
+		int id = numRequested;
+		const unsigned char color[4] = { (unsigned char)(id * 5), (unsigned char)(255 - id * 3), 7, 255 };
+		clear(color);
+		bool queued = queue.readPixels(1, 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, [&delivered, &numWrongColors, id, color](const ew::ReadbackResult& result) {
+			delivered.push_back(id);
+			numWrongColors += !isSolid(result, color, 4);
+		});
+		numRequested += queued;
+		return queued;
+	};
+
+	//A full queue refuses more without dropping what it holds
+	EW_CHECK(request() && request() && request());
+	EW_CHECK(!request());
+	EW_CHECK(queue.getNumInFlight() == 3);
+	glFinish();
+	queue.poll();
+	EW_CHECK(queue.getNumInFlight() == 0);
+	EW_CHECK(delivered == std::vector<int>({ 0, 1, 2 }));
+
+	for (int frame = 0; frame < 40; frame++)
+	{
+		for (int i = 0; i < frame % 3 + 1; i++)
+		{
+			request();
+		}
+		if (frame % 4 == 0) {
+			glFinish();
+		}
+		queue.poll();
+	}
+
+	queue.flush();
+
+	//Queued while the oldest buffer is still mapped, it lands in a free slot and arrives last
+	bool queuedFromCallback = false;
+	int id = numRequested++;
+	const unsigned char color[4] = { 10, 20, 30, 255 };
+	clear(color);
+	EW_CHECK(queue.readPixels(0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, [&, id](const ew::ReadbackResult& result) {
+		delivered.push_back(id);
+		numWrongColors += !isSolid(result, color, 4);
+		queuedFromCallback = request();
+	}));
+	queue.flush();
+	EW_CHECK(queuedFromCallback);
+	EW_CHECK(queue.getNumInFlight() == 0);
+	EW_CHECK((int)delivered.size() == numRequested);
+	bool inOrder = true;
+	for (size_t i = 0; i < delivered.size(); i++)
+	{
+		inOrder &= delivered[i] == (int)i;
+	}
+	EW_CHECK(inOrder);
+	EW_CHECK(numWrongColors == 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+//Copies still pending when the queue goes away are dropped, not delivered
+static void testDestroyPending() {
+	ew::RenderTarget target;
+	target.resize(4, 4);
+	target.bind();
+	bool called = false;
+	{
+		ew::ReadbackQueue queue(1);
+		EW_CHECK(queue.readPixels(0, 0, 4, 4, GL_RGBA, GL_UNSIGNED_BYTE, [&called](const ew::ReadbackResult&) { called = true; }));
+	}
+	glFinish();
+	EW_CHECK(!called);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+int main() {
+	testPixelSizes();
+	TestContext context;
+	if (!context.isValid()) {
+		return numFailedChecks > 0 ? finishTest() : TEST_SKIPPED;
+	}
+	testClearColor();
+	testOrder();
+	testDestroyPending();
+	return finishTest();
+}
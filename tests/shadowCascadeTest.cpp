@@ -0,0 +1,92 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/external/glad.h>
+#include <ew/shadowMap.h>
+#include "testing.h"
+
+//Cascade selection is CPU only, so the GL objects behind the map are faked
+static void fakeCreate(GLenum, GLsizei n, GLuint* ids) { for (GLsizei i = 0; i < n; i++) { ids[i] = i + 1; } }
+static void fakeCreateFramebuffers(GLsizei n, GLuint* ids) { fakeCreate(0, n, ids); }
+static void fakeDelete(GLsizei, const GLuint*) {}
+static void fakeStorage3D(GLuint, GLsizei, GLenum, GLsizei, GLsizei, GLsizei) {}
+static void fakeParameteri(GLuint, GLenum, GLint) {}
+static void fakeParameterfv(GLuint, GLenum, const GLfloat*) {}
+static void fakeFramebufferBuffer(GLuint, GLenum) {}
+
+static void fakeGL() {
+	glad_glCreateTextures = fakeCreate;
+	glad_glCreateQueries = fakeCreate;
+	glad_glCreateFramebuffers = fakeCreateFramebuffers;
+	glad_glDeleteTextures = fakeDelete;
+	glad_glDeleteQueries = fakeDelete;
+	glad_glDeleteFramebuffers = fakeDelete;
+	glad_glTextureStorage3D = fakeStorage3D;
+	glad_glTextureParameteri = fakeParameteri;
+	glad_glTextureParameterfv = fakeParameterfv;
+	glad_glNamedFramebufferDrawBuffer = fakeFramebufferBuffer;
+	glad_glNamedFramebufferReadBuffer = fakeFramebufferBuffer;
+}
+
+static ew::AABB boxAt(const glm::vec3& center) {
+	return { center - glm::vec3(0.5f), center + glm::vec3(0.5f) };
+}
+
+int main() {
+	fakeGL();
+	ew::CascadedShadowMap shadowMap(1024, 4);
+	ew::Camera camera;
+	camera.position = glm::vec3(0.0f, 0.0f, 5.0f);
+	camera.target = glm::vec3(0.0f);
+	glm::vec3 lightDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+
+	//First update renders everything, after that a still scene and camera render nothing
+	shadowMap.update(camera, lightDirection);
+	for (int i = 0; i < shadowMap.getNumCascades(); i++)
+	{
+		EW_CHECK(shadowMap.getCascade(i).needsRender);
+	}
+	shadowMap.update(camera, lightDirection);
+	for (int i = 0; i < shadowMap.getNumCascades(); i++)
+	{
+		EW_CHECK(!shadowMap.getCascade(i).needsRender);
+	}
+
+	//A caster far down the view only touches the last cascade. It's a far cascade, so it waits for its interval.
+	ew::AABB far = boxAt(glm::vec3(0.0f, 0.0f, -40.0f));
+	shadowMap.update(camera, lightDirection, &far, 1);
+	EW_CHECK(!shadowMap.getCascade(0).needsRender);
+	EW_CHECK(!shadowMap.getCascade(0).stale);
+	EW_CHECK(!shadowMap.getCascade(1).needsRender);
+	const ew::ShadowCascade& last = shadowMap.getCascade(3);
+	EW_CHECK(last.stale || last.needsRender);
+	//Stays pending with nothing moving, until its interval comes around
+	bool rendered = last.needsRender;
+	for (int frame = 0; frame < shadowMap.farCascadeInterval && !rendered; frame++)
+	{
+		shadowMap.update(camera, lightDirection);
+		rendered = last.needsRender;
+	}
+	EW_CHECK(rendered);
+	EW_CHECK(!last.stale);
+
+	//A caster above the view, between the near slice and the light, still shadows the first cascade
+	ew::AABB above = boxAt(glm::vec3(0.0f, 20.0f, 4.0f));
+	shadowMap.update(camera, lightDirection, &above, 1);
+	EW_CHECK(shadowMap.getCascade(0).needsRender);
+
+	//Off to the side of every cascade, nothing re-renders
+	for (int frame = 0; frame < shadowMap.farCascadeInterval; frame++)
+	{
+		shadowMap.update(camera, lightDirection);
+	}
+	ew::AABB outside = boxAt(glm::vec3(500.0f, 0.0f, 0.0f));
+	shadowMap.update(camera, lightDirection, &outside, 1);
+	for (int i = 0; i < shadowMap.getNumCascades(); i++)
+	{
+		EW_CHECK(!shadowMap.getCascade(i).needsRender);
+		EW_CHECK(!shadowMap.getCascade(i).stale);
+	}
+	return finishTest();
+}
@@ -0,0 +1,87 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include <ew/animation.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <math.h>
+#include <vector>
+
+//Chains of joints, each a unit above its parent. Joint 0 is the root, and every chainLength joints
+//a new chain starts from it, so long skeletons branch like a real rig instead of one very long arm.
+inline ew::Skeleton makeChainSkeleton(size_t numJoints, size_t chainLength = 16) {
+	ew::Skeleton skeleton;
+	skeleton.restPose.resize(numJoints);
+	for (size_t i = 0; i < numJoints; i++)
+	{
+		int parent = i == 0 ? -1 : (i % chainLength == 0 ? 0 : (int)i - 1);
+		size_t depth = i < chainLength ? i : i % chainLength + 1;
+		skeleton.names.push_back("joint" + std::to_string(i));
+		skeleton.parents.push_back(parent);
+		skeleton.inverseBindMatrices.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -(float)depth, 0.0f)));
+		skeleton.restPose.translations[i] = glm::vec3(0.0f, i == 0 ? 0.0f : 1.0f, 0.0f);
+		skeleton.restPose.rotations[i] = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+		skeleton.restPose.scales[i] = glm::vec3(1.0f);
+	}
+	return skeleton;
+}
+
+/// <summary>
+/// Clip where every joint sways with its own phase, keyed at roughly 30 per second like a baked export.
+/// Key counts differ per channel and per joint,
+/// and the last joint has no track at all, so the rest pose fallback gets exercised too.
+/// </summary>
+inline ew::AnimationClip makeSwayClip(size_t numJoints, float duration, float phase) {
+	ew::AnimationClip clip;
+	clip.name = "sway";
+	clip.duration = duration;
+	clip.tracks.resize(numJoints > 0 ? numJoints - 1 : 0);
+	for (size_t i = 0; i < clip.tracks.size(); i++)
+	{
+		ew::AnimationClip::Track& track = clip.tracks[i];
+		unsigned int numKeys = (unsigned int)(duration * 30.0f) + 2 + (unsigned int)(i % 5);
+		track.translationBegin = (unsigned int)clip.translationKeys.size();
+		track.translationCount = numKeys;
+		track.rotationBegin = (unsigned int)clip.rotationKeys.size();
+		track.rotationCount = numKeys + 3;
+		track.scaleBegin = (unsigned int)clip.scaleKeys.size();
+		track.scaleCount = i % 3 == 0 ? 0 : 2;
+		for (unsigned int k = 0; k < track.translationCount; k++)
+		{
+			float time = duration * k / (track.translationCount - 1);
+			clip.translationTimes.push_back(time);
+			clip.translationKeys.push_back(glm::vec3(0.1f * sinf(time * 3.0f + phase + i), i == 0 ? 0.0f : 1.0f, 0.05f * cosf(time * 2.0f + i)));
+		}
+		for (unsigned int k = 0; k < track.rotationCount; k++)
+		{
+			float time = duration * k / (track.rotationCount - 1);
+			clip.rotationTimes.push_back(time);
+			float angle = 0.4f * sinf(time * 4.0f + phase + 0.7f * i);
+			clip.rotationKeys.push_back(glm::angleAxis(angle, glm::normalize(glm::vec3(1.0f, 0.3f * i, 0.5f))));
+		}
+		for (unsigned int k = 0; k < track.scaleCount; k++)
+		{
+			float time = duration * k;
+			clip.scaleTimes.push_back(time);
+			clip.scaleKeys.push_back(glm::vec3(1.0f + 0.2f * k));
+		}
+	}
+	return clip;
+}
+
+//Largest difference between any two matching elements of two matrix arrays
+inline float maxMatrixDifference(const glm::mat4* a, const glm::mat4* b, size_t count) {
+	float maxDifference = 0.0f;
+	for (size_t i = 0; i < count; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			for (int r = 0; r < 4; r++)
+			{
+				maxDifference = fmaxf(maxDifference, fabsf(a[i][c][r] - b[i][c][r]));
+			}
+		}
+	}
+	return maxDifference;
+}
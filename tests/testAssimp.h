@@ -0,0 +1,51 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include <ew/mesh.h>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+//Copies an imported mesh's triangles. Normals and tangents are copied if Assimp generated them, otherwise left zero.
+inline ew::MeshData convertAiMesh(const aiMesh* aiMesh) {
+	ew::MeshData mesh;
+	for (unsigned int i = 0; i < aiMesh->mNumVertices; i++)
+	{
+		ew::Vertex v;
+		v.pos = glm::vec3(aiMesh->mVertices[i].x, aiMesh->mVertices[i].y, aiMesh->mVertices[i].z);
+		v.normal = glm::vec3(0.0f);
+		v.uv = aiMesh->HasTextureCoords(0) ? glm::vec2(aiMesh->mTextureCoords[0][i].x, aiMesh->mTextureCoords[0][i].y) : glm::vec2(0.0f);
+		v.tangent = glm::vec4(0.0f);
+		if (aiMesh->HasNormals()) {
+			v.normal = glm::vec3(aiMesh->mNormals[i].x, aiMesh->mNormals[i].y, aiMesh->mNormals[i].z);
+		}
+		if (aiMesh->HasTangentsAndBitangents()) {
+			glm::vec3 tangent(aiMesh->mTangents[i].x, aiMesh->mTangents[i].y, aiMesh->mTangents[i].z);
+			glm::vec3 bitangent(aiMesh->mBitangents[i].x, aiMesh->mBitangents[i].y, aiMesh->mBitangents[i].z);
+			v.tangent = glm::vec4(tangent, glm::dot(glm::cross(v.normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f);
+		}
+		mesh.vertices.push_back(v);
+	}
+	for (unsigned int i = 0; i < aiMesh->mNumFaces; i++)
+	{
+		for (unsigned int j = 0; j < aiMesh->mFaces[i].mNumIndices; j++)
+		{
+			mesh.indices.push_back(aiMesh->mFaces[i].mIndices[j]);
+		}
+	}
+	return mesh;
+}
+
+//Imports the first mesh of a file. Returns false and prints why if it can't.
+inline bool importFirstMesh(const char* path, unsigned int flags, ew::MeshData* mesh) {
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFile(path, flags);
+	if (scene == nullptr || scene->mNumMeshes == 0) {
+		printf("Failed to import %s: %s\n", path, importer.GetErrorString());
+		return false;
+	}
+	*mesh = convertAiMesh(scene->mMeshes[0]);
+	return true;
+}
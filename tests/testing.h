@@ -0,0 +1,37 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#pragma once
+#include <math.h>
+#include <stdio.h>
+
+//Minimal checks for the test executables. A failed check prints where it was and the test exits non-zero.
+static int numFailedChecks = 0;
+
+#define EW_CHECK(condition) do { \
+	if (!(condition)) { \
+		printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+		numFailedChecks++; \
+	} \
+} while (0)
+
+#define EW_CHECK_NEAR(a, b, tolerance) do { \
+	double ewCheckA = (double)(a), ewCheckB = (double)(b); \
+	if (!(fabs(ewCheckA - ewCheckB) <= (tolerance))) { \
+		printf("%s:%d: check failed: %s = %g, %s = %g\n", __FILE__, __LINE__, #a, ewCheckA, #b, ewCheckB); \
+		numFailedChecks++; \
+	} \
+} while (0)
+
+//CTest reports this exit code as skipped, e.g. for GPU tests on a machine without one
+static const int TEST_SKIPPED = 77;
+
+inline int finishTest() {
+	if (numFailedChecks > 0) {
+		printf("%d checks failed\n", numFailedChecks);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
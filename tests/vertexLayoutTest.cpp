@@ -0,0 +1,184 @@
+/*
+*	Author: Eric Winebrenner
+*/
+
+#include <ew/mesh.h>
+#include <ew/procGen.h>
+#include <ew/vertexLayout.h>
+#include <iterator>
+#include <vector>
+#include "glTestContext.h"
+#include "testing.h"
+
+//Half the size of ew::Vertex: normalized integer normal, UV and color
+struct CompactVertex {
+	glm::vec3 pos;
+	glm::i8vec4 normal;
+	glm::u16vec2 uv;
+	glm::u8vec4 color;
+};
+
+namespace ew {
+	template<> struct VertexFormat<CompactVertex> {
+		static constexpr VertexAttribute attributes[] = {
+			EW_VERTEX_ATTRIBUTE(0, CompactVertex, pos),
+			EW_VERTEX_ATTRIBUTE(1, CompactVertex, normal),
+			EW_VERTEX_ATTRIBUTE(2, CompactVertex, uv),
+			EW_VERTEX_ATTRIBUTE(3, CompactVertex, color)
+		};
+	};
+}
+
+template<size_t N>
+constexpr bool isValid(const ew::VertexAttribute(&attributes)[N], size_t stride) {
+	return ew::isValidVertexLayout(attributes, N, stride);
+}
+
+static_assert(isValid(ew::VertexFormat<ew::Vertex>::attributes, sizeof(ew::Vertex)), "ew::Vertex");
+static_assert(isValid(ew::VertexFormat<CompactVertex>::attributes, sizeof(CompactVertex)), "CompactVertex");
+static_assert(ew::getVertexLayout<CompactVertex>().stride == 24, "CompactVertex is tightly packed");
+
+//Attributes that end exactly where the next starts don't overlap
+constexpr ew::VertexAttribute ADJACENT[] = {
+	ew::makeAttribute<glm::vec3>(0, 0),
+	ew::makeAttribute<glm::vec2>(1, 12),
+	ew::makeAttribute(2, 20, 4, ew::AttributeType::INT_2_10_10_10, ew::AttributeMode::NORMALIZED),
+	ew::makeAttribute<glm::uvec4>(3, 24)
+};
+static_assert(isValid(ADJACENT, 40), "adjacent attributes");
+
+//The vec2 starts inside the vec3
+constexpr ew::VertexAttribute OVERLAPPING[] = {
+	ew::makeAttribute<glm::vec3>(0, 0),
+	ew::makeAttribute<glm::vec2>(1, 8)
+};
+static_assert(!isValid(OVERLAPPING, 20), "overlapping offsets");
+
+//Overlap is caught whichever attribute comes first
+constexpr ew::VertexAttribute OVERLAPPING_REVERSED[] = {
+	ew::makeAttribute<glm::vec2>(1, 8),
+	ew::makeAttribute<glm::vec3>(0, 0)
+};
+static_assert(!isValid(OVERLAPPING_REVERSED, 20), "overlapping offsets, reversed");
+
+constexpr ew::VertexAttribute MISALIGNED[] = {
+	ew::makeAttribute<glm::u8vec4>(0, 0),
+	ew::makeAttribute<float>(1, 6)
+};
+static_assert(!isValid(MISALIGNED, 12), "float at an offset that isn't a multiple of 4");
+
+constexpr ew::VertexAttribute DUPLICATE_LOCATION[] = {
+	ew::makeAttribute<glm::vec3>(0, 0),
+	ew::makeAttribute<glm::vec3>(0, 12)
+};
+static_assert(!isValid(DUPLICATE_LOCATION, 24), "duplicate location");
+
+constexpr ew::VertexAttribute INTEGER_FLOAT[] = {
+	ew::makeAttribute(0, 0, 4, ew::AttributeType::FLOAT, ew::AttributeMode::INTEGER)
+};
+static_assert(!isValid(INTEGER_FLOAT, 16), "integer mode with a float type");
+
+constexpr ew::VertexAttribute PAST_END[] = {
+	ew::makeAttribute<glm::vec4>(0, 0)
+};
+static_assert(!isValid(PAST_END, 12), "attribute past the end of the vertex");
+
+constexpr ew::VertexAttribute LOCATION_OUT_OF_RANGE[] = {
+	ew::makeAttribute<glm::vec4>(ew::MAX_VERTEX_ATTRIBUTES, 0)
+};
+static_assert(!isValid(LOCATION_OUT_OF_RANGE, 16), "location past the guaranteed 16");
+
+constexpr ew::VertexAttribute PACKED_THREE_COMPONENTS[] = {
+	ew::makeAttribute(0, 0, 3, ew::AttributeType::INT_2_10_10_10, ew::AttributeMode::NORMALIZED)
+};
+static_assert(!isValid(PACKED_THREE_COMPONENTS, 4), "2_10_10_10 with 3 components");
+
+static std::vector<CompactVertex> compress(const ew::MeshData& mesh, ew::AABB* bounds) {
+	std::vector<CompactVertex> vertices;
+	for (const ew::Vertex& v : mesh.vertices)
+	{
+		CompactVertex c;
+		c.pos = v.pos;
+		c.normal = glm::i8vec4(glm::round(glm::vec4(v.normal, 0.0f) * 127.0f));
+		c.uv = glm::u16vec2(glm::round(glm::clamp(v.uv, 0.0f, 1.0f) * 65535.0f));
+		c.color = glm::u8vec4(255);
+		vertices.push_back(c);
+		bounds->expand(v.pos);
+	}
+	return vertices;
+}
+
+static int getBoundVertexArray() {
+	int vao = 0;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vao);
+	return vao;
+}
+
+//Vertex buffer the bound vertex array reads binding 0 from
+static int getBoundVertexBuffer() {
+	int buffer = 0;
+	glGetIntegeri_v(GL_VERTEX_BINDING_BUFFER, 0, &buffer);
+	return buffer;
+}
+
+/// <summary>
+/// Meshes with the same VertexFormat share a vertex array, and drawing one points it at that mesh's buffer.
+/// A different format gets its own, set up with that format's attributes.
+/// </summary>
+static void testSharedVertexArrays() {
+	size_t numShared = ew::getNumSharedVertexArrays();
+	ew::Mesh cube(ew::createCube(1.0f));
+	EW_CHECK(ew::getNumSharedVertexArrays() == numShared + 1);
+	ew::Mesh sphere(ew::createSphere(1.0f, 8));
+	EW_CHECK(ew::getNumSharedVertexArrays() == numShared + 1);
+
+	cube.draw(ew::DrawMode::POINTS);
+	int cubeVao = getBoundVertexArray();
+	EW_CHECK(getBoundVertexBuffer() == (int)cube.getVertexBuffer());
+	sphere.draw(ew::DrawMode::POINTS);
+	EW_CHECK(getBoundVertexArray() == cubeVao);
+	EW_CHECK(getBoundVertexBuffer() == (int)sphere.getVertexBuffer());
+
+	//A layout built at runtime matches by its attributes, not by where they live
+	std::vector<ew::VertexAttribute> copied(std::begin(ew::VertexFormat<ew::Vertex>::attributes), std::end(ew::VertexFormat<ew::Vertex>::attributes));
+	ew::VertexLayout runtimeLayout = { copied.data(), (unsigned int)copied.size(), sizeof(ew::Vertex) };
+	EW_CHECK((int)ew::getSharedVertexArray(runtimeLayout) == cubeVao);
+	EW_CHECK(ew::getNumSharedVertexArrays() == numShared + 1);
+
+	ew::AABB bounds;
+	ew::MeshData cubeData = ew::createCube(1.0f);
+	std::vector<CompactVertex> compactVertices = compress(cubeData, &bounds);
+	ew::Mesh compact;
+	compact.load(compactVertices.data(), compactVertices.size(), cubeData.indices.data(), cubeData.indices.size(), bounds);
+	EW_CHECK(ew::getNumSharedVertexArrays() == numShared + 2);
+	EW_CHECK(compact.getLayout().stride == sizeof(CompactVertex));
+	ew::Mesh compact2;
+	compact2.load(compactVertices.data(), compactVertices.size(), cubeData.indices.data(), cubeData.indices.size(), bounds);
+	EW_CHECK(ew::getNumSharedVertexArrays() == numShared + 2);
+
+	compact.draw(ew::DrawMode::POINTS);
+	int compactVao = getBoundVertexArray();
+	EW_CHECK(compactVao != cubeVao);
+	compact2.draw(ew::DrawMode::POINTS);
+	EW_CHECK(getBoundVertexArray() == compactVao);
+	for (const ew::VertexAttribute& attribute : ew::VertexFormat<CompactVertex>::attributes)
+	{
+		int offset = -1, normalized = -1, integer = -1;
+		glGetVertexArrayIndexediv(compactVao, attribute.location, GL_VERTEX_ATTRIB_RELATIVE_OFFSET, &offset);
+		glGetVertexArrayIndexediv(compactVao, attribute.location, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &normalized);
+		glGetVertexArrayIndexediv(compactVao, attribute.location, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &integer);
+		EW_CHECK(offset == (int)attribute.offset);
+		EW_CHECK((normalized != 0) == (attribute.mode == ew::AttributeMode::NORMALIZED));
+		EW_CHECK(integer == 0);
+	}
+	glBindVertexArray(0);
+}
+
+int main() {
+	TestContext context;
+	if (!context.isValid()) {
+		return TEST_SKIPPED;
+	}
+	testSharedVertexArrays();
+	return finishTest();
+}